@@ -15,4 +15,5 @@ int lockFile(const char* pathname);
 int unlockFile(const char* pathname);
 int removeFile(const char* pathname);
 int closeFile(const char* pathname);
+int getStats(char** buf, size_t* size);
 #endif
\ No newline at end of file
@@ -0,0 +1,37 @@
+#ifndef CHUNK_POOL_H
+#define CHUNK_POOL_H
+
+#include <stddef.h>
+
+#define FILE_CHUNK_SIZE (32 * 1024)
+#define CHUNK_POOL_MAX_FREE 256 // blocchi liberi mantenuti nel pool, gli altri vengono restituiti al sistema
+
+/** Blocco di dimensione fissa del contenuto di un file. I file sono liste di blocchi: una scrittura in append riempie
+ *  l'ultimo blocco e ne aggiunge di nuovi senza copiare i dati gia' presenti.
+ *
+ */
+typedef struct fileChunk
+{
+    struct fileChunk *next;
+    char data[FILE_CHUNK_SIZE];
+} FileChunk;
+
+/**
+ * @brief Preleva un blocco dal pool, allocandolo se il pool e' vuoto.
+ *
+ * \retval NULL se non e' stato possibile allocare il blocco (errno settato)
+ * \retval chunk puntatore al blocco, con next a NULL
+ */
+FileChunk *allocChunk(void);
+
+/**
+ * @brief Restituisce al pool tutti i blocchi della lista 'chunks'.
+ */
+void freeChunks(FileChunk *chunks);
+
+/**
+ * @brief Dealloca i blocchi liberi del pool. Deve essere chiamata da un solo thread quando nessun altro thread sta usando il pool.
+ */
+void deleteChunkPool(void);
+
+#endif
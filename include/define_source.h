@@ -7,4 +7,9 @@
     #define _POSIX_C_SOURCE 200809L
 #endif
 
+// syscall() e le altre estensioni di glibc usate per futex e io_uring
+#if !defined(_DEFAULT_SOURCE)
+    #define _DEFAULT_SOURCE
+#endif
+
 #endif
\ No newline at end of file
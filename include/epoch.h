@@ -0,0 +1,39 @@
+#ifndef EPOCH_H
+#define EPOCH_H
+
+/** Reclamation basata su epoche (stile RCU). I lettori racchiudono gli accessi ai dati condivisi tra epochEnter ed
+ *  epochExit senza prendere nessuna lock; chi rimuove un dato lo rende irraggiungibile e lo passa a epochRetire, che lo
+ *  dealloca solo quando tutti i lettori che potevano vederlo sono usciti dalla loro epoca.
+ *
+ */
+
+/**
+ * @brief Entra in una sezione di lettura: i dati letti da qui a epochExit non verranno deallocati. Le sezioni non possono
+ * essere annidate.
+ *
+ * \retval 0 se successo
+ * \retval -1 se errore (errno settato)
+ */
+int epochEnter(void);
+
+/**
+ * @brief Esce dalla sezione di lettura aperta con epochEnter.
+ */
+void epochExit(void);
+
+/**
+ * @brief Dealloca 'ptr' con la funzione 'freeFunc' quando nessun lettore puo' piu' accederci. Si assume che 'ptr' sia gia'
+ * stato reso irraggiungibile dalle strutture condivise.
+ *
+ * \retval 0 se successo
+ * \retval -1 se errore (errno settato)
+ */
+int epochRetire(void *ptr, void (*freeFunc)(void *));
+
+/**
+ * @brief Dealloca tutti i dati ancora in attesa e le strutture dei thread. Deve essere chiamata da un solo thread quando
+ * nessun altro thread sta usando le epoche (tipicamente il thread main alla chiusura del server).
+ */
+void epochCleanup(void);
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef EVENTCOUNT_H
+#define EVENTCOUNT_H
+
+#include <stdint.h>
+
+#define EVENT_WAITERS 1U // bit basso del futex: qualche thread attende l'evento
+
+/** Contatore di eventi su un futex: i bit alti contano le notifiche, quello basso (EVENT_WAITERS) dice se qualche thread
+ *  si e' addormentato (o sta per farlo) dall'ultima notifica. Chi aspetta una condizione si registra con
+ *  eventPrepareWait, la ricontrolla e solo se e' ancora falsa chiama eventWait; chi la rende vera chiama eventNotify, che
+ *  costa una chiamata di sistema solo se c'e' qualcuno da svegliare.
+ *
+ */
+typedef unsigned int EventCount;
+
+/**
+ * @brief Registra il thread chiamante tra quelli in attesa di 'event'. La condizione attesa va ricontrollata dopo la
+ *  registrazione e prima di eventWait.
+ *
+ * \retval valore da passare a eventWait
+ */
+unsigned int eventPrepareWait(EventCount *event);
+
+/**
+ * @brief Addormenta il thread chiamante finche' 'event' vale 'val', cioe' fino alla prossima notifica (o ad un risveglio
+ *  spurio: il chiamante deve ricontrollare la condizione).
+ */
+void eventWait(EventCount *event, unsigned int val);
+
+/**
+ * @brief Come eventWait, ma attende al massimo 'timeout' nanosecondi.
+ *
+ * \retval 0 se il thread e' stato svegliato (o il valore era gia' cambiato)
+ * \retval -1 se e' scaduto il timeout (errno = ETIMEDOUT)
+ */
+int eventTimedWait(EventCount *event, unsigned int val, uint64_t timeout);
+
+/**
+ * @brief Segnala che la condizione attesa su 'event' e' cambiata: se qualcuno si e' registrato incrementa il contatore,
+ *  azzera EVENT_WAITERS e sveglia tutti i thread in attesa. Le modifiche fatte prima della chiamata sono visibili a chi
+ *  ricontrolla la condizione dopo eventPrepareWait.
+ */
+void eventNotify(EventCount *event);
+
+#endif /* EVENTCOUNT_H */
@@ -15,13 +15,15 @@ typedef struct fd_list
 } fdList;
 
 fdNode *initNode(int fd);
-void deleteNode(fdNode *node);
+// accetta un void * per poter essere passata come funzione di deallocazione (ad esempio a epochRetire)
+void deleteNode(void *node);
 fdList *initList();
 void deleteList(fdList **list);
 fdNode *getNode(fdList *list, int key);
 fdNode *popNode(fdList *list);
 /**
- * @brief Cerca il nodo con la chive 'key' nella lista
+ * @brief Cerca il nodo con la chive 'key' nella lista. Puo' essere eseguita senza lock in concorrenza con insertNode e
+ * getNode, purche' i nodi rimossi con getNode vengano deallocati solo quando nessun lettore puo' piu' raggiungerli.
  *
  * @param list lista in cui cercare
  * @param key chiave del nodo
@@ -30,6 +32,10 @@ fdNode *popNode(fdList *list);
  */
 int findNode(fdList *list, int key);
 int insertNode(fdList *list, int fd);
+/**
+ * @brief Accoda i nodi della lista 'src' alla lista '*dest'. Se 'src' non e' vuota viene consumata: diventa '*dest' se
+ * questa e' NULL, altrimenti viene deallocata.
+ */
 void concanateList(fdList **dest, fdList *src);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,115 @@
+#ifndef FDSET_H
+#define FDSET_H
+
+#include <stddef.h>
+
+#define FDSET_INLINE 4   // fd salvati nella struttura prima di passare alla bitmap
+#define FDQUEUE_INLINE 4 // fd in attesa salvati nella struttura prima di allocare il buffer circolare
+
+/** Bitmap indicizzata per fd: il bit fd e' settato se l'fd fa parte dell'insieme. */
+typedef struct fdBitmap
+{
+    size_t nbits; // multiplo del numero di bit di un unsigned long
+    unsigned long bits[];
+} FdBitmap;
+
+/** Insieme di fd: i primi FDSET_INLINE vengono salvati nella struttura, oltre si passa ad una bitmap allocata che cresce
+ *  con l'fd massimo, cosi' inserimenti, rimozioni e ricerche costano O(1) e aprire un file non alloca memoria.
+ *  Le modifiche vanno serializzate dal chiamante, fdSetContains puo' essere eseguita senza lock in concorrenza con esse
+ *  all'interno di una sezione epochEnter/epochExit, purche' nessun altro thread possa inserire o rimuovere l'fd cercato:
+ *  gli slot e le bitmap sostituite non vengono piu' modificati e il bit di un fd resta valido in tutte le copie.
+ *
+ */
+typedef struct fdSet
+{
+    int inlineFds[FDSET_INLINE]; // 0 se lo slot e' libero, non piu' usati dopo il passaggio alla bitmap
+    FdBitmap *bitmap; // NULL finche' gli fd entrano negli slot
+} FdSet;
+
+/** Coda FIFO di fd in un buffer circolare: i primi FDQUEUE_INLINE fd vengono salvati nella struttura, oltre il buffer
+ *  viene allocato e raddoppiato quando si riempie. Non e' thread-safe.
+ *
+ */
+typedef struct fdQueue
+{
+    int inlineFds[FDQUEUE_INLINE];
+    int *buf; // inlineFds o un buffer allocato di 'capacity' posizioni
+    size_t capacity; // potenza di 2
+    size_t head;
+    size_t count;
+} FdQueue;
+
+/**
+ * @brief Inizializza l'insieme vuoto 'set'.
+ */
+void initFdSet(FdSet *set);
+
+/**
+ * @brief Aggiunge 'fd' all'insieme 'set', se non e' gia' presente.
+ *
+ * \retval 0 se successo
+ * \retval -1 se errore (errno settato)
+ */
+int fdSetInsert(FdSet *set, int fd);
+
+/**
+ * @brief Rimuove 'fd' dall'insieme 'set'.
+ *
+ * \retval 1 se l'fd era presente
+ * \retval 0 altrimenti
+ */
+int fdSetRemove(FdSet *set, int fd);
+
+/**
+ * @brief Cerca 'fd' nell'insieme 'set', anche senza lock (vedi FdSet).
+ *
+ * \retval 1 se l'fd e' presente
+ * \retval 0 altrimenti
+ */
+int fdSetContains(FdSet *set, int fd);
+
+/**
+ * @brief Dealloca la bitmap dell'insieme 'set'. Si assume che nessun lettore possa piu' accederci.
+ */
+void destroyFdSet(FdSet *set);
+
+/**
+ * @brief Inizializza la coda vuota 'queue'.
+ */
+void initFdQueue(FdQueue *queue);
+
+/**
+ * @brief Accoda 'fd' alla coda 'queue'.
+ *
+ * \retval 0 se successo
+ * \retval -1 se errore (errno settato)
+ */
+int fdQueuePush(FdQueue *queue, int fd);
+
+/**
+ * @brief Estrae il primo fd della coda 'queue'.
+ *
+ * \retval 0 se la coda e' vuota
+ * \retval fd primo fd della coda
+ */
+int fdQueuePop(FdQueue *queue);
+
+/**
+ * @brief Rimuove 'fd' dalla coda 'queue' mantenendo l'ordine degli altri fd.
+ *
+ * \retval 1 se l'fd era presente
+ * \retval 0 altrimenti
+ */
+int fdQueueRemove(FdQueue *queue, int fd);
+
+/**
+ * @brief Ritorna il numero di fd nella coda 'queue'.
+ */
+size_t fdQueueLength(const FdQueue *queue);
+
+/**
+ * @brief Dealloca il buffer della coda 'queue'.
+ */
+void destroyFdQueue(FdQueue *queue);
+
+#endif
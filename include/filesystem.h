@@ -2,39 +2,116 @@
 #define FILESYSTEM_H
 
 #include <pthread.h>
+#include <stdint.h>
 #include <time.h>
+#include <sys/uio.h>
 
+#include "../include/chunk_pool.h"
 #include "../include/fdList.h"
+#include "../include/fdSet.h"
 #include "../include/icl_hash.h"
-#include "../include/boundedqueue.h"
+#include "../include/mpmcqueue.h"
 
 #define LOGGER_MSG_QUEUE_LEN 20
 
+#define FS_SHARDS_BITS 4
+#define FS_SHARDS (1 << FS_SHARDS_BITS) // numero di partizioni della tabella hash, ognuna con la propria lock
+#define FILE_INLINE_PATH 64                // i path piu' corti vengono salvati nella struttura del file senza allocarli
+
+struct lfuBucket;
+struct evictionPolicy;
+struct shards;
+struct sessionTable;
+struct scheduler;
+
+/** Path di una richiesta con lunghezza e hash (icl_hash_bytes), calcolati una sola volta quando il worker legge la
+ *  richiesta e usati per scegliere la partizione, per la ricerca nella tabella hash e per la stima della curva dei miss
+ *  ratio.
+ *
+ */
+typedef struct fsPath
+{
+    const char *name;
+    size_t len; // strlen(name)
+    uint64_t hash;
+} FsPath;
+
+/** Il contenuto di un file e' una lista di blocchi del pool. Le scritture in append riempiono i blocchi oltre 'dataSize' e
+ *  solo alla fine pubblicano la nuova dimensione: i bytes entro 'dataSize' non vengono piu' modificati e i lettori possono
+ *  leggerli senza prendere lock, all'interno di una sezione epochEnter/epochExit.
+ *
+ */
 typedef struct file
 {
-    char *path;
-    char *data;
-    size_t dataSize;
+    char *path; // punta a inlinePath se il path e' abbastanza corto
+    char inlinePath[FILE_INLINE_PATH];
+    size_t pathLen;
+    uint64_t hash; // hash del path, sceglie la partizione e la posizione nella tabella hash
+    FileChunk *chunks; // NULL se il file e' vuoto
+    FileChunk *lastChunk;
+    size_t dataSize; // bytes pubblicati, letto con __atomic_load_n dai lettori senza lock
 
     pthread_mutex_t fileLock;
     pthread_cond_t readWrite;
 
     short isWritten;
-    int nReaders;
+    int users; // thread che stanno operando sul file: il file puo' essere deallocato solo quando e' 0
+    short evicting; // il file e' stato scelto per essere espulso o rimosso, nessuna nuova operazione puo' iniziare
 
-    fdList *openedBy;
-    fdList *waitingForLock;
+    FdSet openedBy; // letto senza lock dai lettori, ognuno per il proprio fd
+    FdQueue waitingForLock;
     int lockedBy;
 
-    time_t insertionTime; // FIFO
-    time_t lastUsed; // LRU
+    uint64_t insertionTime; // FIFO, istante del clock logico del filesystem
+    uint64_t lastUsed; // LRU, istante del clock logico del filesystem
     size_t usedTimes; // LFU
-    short referenceBit; // Second-chance
+    short referenceBit; // Second-chance, S3-FIFO: letture del file (fino a S3FIFO_MAX_FREQ)
+
+    short queued; // il file e' nella coda di espulsione, protetto da queueLock
+    struct lfuBucket *bucket; // LFU: bucket della frequenza del file
+    short list; // ARC, W-TinyLFU, S3-FIFO: lista della politica in cui si trova il file
+    double priority; // GDSF: L + accessi / dimensione, protetta da queueLock
+    size_t heapIndex; // GDSF: posizione del file nello heap
 
-    struct file *prev;
+    struct file *prev; // lista della politica di rimpiazzamento in cui si trova il file
     struct file *next;
 } File;
 
+/** Partizione della tabella hash dei file: file con path diversi finiscono in partizioni diverse e possono essere
+ *  acceduti in parallelo.
+ *
+ */
+typedef struct fsShard
+{
+    pthread_mutex_t shardLock;
+    icl_hash_t *hashTable;
+} FsShard;
+
+/** Header di un file in un FileBuffer: dimensione del path, path e dimensione del file, come si aspetta il client.
+ *
+ */
+typedef struct fileHeader
+{
+    struct fileHeader *next;
+    char data[];
+} FileHeader;
+
+/** Insieme di file da inviare ad un client (letti o espulsi) descritto da un vettore di iovec che punta direttamente ai
+ *  blocchi dei file, senza copiarli. Deve essere inizializzato a zero e rilasciato con releaseFileBuffer dopo l'invio.
+ *
+ */
+typedef struct fileBuffer
+{
+    struct iovec *iov;
+    int iovcnt;
+    int iovcap;
+    size_t size; // bytes totali descritti da iov
+
+    FileHeader *headers;
+    File *evicted; // file espulsi, deallocati da releaseFileBuffer
+    int pinned; // il buffer punta a file ancora nel filesystem: epochExit in releaseFileBuffer
+} FileBuffer;
+
 typedef struct filesystem
 {
     size_t maxFiles;
@@ -45,17 +122,36 @@ typedef struct filesystem
     size_t currMemory;
     size_t absMaxMemory;
 
-    icl_hash_t *hastTable;
-    File *file_queue_head; // FIFO e Second-chance
-    File *file_queue_tail;
+    FsShard shards[FS_SHARDS];
+
+    const struct evictionPolicy *policy; // politica di rimpiazzamento, indicata da REPL_ALG
+    void *policyState; // strutture dati della politica, protette da queueLock
 
-    int replacement_algo;
+    uint64_t logicalClock; // clock logico monotono: ogni inserimento e ogni accesso ricevono un istante diverso
 
     size_t evictedFiles;
+    size_t evictedBytes;
+    size_t rejectedWrites; // W-TinyLFU: scritture non ammesse
+
+    size_t readHits; // letture di file presenti e di file non trovati, aggiornate con operazioni atomiche
+    size_t readMisses;
+    size_t droppedTouches; // letture non segnalate alla politica perche' la coda era occupata, aggiornato atomicamente
+
+    short evictorActive; // espulsione in background: il thread viene svegliato sopra le soglie alte
+    short evictorStop;
+    size_t highFiles, highMemory; // soglie alte, in file e bytes
+    size_t lowFiles, lowMemory; // soglie basse fino a cui il thread espelle file
+    pthread_cond_t evictorCond;
+
+    size_t backgroundEvictions; // file espulsi dal thread di espulsione
+    size_t syncEvictions; // richieste che hanno dovuto espellere file prima di proseguire
+
+    struct shards *mrc; // stima della curva dei miss ratio sugli accessi ai path
+    struct sessionTable *sessions; // file aperti, in lock o attesi da ogni client, per l'uscita dei client
 
-    BQueue_t *logger_msg_queue;
+    MPMCQueue_t *logger_msg_queue;
 
-    pthread_mutex_t fileSystemLock;
+    pthread_mutex_t queueLock; // protegge lo stato della politica di rimpiazzamento e i contatori di file e memoria
 } Filesystem;
 
 /**
@@ -68,7 +164,12 @@ typedef struct filesystem
  * @param dataSize bytes scritti/letti
  * @return 0 se successo, -1 altrimenti e errno settato
  */
-int logOperation(BQueue_t *logger_msg_queue, const char *op, const char *pathname, const int clientFd, const size_t dataSize);
+int logOperation(MPMCQueue_t *logger_msg_queue, const char *op, const char *pathname, const int clientFd, const size_t dataSize);
+
+/**
+ * @brief Inizializza 'path' con il path 'name', calcolandone lunghezza e hash. 'name' non viene copiato.
+ */
+void initFsPath(FsPath *path, const char *name);
 
 /**
  * @brief Alloca e inizializza un filesystem con capacita' massima di 'maxFiles' files e una memoria massima di 'maxMemory' Mbytes.
@@ -82,19 +183,55 @@ int logOperation(BQueue_t *logger_msg_queue, const char *op, const char *pathnam
 Filesystem *initFileSystem(size_t maxFiles, size_t maxMemory, int replacement_algo);
 
 /**
- * @brief Dealloca il filesystem 'fs'. Si assume che il chiamante abbia la mutua esclusione sul filesystem.
+ * @brief Dealloca il filesystem 'fs'. Si assume che nessun altro thread stia operando sul filesystem.
  * 
  * @param fs puntatore al filesystem
  */
 void deleteFileSystem(Filesystem *fs);
 
 /**
- * @brief Stampa il path e la dimensione di tutti i file presenti nel filesytem. Si assume che il chiamante abbia la mutua esclusione sul filesystem.
+ * @brief Stampa il path e la dimensione di tutti i file presenti nel filesytem. Si assume che nessun altro thread stia operando sul filesystem.
  * 
  * @param fs puntatore al filesystem
  */
 void printFileSystem(Filesystem *fs);
 
+/**
+ * @brief Attiva l'espulsione in background per il filesystem 'fs': quando i file o la memoria occupata superano
+ *  'highWatermark' per cento di MAXFILES o MAXMEMORY il thread evictInBackground espelle file finche' entrambi non
+ *  scendono sotto 'lowWatermark' per cento. Da chiamare prima di avviare il thread.
+ *
+ * \retval 0 se successo
+ * \retval -1 se le soglie non sono valide (errno settato a EINVAL)
+ */
+int setWatermarks(Filesystem *fs, size_t highWatermark, size_t lowWatermark);
+
+/**
+ * @brief Routine del thread di espulsione in background. I file espulsi non vengono inviati a nessun client.
+ *
+ * @param args puntatore al filesystem
+ */
+void *evictInBackground(void *args);
+
+/**
+ * @brief Chiede la terminazione del thread di espulsione in background del filesystem 'fs'.
+ */
+void stopBackgroundEviction(Filesystem *fs);
+
+/**
+ * @brief Costruisce il report testuale delle statistiche del filesystem 'fs': file e memoria occupati, espulsioni, hit
+ *  ratio delle letture e miss ratio stimato per diverse dimensioni della cache, seguite da quelle del pool di worker.
+ *
+ * @param fs puntatore al filesystem
+ * @param sched scheduler dei worker, NULL in modalita' multi-reactor
+ * @param buf puntatore al report allocato, terminato da '\0', da deallocare con free
+ * @param size dimensione del report, incluso il terminatore
+ *
+ * \retval 0 se successo
+ * \retval -1 se errore (errno settato opportunatamente)
+ */
+int getStatsHandler(Filesystem *fs, struct scheduler *sched, char **buf, size_t *size);
+
 /**
  * @brief apre un file del filesystem.
  *
@@ -106,7 +243,7 @@ void printFileSystem(Filesystem *fs);
  * \retval 0 se successo
  * \retval -1 se errore (errno settato opportunatamente)
  */
-int openFileHandler(Filesystem *fs, const char *path, int openFlags, fdList **signalForLock, int clientFd);
+int openFileHandler(Filesystem *fs, const FsPath *path, int openFlags, fdList **signalForLock, int clientFd);
 
 /**
  * @brief Scrive un file nel filesystem. (Le scritture avvengono solo in append)
@@ -115,40 +252,45 @@ int openFileHandler(Filesystem *fs, const char *path, int openFlags, fdList **si
  * @param path path del file da scrivere
  * @param data puntatore hai dati da scrivere
  * @param dataSize dimensione dei dati da scrivere
+ * @param evicted buffer a cui vengono aggiunti i file espulsi, da rilasciare con releaseFileBuffer
  * @param clientFd fd del processo che ha richiesto l'operazione
  *
  * \retval 0 se successo
- * \retval -1 se errore (errno settato opportunatamente)
+ * \retval -1 se errore (errno settato opportunatamente, ECANCELED se W-TinyLFU non ha ammesso i dati nella cache)
  */
-int writeFileHandler(Filesystem *fs, const char *path, void *data, size_t dataSize, void **evicted_files, size_t *evicted_files_size, fdList **signalForLock, int clientFd);
+int writeFileHandler(Filesystem *fs, const FsPath *path, void *data, size_t dataSize, FileBuffer *evicted, fdList **signalForLock, int clientFd);
 
 /**
  * @brief Legge un file dal filesystem
  *
  * @param fs puntatore al filesystem
  * @param path path del file da leggere
- * @param data_buf buffer su cui scrivere il file
- * @param dataSize dimensione del file letto
+ * @param buf buffer a cui vengono aggiunti i blocchi del file (senza header), da rilasciare con releaseFileBuffer
  * @param clientFd fd del processo che ha richiesto l'operazione
  *
  * \retval 0 se successo
  * \retval -1 se errore (errno settato opportunatamente)
  */
-int readFileHandler(Filesystem *fs, const char *path, void **data_buf, size_t *dataSize, int clientFd);
+int readFileHandler(Filesystem *fs, const FsPath *path, FileBuffer *buf, int clientFd);
 
 /**
- * @brief Legge fino a 'upperLimit' files dal server e li salva nel buffer 'data_buf' di dimensione 'dataSize'
+ * @brief Legge fino a 'upperLimit' files dal server e li aggiunge al buffer 'buf'
  *
  * @param fs puntatore al filesystem
  * @param upperLimit limite superiore di file da leggere
- * @param data_buf buffer su cui scrivere il file
- * @param dataSize dimensione del buffer
+ * @param buf buffer a cui vengono aggiunti i file, da rilasciare con releaseFileBuffer
  * @param clientFd fd del processo che ha richiesto l'operazione
  *
  * \retval numero dei file letti >= 0 se successo
  * \retval -1 se errore (errno settato opportunatamente)
  */
-int readNFilesHandler(Filesystem *fs, const int upperLimit, void **data_buf, size_t *dataSize, int clientFd);
+int readNFilesHandler(Filesystem *fs, const int upperLimit, FileBuffer *buf, int clientFd);
+
+/**
+ * @brief Rilascia le risorse del buffer 'buf' riempito da readFileHandler, readNFilesHandler o writeFileHandler. Da
+ * chiamare solo dopo che i dati sono stati inviati. Il buffer puo' essere riusato.
+ */
+void releaseFileBuffer(FileBuffer *buf);
 
 /**
  * @brief richiesta di acquisire la lock sul file 'path' del filesystem 'fs' da parte del processo 'clientFd'.
@@ -160,7 +302,7 @@ int readNFilesHandler(Filesystem *fs, const int upperLimit, void **data_buf, siz
  * \retval 0 se successo
  * \retval -1 se errore (errno settato opportunatamente)
  */
-int lockFileHandler(Filesystem *fs, const char *path, int clientFd);
+int lockFileHandler(Filesystem *fs, const FsPath *path, int clientFd);
 
 /**
  * @brief richiesta di rilasciare la lock sul file 'path' del filesystem 'fs' da parte del processo 'clientFd'.
@@ -173,7 +315,7 @@ int lockFileHandler(Filesystem *fs, const char *path, int clientFd);
  * \retval 0 se successo
  * \retval -1 se errore (errno settato opportunatamente)
  */
-int unlockFileHandler(Filesystem *fs, const char *path, int *nextLockFd, int clientFd);
+int unlockFileHandler(Filesystem *fs, const FsPath *path, int *nextLockFd, int clientFd);
 
 /**
  * @brief richiesta di rimuovere il file 'path' dal filesystem 'fs' da parte del processo 'clientFd'. In 'signalForLock' viene ritornato il puntatore alla lista dei client in attesa per la lock
@@ -186,7 +328,7 @@ int unlockFileHandler(Filesystem *fs, const char *path, int *nextLockFd, int cli
  * \retval 0 se successo
  * \retval -1 se errore (errno settato opportunatamente)
  */
-int removeFileHandler(Filesystem *fs, const char *path, fdList **signalForLock, int clientFd);
+int removeFileHandler(Filesystem *fs, const FsPath *path, fdList **signalForLock, int clientFd);
 
 /**
  * @brief richiesta di chiudere il file 'path' dal filesystem 'fs' da parte del processo 'clientFd'.
@@ -198,7 +340,7 @@ int removeFileHandler(Filesystem *fs, const char *path, fdList **signalForLock,
  * \retval 0 se successo
  * \retval -1 se errore (errno settato opportunatamente)
  */
-int closeFileHandler(Filesystem *fs, const char *path, int clientFd);
+int closeFileHandler(Filesystem *fs, const FsPath *path, int clientFd);
 
 /**
  * @brief 
@@ -221,5 +363,5 @@ int clientExitHandler(Filesystem *fs, fdList **signalForLock, int clientFd);
  * \retval 0 se successo
  * \retval -1 se errore (errno settato opportunatamente)
  */
-int canWrite(Filesystem *fs, const char *path, int clientFd);
+int canWrite(Filesystem *fs, const FsPath *path, int clientFd);
 #endif
\ No newline at end of file
@@ -10,6 +10,8 @@
 #ifndef icl_hash_h
 #define icl_hash_h
 
+#include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 
 #if defined(c_plusplus) || defined(__cplusplus)
@@ -21,16 +23,30 @@ extern "C"
     {
         void *key;
         void *data;
-        struct icl_entry_s *next;
+        uint64_t hash; /* cached hash of the key */
+        size_t len;    /* cached length of the key */
     } icl_entry_t;
 
+    /* open addressing table: one control byte per slot, probed a group at a time */
+    typedef struct icl_table_s
+    {
+        size_t capacity;     /* power of 2, multiple of the group width */
+        size_t used;         /* full and deleted slots */
+        unsigned char *ctrl; /* empty, deleted or the 7 high bits of the hash of the key in the slot */
+        icl_entry_t *slots;
+    } icl_table_t;
+
     typedef struct icl_hash_s
     {
-        int nbuckets;
+        int nbuckets; /* slots of the current table */
         int nentries;
-        icl_entry_t **buckets;
-        unsigned int (*hash_function)(void *);
+        icl_table_t *table;
+        icl_table_t *old;  /* table being migrated into 'table' by the writers, NULL if none */
+        size_t migrated;   /* slots of 'old' already migrated */
+        unsigned long seq; /* odd while a writer is modifying the tables */
+        uint64_t (*hash_function)(void *);
         int (*hash_key_compare)(void *, void *);
+        int (*retire)(void *, void (*)(void *)); /* deferred free of the replaced tables, NULL to free them at once */
     } icl_hash_t;
 
     typedef struct icl_hash_iter_s
@@ -41,15 +57,19 @@ extern "C"
     } icl_hash_iter_t;
 
     icl_hash_t *
-    icl_hash_create(int nbuckets, unsigned int (*hash_function)(void *), int (*hash_key_compare)(void *, void *));
+    icl_hash_create(int nbuckets, uint64_t (*hash_function)(void *), int (*hash_key_compare)(void *, void *));
+
+    void icl_hash_set_retire(icl_hash_t *ht, int (*retire)(void *, void (*)(void *)));
 
     void
         *
-        icl_hash_find(icl_hash_t *, void *);
+        icl_hash_find(icl_hash_t *, void *),
+        *icl_hash_find_hashed(icl_hash_t *, void *, size_t, uint64_t);
 
     icl_entry_t
         *
         icl_hash_insert(icl_hash_t *, void *, void *),
+        *icl_hash_insert_hashed(icl_hash_t *, void *, size_t, uint64_t, void *),
         *icl_hash_update_insert(icl_hash_t *, void *, void *, void **);
 
     int
@@ -58,30 +78,36 @@ extern "C"
         icl_hash_iterator_destroy(icl_hash_iter_t *ht_iter),
         icl_hash_next(icl_hash_iter_t* iter);
 
-    int icl_hash_delete(icl_hash_t *ht, void *key, void (*free_key)(void *), void (*free_data)(void *));
+    int icl_hash_delete(icl_hash_t *ht, void *key, void (*free_key)(void *), void (*free_data)(void *)),
+        icl_hash_delete_hashed(icl_hash_t *ht, void *key, size_t len, uint64_t hash, void (*free_key)(void *), void (*free_data)(void *));
+
+    size_t icl_hash_capacity(icl_hash_t *ht);
+
+    icl_entry_t *icl_hash_slot(icl_hash_t *ht, size_t index);
 
     icl_hash_iter_t
         *icl_hash_iterator_create(icl_hash_t *ht);
 
-    /* simple hash function */
-    unsigned int
-    hash_pjw(void *key);
+    /* hash functions */
+    uint64_t
+    icl_hash_bytes(const void *data, size_t len),
+        hash_string(void *key);
 
     /* compare function */
     int
     string_compare(void *a, void *b);
 
-#define icl_hash_foreach(ht, tmpint, tmpent, kp, dp, action)                                                                                       \
-    for (tmpint = 0; tmpint < ht->nbuckets; tmpint++)                                                                                              \
-    {                                                                                                                                              \
-        for (tmpent = ht->buckets[tmpint]; tmpent != NULL && ((kp = tmpent->key) != NULL) && ((dp = tmpent->data) != NULL); tmpent = tmpent->next) \
-        {                                                                                                                                          \
-            action;                                                                                                                                \
-        }                                                                                                                                          \
+#define icl_hash_foreach(ht, tmpint, tmpent, kp, dp, action)                                                               \
+    for (tmpint = 0; tmpint < icl_hash_capacity(ht); tmpint++)                                                             \
+    {                                                                                                                      \
+        if ((tmpent = icl_hash_slot(ht, tmpint)) != NULL && ((kp = tmpent->key) != NULL) && ((dp = tmpent->data) != NULL)) \
+        {                                                                                                                  \
+            action;                                                                                                        \
+        }                                                                                                                  \
     }
 
 #if defined(c_plusplus) || defined(__cplusplus)
 }
 #endif
 
-#endif /* icl_hash_h */
\ No newline at end of file
+#endif /* icl_hash_h */
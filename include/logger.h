@@ -6,6 +6,7 @@
 #include <linux/limits.h>
 
 #define STOP_MSG "STOP"
+#define LOGGER_BATCH 32 // messaggi estratti dalla coda e scritti sul file con un solo fflush
 
 typedef struct fileLogger {
     char logFilePath[PATH_MAX]; //percorso del file di log
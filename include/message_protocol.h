@@ -11,6 +11,7 @@
 #define UNLOCK_FILE 7
 #define REMOVE_FILE 8
 #define CLOSE_FILE 9
+#define STATS 10 // statistiche del server e curva dei miss ratio stimata
 
 #define SUCCESS 1 // operazione terminata con successo
 #define INVALID_REQ 2 // richiesta invalida
@@ -20,6 +21,7 @@
 #define FILE_LOCK 6 // file in stato di lock
 #define BIG_FILE 7 // file troppo grande per essere salvato sul server
 #define INVALID_RES 8 // risposta invalida dal server
+#define NOT_ADMITTED 9 // i dati non sono stati ammessi nella cache dal filtro di ammissione (W-TinyLFU)
 
 #define CLIENT_LEFT_MSG "0000"
 #endif
\ No newline at end of file
@@ -0,0 +1,95 @@
+#ifndef MPMC_QUEUE_H
+#define MPMC_QUEUE_H
+
+#include <stddef.h>
+
+#include "../include/eventcount.h"
+
+#define MPMC_CACHE_LINE 64 // i contatori dei produttori e dei consumatori stanno su linee di cache diverse
+#define MPMC_SPIN 64       // tentativi prima di addormentarsi sul futex, se c'e' piu' di un processore
+
+/** Posizione della coda: 'seq' dice se la posizione e' libera per il giro corrente dei produttori (seq == pos) o
+ *  contiene un dato per i consumatori (seq == pos + 1).
+ *
+ */
+typedef struct mpmcCell
+{
+    size_t seq;
+    void *data;
+} MPMCCell;
+
+/** Coda limitata multi-produttore multi-consumatore senza lock (Vyukov): produttori e consumatori si contendono solo il
+ *  proprio contatore con una CAS e si sincronizzano sul numero di sequenza di ogni posizione. I thread si addormentano
+ *  su un futex solo quando la coda e' davvero vuota (o piena), e chi inserisce (o estrae) fa la chiamata di sistema per
+ *  svegliarli solo se qualcuno si e' addormentato dall'ultima notifica.
+ *
+ */
+typedef struct MPMCQueue
+{
+    MPMCCell *buf;
+    size_t mask; // dimensione - 1, la dimensione e' una potenza di 2
+    int spin; // tentativi prima di addormentarsi: con un solo processore l'altro thread non puo' avanzare mentre si aspetta
+    char pad0[MPMC_CACHE_LINE - sizeof(MPMCCell *) - sizeof(size_t) - sizeof(int)];
+
+    size_t enqueuePos;
+    char pad1[MPMC_CACHE_LINE - sizeof(size_t)];
+
+    size_t dequeuePos;
+    char pad2[MPMC_CACHE_LINE - sizeof(size_t)];
+
+    EventCount notEmpty; // attesa dei consumatori
+    EventCount notFull;  // attesa dei produttori
+} MPMCQueue_t;
+
+/** Alloca ed inizializza una coda di almeno \param n posizioni (arrotondate alla potenza di 2 successiva).
+ *
+ *   \retval NULL se si sono verificati problemi nell'allocazione (errno settato)
+ *   \retval q puntatore alla coda allocata
+ */
+MPMCQueue_t *initMPMCQueue(size_t n);
+
+/** Cancella una coda allocata con initMPMCQueue, chiamando \param F sui dati rimasti se non e' NULL. Nessun altro thread
+ *  deve usare la coda.
+ */
+void deleteMPMCQueue(MPMCQueue_t *q, void (*F)(void *));
+
+/** Inserisce un dato nella coda, attendendo se e' piena.
+ *   \param data puntatore al dato da inserire (non NULL)
+ *
+ *   \retval 0 se successo
+ *   \retval -1 se errore (errno settato opportunamente)
+ */
+int mpmcPush(MPMCQueue_t *q, void *data);
+
+/** Estrae un dato dalla coda, attendendo se e' vuota.
+ *
+ *  \retval data puntatore al dato estratto (NULL se errore, errno settato)
+ */
+void *mpmcPop(MPMCQueue_t *q);
+
+/** Inserisce in ordine gli \param n dati di \param data, riservando con una sola CAS tutte le posizioni libere
+ *  consecutive e attendendo solo se la coda e' piena.
+ *
+ *   \retval 0 se successo
+ *   \retval -1 se errore (errno settato opportunamente)
+ */
+int mpmcPushBatch(MPMCQueue_t *q, void **data, size_t n);
+
+/** Estrae fino a \param n dati in \param data con una sola CAS, attendendo solo se la coda e' vuota.
+ *
+ *  \retval numero di dati estratti (almeno 1)
+ *  \retval 0 se errore (errno settato)
+ */
+size_t mpmcPopBatch(MPMCQueue_t *q, void **data, size_t n);
+
+/** Estrae un dato dalla coda senza attendere.
+ *
+ *  \retval data puntatore al dato estratto
+ *  \retval NULL se la coda e' vuota o se errore (errno settato)
+ */
+void *mpmcTryPop(MPMCQueue_t *q);
+
+/** Ritorna una stima del numero di dati nella coda, che puo' essere gia' cambiato quando il chiamante la usa. */
+size_t mpmcLength(MPMCQueue_t *q);
+
+#endif /* MPMC_QUEUE_H */
@@ -0,0 +1,103 @@
+#ifndef POLICY_H
+#define POLICY_H
+
+#include "../include/filesystem.h"
+
+// algoritmi di rimpiazzamento, indicati dall'opzione REPL_ALG del file di configurazione
+#define FIFO 0
+#define LRU 1
+#define LFU 2
+#define SECOND_CHANCE 3
+#define ARC 4
+#define GDSF 5
+#define TINYLFU 6 // W-TinyLFU: finestra LRU e filtro di ammissione davanti a una coda LRU
+#define S3FIFO 7  // S3-FIFO: coda FIFO piccola di prova, coda FIFO principale e ghost
+#define N_POLICIES 8
+
+// accessi ad un file segnalati alle politiche
+#define TOUCH_NONE 0
+#define TOUCH_ACCESS 1 // operazione di un client su un file che ha gia' aperto
+#define TOUCH_OPEN 2   // apertura di un file gia' presente: per ARC e' un hit
+#define TOUCH_READ 3   // lettura di un file: per S3-FIFO e' l'unico accesso che conta
+
+/** Politica di rimpiazzamento dei file. Ogni politica tiene i file nelle proprie strutture dati, allocate da 'init' in
+ *  fs->policyState e collegate tramite i campi del file riservati alle politiche, e sceglie la vittima senza confrontare
+ *  tra loro tutti i file.
+ *  Tutti gli hook vengono chiamati con la lock sulla coda del filesystem (queueLock), tranne on_access per le politiche
+ *  con 'lockFreeAccess', che deve limitarsi ad aggiornare i campi del file con operazioni atomiche. Gli hook indicati
+ *  come opzionali possono essere NULL.
+ *
+ */
+typedef struct evictionPolicy
+{
+    const char *name;
+    int lockFreeAccess; // on_access viene chiamata senza lock, anche su file non ancora inseriti o gia' rimossi
+
+    /**
+     * @brief Alloca lo stato della politica in fs->policyState.
+     *
+     * \retval 0 se successo
+     * \retval -1 se errore (errno settato)
+     */
+    int (*init)(Filesystem *fs);
+
+    /**
+     * @brief Dealloca lo stato della politica. I file possono essere ancora collegati alle sue strutture.
+     */
+    void (*destroy)(Filesystem *fs);
+
+    /**
+     * @brief Il file 'file' e' stato aggiunto al filesystem.
+     */
+    void (*on_insert)(Filesystem *fs, File *file);
+
+    /**
+     * @brief Un client ha eseguito un'operazione di tipo 'kind' (TOUCH_*) sul file 'file'. Opzionale.
+     */
+    void (*on_access)(Filesystem *fs, File *file, int kind);
+
+    /**
+     * @brief La dimensione del file 'file' sta per diventare 'size' bytes. Opzionale.
+     */
+    void (*on_resize)(Filesystem *fs, File *file, size_t size);
+
+    /**
+     * @brief Il file 'file' lascia il filesystem perche' espulso ('evicted' diverso da 0) o rimosso da un client.
+     */
+    void (*on_remove)(Filesystem *fs, File *file, int evicted);
+
+    /**
+     * @brief Un client ha richiesto il path 'path' di un file non presente. Opzionale.
+     */
+    void (*on_miss)(Filesystem *fs, const char *path);
+
+    /**
+     * @brief Sceglie il file da espellere per fare posto al file 'toAdd' (NULL se si sta creando un nuovo file). Vengono
+     *  scartati 'toAdd' e i file in uso da altri thread. La politica puo' riordinare le proprie strutture, ma il file
+     *  scelto resta collegato finche' non viene chiamata on_remove.
+     *
+     * \retval NULL se non c'e' una vittima (errno settato a EBUSY se i possibili file da espellere sono in uso, ENOENT
+     *  se non ci sono file da espellere, ECANCELED se la politica non ammette i dati di 'toAdd')
+     * \retval victim il file da espellere
+     */
+    File *(*choose_victim)(Filesystem *fs, File *toAdd);
+
+    /**
+     * @brief Stampa lo stato interno della politica. Opzionale.
+     */
+    void (*stats)(Filesystem *fs);
+} EvictionPolicy;
+
+/**
+ * @brief Ritorna la politica di rimpiazzamento con codice 'replacement_algo'.
+ *
+ * \retval NULL se il codice non e' valido (errno settato a EINVAL)
+ */
+const EvictionPolicy *getPolicy(int replacement_algo);
+
+/**
+ * @brief Stampa il nome e lo stato interno della politica di rimpiazzamento del filesystem 'fs'.
+ */
+void printPolicyStats(Filesystem *fs);
+
+#endif
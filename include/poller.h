@@ -0,0 +1,41 @@
+#ifndef POLLER_H
+#define POLLER_H
+
+#include <string.h>
+#include <sys/epoll.h>
+
+/**
+ * @brief Registra 'fd' nell'istanza epoll 'epoll_fd' in lettura. Se 'oneshot' e' settato l'fd viene disabilitato dopo il primo evento
+ * e deve essere riarmato con rearmFd.
+ *
+ * @return 0 se successo, -1 altrimenti e errno settato
+ */
+static inline int addFd(int epoll_fd, int fd, int oneshot)
+{
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+
+    ev.events = EPOLLIN | (oneshot ? EPOLLONESHOT : 0);
+    ev.data.fd = fd;
+
+    return epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+}
+
+/**
+ * @brief Riarma l'fd 'fd' di un client precedentemente registrato con EPOLLONESHOT. E' thread-safe e puo' essere chiamata
+ * direttamente dai thread worker.
+ *
+ * @return 0 se successo, -1 altrimenti e errno settato
+ */
+static inline int rearmFd(int epoll_fd, int fd)
+{
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+
+    ev.events = EPOLLIN | EPOLLONESHOT;
+    ev.data.fd = fd;
+
+    return epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &ev);
+}
+
+#endif
@@ -0,0 +1,126 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "../include/eventcount.h"
+#include "../include/mpmcqueue.h"
+
+#define SCHED_WAIT_BINS 20 // classi dell'istogramma delle attese: la classe i conta quelle sotto 2^i microsecondi
+#define SCHED_WAIT_DECAY 3 // ogni attesa pesa 1/2^SCHED_WAIT_DECAY nella media mobile delle attese
+#define SCHED_OVERLOAD_PASSES 3 // distribuzioni consecutive in sovraccarico prima di aggiungere un worker
+
+/** Distribuzione dei client pronti ad un pool elastico di worker con work stealing: ogni worker ha la propria coda, in cui
+ *  il manager inserisce i client scegliendo la coda piu' corta tra quelle dei worker attivi, cosi' quelli accodati non
+ *  restano dietro ad un worker bloccato nel filesystem (ad esempio in attesa della lock di un file). Un worker serve prima
+ *  i client della propria coda e, quando e' vuota, li ruba dalle code degli altri; solo se sono tutte vuote si addormenta
+ *  su 'idle', che il manager notifica dopo ogni inserimento.
+ *  Il pool ha tra 'minWorkers' e 'nQueues' worker: il manager ne aggiunge uno quando le code restano lunghe o l'attesa
+ *  media dei client resta alta per piu' distribuzioni (schedulerOverloaded, schedulerAddWorker), cosi' un'attesa isolata
+ *  (un worker che si risveglia, uno svuotamento di io_uring) non fa crescere il pool. Un worker oltre il minimo termina
+ *  dopo 'idleTimeout' nanosecondi senza trovare client. I client rimasti nella coda di un worker terminato vengono rubati
+ *  dagli altri.
+ *
+ */
+typedef struct scheduler
+{
+    MPMCQueue_t **queues; // una coda per ogni worker possibile
+    char *running; // 1 se il worker e' attivo: il manager inserisce client solo nelle code dei worker attivi
+    size_t nQueues; // numero massimo di worker
+    size_t minWorkers;
+    size_t nWorkers; // worker attivi
+    uint64_t idleTimeout; // 0 se i worker non terminano per inattivita'
+    size_t next; // coda da cui il manager inizia a cercare la piu' corta, per distribuire i client a parita' di lunghezza
+    EventCount idle; // attesa dei worker che non hanno trovato client in nessuna coda
+
+    // statistiche, aggiornate con operazioni atomiche
+    uint64_t avgWait; // media mobile esponenziale delle attese in coda dei client, in nanosecondi
+    size_t overloadedPasses; // distribuzioni consecutive in sovraccarico, usato solo dal manager
+    size_t waitHist[SCHED_WAIT_BINS];
+    size_t *sizeHist; // nQueues + 1 contatori: worker attivi ad ogni distribuzione di client
+    size_t peakWorkers;
+    size_t spawned;
+    size_t retired;
+} Scheduler;
+
+/**
+ * @brief Alloca uno scheduler per un pool da 'minWorkers' a 'maxWorkers' worker, ognuno con una coda di almeno
+ *  'queueLen' posizioni. I worker oltre il minimo terminano dopo 'idleTimeout' millisecondi di inattivita' (0 mai).
+ *  Nessun worker e' attivo finche' non viene aggiunto con schedulerAddWorker.
+ *
+ * \retval NULL se errore (errno settato)
+ * \retval puntatore allo scheduler allocato
+ */
+Scheduler *initScheduler(size_t minWorkers, size_t maxWorkers, size_t queueLen, long idleTimeout);
+
+/**
+ * @brief Dealloca lo scheduler 'sched', chiamando 'F' sui dati rimasti nelle code se non e' NULL. Nessun worker deve
+ *  usarlo.
+ */
+void deleteScheduler(Scheduler *sched, void (*F)(void *));
+
+/**
+ * @brief Riserva il posto di un nuovo worker attivo. Il chiamante deve poi avviare il thread che usera' l'indice
+ *  ritornato, dopo aver atteso la terminazione di quello che lo usava prima.
+ *
+ * \retval indice del worker
+ * \retval -1 se il pool ha gia' il numero massimo di worker (errno = EAGAIN)
+ */
+long schedulerAddWorker(Scheduler *sched);
+
+/**
+ * @brief Controlla se conviene aggiungere un worker: il pool non e' al massimo e, per SCHED_OVERLOAD_PASSES chiamate
+ *  consecutive, i client in coda sono almeno 'depth' o la media mobile delle attese in coda supera 'wait' millisecondi
+ *  (0 disattiva il controllo). Deve essere chiamata dal thread di schedulerDispatch, dopo ogni distribuzione.
+ *
+ * \retval 1 se conviene aggiungere un worker
+ * \retval 0 altrimenti
+ */
+int schedulerOverloaded(Scheduler *sched, size_t depth, long wait);
+
+/**
+ * @brief Inserisce gli 'n' dati di 'data', ognuno nella coda piu' corta tra quelle dei worker attivi, e sveglia i worker
+ *  addormentati. Deve essere chiamata da un solo thread.
+ *
+ * \retval 0 se successo
+ * \retval -1 se errore (errno settato)
+ */
+int schedulerDispatch(Scheduler *sched, void **data, size_t n);
+
+/**
+ * @brief Inserisce 'data' nella coda di ogni worker attivo (ad esempio un messaggio di terminazione) e sveglia i worker
+ *  addormentati. Deve essere chiamata dallo stesso thread di schedulerDispatch.
+ *
+ * \retval 0 se successo
+ * \retval -1 se errore (errno settato)
+ */
+int schedulerBroadcast(Scheduler *sched, void *data);
+
+/**
+ * @brief Estrae il prossimo dato per il worker 'worker': dalla propria coda, altrimenti da quella di un altro worker,
+ *  attendendo se sono tutte vuote. Se l'attesa supera il timeout di inattivita' e il pool ha piu' del numero minimo di
+ *  worker, il worker viene rimosso dal pool e deve terminare.
+ *
+ * \retval data puntatore al dato estratto
+ * \retval NULL se il worker e' stato rimosso (errno = ETIMEDOUT) o se errore (errno settato)
+ */
+void *schedulerNext(Scheduler *sched, size_t worker);
+
+/**
+ * @brief Registra che un dato e' rimasto in coda per 'wait' nanosecondi, nell'istogramma e nella media mobile.
+ */
+void schedulerRecordWait(Scheduler *sched, uint64_t wait);
+
+/**
+ * @brief Ritorna l'istante corrente in nanosecondi (CLOCK_MONOTONIC), da usare per misurare l'attesa in coda.
+ */
+uint64_t schedulerNow(void);
+
+/**
+ * @brief Stampa su 'out' la dimensione del pool e gli istogrammi dei worker attivi e delle attese in coda.
+ */
+void schedulerPrintStats(Scheduler *sched, FILE *out);
+
+#endif /* SCHEDULER_H */
@@ -0,0 +1,74 @@
+#ifndef SESSION_H
+#define SESSION_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../include/icl_hash.h"
+
+#define SESSION_BUCKETS 8 // dimensione iniziale della tabella dei path di una sessione
+
+/** Sessione di un client: i path dei file che ha aperto, su cui ha la lock o di cui attende la lock. Un path resta nella
+ *  sessione anche se il file viene rimosso o espulso: all'uscita del client non verra' trovato o, se e' stato ricreato,
+ *  il client non comparira' nelle sue liste.
+ *
+ */
+typedef struct clientSession
+{
+    icl_hash_t *paths; // path -> path, le chiavi sono copie possedute dalla sessione
+    short incomplete; // un inserimento e' fallito: la sessione potrebbe non contenere tutti i file del client
+} ClientSession;
+
+/** Sessioni dei client connessi, indicizzate per fd. Le richieste di un client vengono servite da un thread alla volta
+ *  (il client viene riarmato solo alla fine di ogni richiesta), quindi la sessione di un fd e' usata solo dal thread che
+ *  sta servendo quel client e non servono lock.
+ *
+ */
+typedef struct sessionTable
+{
+    ClientSession **sessions;
+    size_t size; // fd massimo + 1, i client con fd maggiori non hanno una sessione
+} SessionTable;
+
+/**
+ * @brief Alloca una tabella delle sessioni per tutti gli fd che il processo puo' aprire.
+ *
+ * \retval NULL se errore (errno settato)
+ * \retval table puntatore alla tabella allocata
+ */
+SessionTable *initSessionTable(void);
+
+/**
+ * @brief Aggiunge alla sessione del client 'fd' il path 'path' di lunghezza 'len' e hash 'hash' (calcolato con
+ *  icl_hash_bytes), creando la sessione se non esiste. Se fallisce la sessione viene segnata come incompleta.
+ *
+ * \retval 0 se successo
+ * \retval -1 se errore (errno settato)
+ */
+int sessionAdd(SessionTable *table, int fd, const char *path, size_t len, uint64_t hash);
+
+/**
+ * @brief Rimuove il path 'path' dalla sessione del client 'fd', se presente.
+ */
+void sessionRemove(SessionTable *table, int fd, const char *path, size_t len, uint64_t hash);
+
+/**
+ * @brief Toglie dalla tabella la sessione del client 'fd' e la ritorna al chiamante, che dovra' deallocarla con
+ *  deleteSession. In 'complete' viene ritornato 0 se la sessione potrebbe non contenere tutti i file del client.
+ *
+ * \retval NULL se il client non ha una sessione
+ * \retval session sessione del client
+ */
+ClientSession *detachSession(SessionTable *table, int fd, int *complete);
+
+/**
+ * @brief Dealloca la sessione 'session'.
+ */
+void deleteSession(ClientSession *session);
+
+/**
+ * @brief Dealloca la tabella 'table' e le sessioni rimaste.
+ */
+void deleteSessionTable(SessionTable *table);
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef SHARDS_H
+#define SHARDS_H
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define SHARDS_MODULUS (1 << 24)      // un path viene campionato se (hash mod SHARDS_MODULUS) < soglia
+#define SHARDS_INITIAL_RATE 100       // frazione iniziale dei path campionati: 1/SHARDS_INITIAL_RATE
+#define SHARDS_MAX_SAMPLES 8192       // path campionati oltre i quali la soglia viene dimezzata
+#define SHARDS_BINS 32                // dimensioni di cache per cui viene stimato il miss ratio
+#define SHARDS_BINS_PER_CACHE 8       // la curva arriva a SHARDS_BINS / SHARDS_BINS_PER_CACHE volte MAXMEMORY
+
+/** Path campionato: hash, istante dell'ultimo accesso e dimensione del file a quell'accesso. */
+typedef struct shardsSample
+{
+    uint64_t key; // 0 se la posizione della tabella e' libera
+    size_t slot;
+    size_t size;
+} ShardsSample;
+
+/** Stima della curva dei miss ratio (MRC) di una cache LRU con SHARDS: vengono seguiti solo i path il cui hash cade
+ *  sotto una soglia, cioe' un campione spaziale di frequenza R dei file, e per ogni loro accesso si calcola la reuse
+ *  distance in bytes (bytes dei file campionati diversi acceduti dall'accesso precedente allo stesso path) che, divisa
+ *  per R, stima quella sull'intero carico. Un accesso e' un hit in una cache LRU di C bytes se la distanza piu' la
+ *  dimensione del file non supera C, quindi un solo istogramma delle distanze da' il miss ratio per ogni dimensione.
+ *  I path campionati sono al piu' SHARDS_MAX_SAMPLES: oltre, la soglia viene dimezzata e i path che non la rispettano
+ *  piu' vengono dimenticati, cosi' la memoria resta costante qualunque sia il numero di file. Gli accessi a path non
+ *  campionati costano solo un confronto e non prendono la lock.
+ *
+ */
+typedef struct shards
+{
+    pthread_mutex_t lock; // protegge i campi seguenti, tranne threshold che viene letta con operazioni atomiche
+    uint64_t threshold;
+
+    ShardsSample *samples; // tabella ad indirizzamento aperto di 2 * SHARDS_MAX_SAMPLES posizioni
+    ShardsSample *scratch; // SHARDS_MAX_SAMPLES posizioni usate per compattare la tabella
+    size_t nSamples;
+
+    size_t *tree;    // Fenwick tree sugli istanti: in ogni istante la dimensione del path acceduto per ultimo allora
+    size_t nextSlot; // istante del prossimo accesso, gli istanti vengono compattati quando finiscono
+
+    size_t binSize; // ampiezza in bytes di un intervallo dell'istogramma
+    double hist[SHARDS_BINS]; // accessi stimati con distanza piu' dimensione nell'intervallo i-esimo
+    double far;               // accessi stimati oltre l'ultimo intervallo o primi accessi ad un path
+    double total;
+    size_t sampled; // accessi campionati
+} Shards;
+
+/**
+ * @brief Alloca uno stimatore della curva dei miss ratio per cache fino a 'maxCache' * SHARDS_BINS /
+ *  SHARDS_BINS_PER_CACHE bytes.
+ *
+ * \retval NULL se errore (errno settato)
+ * \retval shards puntatore allo stimatore allocato
+ */
+Shards *initShards(size_t maxCache);
+
+/**
+ * @brief Registra un accesso al path con hash 'hash' (a 64 bit, con i bit bassi ben distribuiti) di un file di 'size'
+ *  bytes (0 se il file non esiste).
+ */
+void shardsAccess(Shards *shards, uint64_t hash, size_t size);
+
+/**
+ * @brief Scrive su 'out' la frequenza di campionamento e il miss ratio stimato per ogni dimensione della cache.
+ */
+void shardsPrint(Shards *shards, FILE *out);
+
+/**
+ * @brief Dealloca lo stimatore 'shards'.
+ */
+void deleteShards(Shards *shards);
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef SKETCH_H
+#define SKETCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define SKETCH_DEPTH 4         // righe del count-min sketch, ognuna indicizzata da un hash diverso
+#define SKETCH_MAX_COUNT 15    // i contatori saturano, come contatori da 4 bit
+#define SKETCH_SAMPLE_FACTOR 10 // incrementi (per contatore di riga) dopo i quali tutti i contatori vengono dimezzati
+
+/** Count-min sketch che stima la frequenza di accesso recente di un path, anche se il file non e' (piu') nel filesystem.
+ *  Ogni incremento tocca un contatore per riga e la stima e' il minimo tra questi, quindi puo' solo sovrastimare. Dopo
+ *  'sampleSize' incrementi tutti i contatori vengono dimezzati (aging), cosi' la stima segue i cambiamenti del carico.
+ *  Non e' thread safe: si assume la mutua esclusione del chiamante.
+ *
+ */
+typedef struct freqSketch
+{
+    uint8_t *counters; // SKETCH_DEPTH righe di 'width' contatori
+    size_t width;      // potenza di 2
+    size_t additions;
+    size_t sampleSize;
+} FreqSketch;
+
+/**
+ * @brief Alloca uno sketch adatto a stimare la frequenza di circa 'capacity' path diversi.
+ *
+ * \retval NULL se errore (errno settato)
+ * \retval sketch puntatore allo sketch allocato
+ */
+FreqSketch *initSketch(size_t capacity);
+
+/**
+ * @brief Registra un accesso al path 'key'.
+ */
+void sketchIncrement(FreqSketch *sketch, const char *key);
+
+/**
+ * @brief Ritorna la frequenza stimata del path 'key'.
+ */
+unsigned int sketchFrequency(FreqSketch *sketch, const char *key);
+
+/**
+ * @brief Dealloca lo sketch 'sketch'.
+ */
+void deleteSketch(FreqSketch *sketch);
+
+#endif
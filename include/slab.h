@@ -0,0 +1,85 @@
+#ifndef SLAB_H
+#define SLAB_H
+
+#include <pthread.h>
+#include <stddef.h>
+
+#define SLAB_BLOCK_SIZE (16 * 1024)     // dimensione e allineamento di un blocco di oggetti, deve essere una potenza di 2
+#define SLAB_BATCH 32                   // oggetti scambiati in una volta tra la cache di un thread e il deposito
+#define SLAB_LOCAL_MAX (2 * SLAB_BATCH) // oggetti liberi oltre i quali un thread restituisce un lotto al deposito
+
+/** Allocatore a slab per oggetti di dimensione fissa. Gli oggetti vengono ritagliati da blocchi di SLAB_BLOCK_SIZE bytes e
+ *  ogni thread ne tiene una piccola cache locale: allocazioni e deallocazioni non prendono lock e non passano per malloc,
+ *  se non quando la cache locale scambia un lotto di oggetti con il deposito condiviso. I blocchi vengono restituiti al
+ *  sistema solo da slabCleanup.
+ *
+ */
+typedef struct slabCache
+{
+    const char *name;
+    size_t objSize;
+    int ready;              // chiave e registrazione vengono inizializzate alla prima allocazione
+    pthread_key_t localKey; // cache locale di ogni thread
+
+    pthread_mutex_t lock; // protegge i campi seguenti
+    void *depot;          // oggetti liberi condivisi tra i thread
+    size_t nDepot;
+    void *blocks;
+    size_t nBlocks;
+    struct slabLocal *locals; // cache locali dei thread attivi
+    size_t allocs;            // contatori dei thread terminati o senza cache locale
+    size_t frees;
+
+    struct slabCache *next; // cache registrate
+} SlabCache;
+
+/** Inizializzatore statico di una cache di oggetti di 'size' bytes. */
+#define SLAB_CACHE_INITIALIZER(cacheName, size) \
+    {                                           \
+        .name = (cacheName),                    \
+        .objSize = (size),                      \
+        .lock = PTHREAD_MUTEX_INITIALIZER       \
+    }
+
+typedef struct slabStats
+{
+    size_t objSize;  // dimensione degli oggetti, arrotondata all'allineamento
+    size_t blocks;   // blocchi allocati
+    size_t capacity; // oggetti ritagliati dai blocchi
+    size_t inUse;    // oggetti allocati e non ancora restituiti
+} SlabStats;
+
+/**
+ * @brief Alloca un oggetto (non azzerato) dalla cache 'cache'.
+ *
+ * \retval NULL se errore (errno settato)
+ * \retval obj puntatore all'oggetto
+ */
+void *slabAlloc(SlabCache *cache);
+
+/**
+ * @brief Restituisce alla sua cache l'oggetto 'obj' allocato con slabAlloc. Puo' essere passata come funzione di
+ * deallocazione (ad esempio a epochRetire) e puo' essere chiamata da un thread diverso da quello che ha allocato l'oggetto.
+ */
+void slabFree(void *obj);
+
+/**
+ * @brief Legge i contatori di utilizzo della cache 'cache'.
+ *
+ * \retval 0 se successo
+ * \retval -1 se errore (errno settato)
+ */
+int slabGetStats(SlabCache *cache, SlabStats *stats);
+
+/**
+ * @brief Stampa i contatori di utilizzo di tutte le cache usate.
+ */
+void slabPrintStats(void);
+
+/**
+ * @brief Dealloca i blocchi di tutte le cache. Deve essere chiamata da un solo thread quando nessun altro thread sta usando
+ * gli oggetti allocati (tipicamente il thread main alla chiusura del server).
+ */
+void slabCleanup(void);
+
+#endif
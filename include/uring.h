@@ -0,0 +1,65 @@
+#ifndef URING_H
+#define URING_H
+
+#include <stddef.h>
+#include <sys/types.h>
+
+#define URING_ENTRIES 64
+#define URING_BUF_SIZE (64 * 1024)
+
+/** Motore di I/O basato su io_uring. Ogni thread worker ne possiede uno: le letture vengono servite da un buffer registrato
+ *  nel kernel riempito con una sola submission, mentre le scritture vengono accodate e inviate in blocco (anche verso client
+ *  diversi) con una sola io_uring_enter in ioEngineFlush.
+ *
+ */
+typedef struct ioEngine IoEngine;
+
+/**
+ * @brief Alloca e inizializza un motore io_uring con 'entries' submission e buffer registrati di 'bufSize' bytes.
+ *
+ * \retval NULL se io_uring non e' disponibile o c'e' stato un errore (errno settato): il chiamante usera' le normali syscall
+ * \retval io puntatore al motore allocato
+ */
+IoEngine *initIoEngine(unsigned entries, size_t bufSize);
+
+/**
+ * @brief Dealloca il motore 'io' inviando prima le scritture ancora in coda.
+ */
+void deleteIoEngine(IoEngine *io);
+
+/**
+ * @brief Legge esattamente 'len' bytes dall'fd 'fd' (come readn). Se ci sono scritture in coda vengono prima inviate.
+ *
+ * \retval 0 se successo (o EOF)
+ * \retval -1 se errore (errno settato)
+ */
+int ioEngineRead(IoEngine *io, int fd, void *buf, size_t len);
+
+/**
+ * @brief Accoda la scrittura di 'len' bytes del buffer 'buf' sull'fd 'fd'. Se 'copy' e' settato i dati vengono copiati nel buffer
+ * registrato del motore, altrimenti 'buf' deve restare valido fino alla successiva ioEngineFlush.
+ *
+ * \retval 0 se successo
+ * \retval -1 se errore (errno settato)
+ */
+int ioEngineWrite(IoEngine *io, int fd, const void *buf, size_t len, int copy);
+
+/**
+ * @brief Invia tutte le scritture in coda con una sola submission e ne attende il completamento.
+ *
+ * \retval 0 se successo
+ * \retval -1 se almeno una scrittura e' fallita (errno settato)
+ */
+int ioEngineFlush(IoEngine *io);
+
+/**
+ * @brief Ritorna il numero di bytes gia' letti dall'fd 'fd' e non ancora consumati (richieste inviate in pipeline dal client).
+ */
+size_t ioEngineBuffered(IoEngine *io, int fd);
+
+/**
+ * @brief Scarta i bytes letti e non consumati dell'fd 'fd' (ad esempio perche' il client e' uscito).
+ */
+void ioEngineDiscard(IoEngine *io, int fd);
+
+#endif
@@ -8,14 +8,20 @@
 #include <string.h>
 #include <time.h>
 #include <unistd.h>
+#include <sys/uio.h>
 
 #define BUF_SIZE 1024
 #define UNIX_PATH_MAX 108
 #define EOS (void *)0x1
 
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
 #define ARRAY_SIZE(arr) (sizeof(arr) / sizeof((arr)[0]))
 
 #define MAX(a, b) ((a) > (b)) ? (a) : (b)
+#define MIN(a, b) (((a) < (b)) ? (a) : (b))
 
 #define SYSCALL_EQ_RETURN(syscall, val, ...) \
     if (syscall(__VA_ARGS__) == val)         \
@@ -211,4 +217,37 @@ static inline int writen(long fd, void *buf, size_t size)
     return 0;
 }
 
-#endif
\ No newline at end of file
+/**
+ * @brief Scrive tutti i bytes descritti dal vettore 'iov' di 'iovcnt' elementi (come writen). Il vettore viene modificato
+ * per tenere traccia delle scritture parziali.
+ */
+static inline int writevn(long fd, struct iovec *iov, int iovcnt)
+{
+    ssize_t r;
+    while (iovcnt > 0)
+    {
+        if ((r = writev((int)fd, iov, MIN(iovcnt, IOV_MAX))) == -1)
+        {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        if (r == 0)
+            break;
+        // salto le iovec scritte completamente
+        while (iovcnt > 0 && (size_t)r >= iov->iov_len)
+        {
+            r -= iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+        if (iovcnt > 0)
+        {
+            iov->iov_base = (char *)iov->iov_base + r;
+            iov->iov_len -= r;
+        }
+    }
+    return 0;
+}
+
+#endif
@@ -1,15 +1,49 @@
 #ifndef WORKER_H
 #define WORKER_H
 
-#include "../include/boundedqueue.h"
 #include "../include/filesystem.h"
+#include "../include/scheduler.h"
+#include "../include/uring.h"
+
+#define IO_ENGINE_SYSCALL 0
+#define IO_ENGINE_URING 1
+
+/** Client pronto spedito dal manager ai worker attraverso lo scheduler */
+typedef struct clientRequest
+{
+    int fd;
+    uint64_t queuedAt; // istante dell'inserimento in coda (schedulerNow), per misurare l'attesa
+} ClientRequest;
 
 typedef struct threadArgs
 {
-    BQueue_t *queue;
+    Scheduler *scheduler; // code dei client pronti, una per worker
+    size_t id; // indice del worker, e della sua coda, nello scheduler
     Filesystem *fs;
-    int write_end_pipe_fd;
+    int write_end_pipe_fd; // pipe per notificare al manager l'uscita di un client
+    int epoll_fd; // istanza epoll su cui riarmare i client (in modalita' multi-reactor quella del worker)
+
+    int *fd_owner; // modalita' multi-reactor: istanza epoll a cui e' assegnato ogni client, NULL altrimenti
+    int stop_fd; // modalita' multi-reactor: eventfd con cui il manager chiede la terminazione del worker
+    size_t nClients; // modalita' multi-reactor: numero di client assegnati al worker
+
+    int io_engine; // IO_ENGINE_SYSCALL o IO_ENGINE_URING
+    IoEngine *io; // motore io_uring del worker, NULL se si usano le syscall
 } ThreadArgs;
 
+/**
+ * @brief Routine dei thread worker: estrae dallo scheduler gli fd dei client pronti (dalla propria coda o rubandoli da
+ * quelle degli altri worker) e ne serve le richieste.
+ *
+ * @param args puntatore agli argomenti del thread (ThreadArgs)
+ */
 void *processRequest(void *args);
+
+/**
+ * @brief Routine dei thread worker in modalita' multi-reactor: ogni worker attende sulla propria istanza epoll i soli client
+ * che gli sono stati assegnati dal manager e ne serve le richieste, senza passare da una coda condivisa.
+ *
+ * @param args puntatore agli argomenti del thread (ThreadArgs)
+ */
+void *processReactorRequests(void *args);
 #endif
\ No newline at end of file
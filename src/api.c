@@ -25,7 +25,8 @@ const char *responseMsg[] = {
     "Errore del server\n",
     "File in stato di lock\n",
     "File troppo grande per essere salvato sul server\n",
-    "Risposta invalida dal server\n"};
+    "Risposta invalida dal server\n",
+    "Dati non ammessi nella cache dal server\n"};
 
 #define PRINT_OP(op, file, outcome) \
     printf("%s: %s %s", #op, file, responseMsg[outcome - 1]);
@@ -36,7 +37,7 @@ const char *responseMsg[] = {
         int response_code;                                               \
         if (readn(fd_skt, &response_code, sizeof(int)) == -1 && toPrint) \
             PRINT_OP(op, file, INVALID_RES);                             \
-        if (response_code < SUCCESS || response_code > BIG_FILE)         \
+        if (response_code < SUCCESS || response_code > NOT_ADMITTED)     \
             response_code = INVALID_RES;                                 \
         if (toPrint)                                                     \
             PRINT_OP(op, file, response_code);                           \
@@ -50,7 +51,7 @@ char server_addr_path[UNIX_PATH_MAX];
 
 static int buildRequest(struct iovec request[], size_t request_len, int *op, size_t *request_msg_len, char *request_msg)
 {
-    if (request_len < 3 || (*op < CLOSE_CONNECTION || *op > CLOSE_FILE) || !request_msg || *request_msg_len <= 0)
+    if (request_len < 3 || (*op < CLOSE_CONNECTION || *op > STATS) || !request_msg || *request_msg_len <= 0)
     {
         errno = EINVAL;
         return -1;
@@ -87,7 +88,8 @@ int openConnection(const char *sockname, int msec, const struct timespec abstime
 
     while (connect(fd_skt, (const struct sockaddr *)&server_addr, sizeof(server_addr)) == -1)
     {
-        if (errno != ENOENT && errno != EAGAIN)
+        // il server potrebbe aver creato il socket senza essere ancora in ascolto
+        if (errno != ENOENT && errno != EAGAIN && errno != ECONNREFUSED)
             return -1;
 
         if (toPrint)
@@ -604,4 +606,41 @@ int closeFile(const char *pathname)
     SERVER_RESPONSE(closeFile, pathname);
 
     return errno ? -1 : 0;
-}
\ No newline at end of file
+}
+
+int getStats(char **buf, size_t *size)
+{
+    int op = STATS;
+
+    char request_buf[] = "";
+
+    size_t request_len = sizeof(request_buf);
+
+    struct iovec request[3];
+
+    if (!buf || !size)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    memset(request, 0, sizeof(request));
+
+    if (buildRequest(request, ARRAY_SIZE(request), &op, &request_len, request_buf) == -1)
+        return -1;
+
+    if (writev(fd_skt, request, ARRAY_SIZE(request)) == -1)
+        return -1;
+
+    SERVER_RESPONSE(getStats, "");
+
+    if (!errno)
+    {
+        *buf = readFileFromServer(fd_skt, size);
+
+        if (!(*buf))
+            return -1;
+    }
+
+    return errno ? -1 : 0;
+}
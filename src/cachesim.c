@@ -0,0 +1,642 @@
+#include "../include/define_source.h"
+
+#include <errno.h>
+#include <linux/limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../include/filesystem.h"
+#include "../include/icl_hash.h"
+#include "../include/policy.h"
+#include "../include/slab.h"
+#include "../include/utils.h"
+
+#define OP_READ 'r'
+#define OP_WRITE 'w'
+#define OP_APPEND 'a'
+#define OP_REMOVE 'd'
+
+#define MAX_SWEEP 32       // valori massimi per ogni parametro della simulazione
+#define MEGABYTE 1000000.0 // MAXMEMORY e' in Mbytes come nel file di configurazione del server
+
+#define DFL_MAXFILES "10"
+#define DFL_MAXMEMORY "100"
+
+#define TRACE_BUCKETS (1 << 18)
+#define LIST_LEN 256
+
+/** Operazione del trace: 'object' e' l'indice del path nella tabella dei path del trace.
+ *
+ */
+typedef struct traceOp
+{
+    char op;
+    size_t object;
+    size_t size;
+} TraceOp;
+
+typedef struct trace
+{
+    TraceOp *ops;
+    size_t len;
+    size_t cap;
+
+    char **paths;
+    size_t nPaths;
+    size_t pathsCap;
+
+    icl_hash_t *index; // path -> indice + 1, usato solo durante il caricamento
+} Trace;
+
+/** File simulato: la politica vede solo il File, l'indice del path serve a ritrovarlo quando viene espulso.
+ *
+ */
+typedef struct simFile
+{
+    File file; // primo campo: un File * della politica e' anche un SimFile *
+    size_t object;
+} SimFile;
+
+/** Cache simulata: del filesystem vengono usati solo i limiti, i contatori e la politica di rimpiazzamento. Le
+ *  operazioni vengono eseguite da un solo thread, quindi nessuna lock e' necessaria.
+ *
+ */
+typedef struct cacheSim
+{
+    Filesystem fs;
+    SimFile **objects; // per ogni path del trace il file in cache, NULL se non presente
+    uint64_t clock;
+
+    size_t readBytes; // bytes letti (dalla cache o dall'origine) e bytes trovati in cache
+    size_t hitBytes;
+} CacheSim;
+
+static SlabCache simFileCache = SLAB_CACHE_INITIALIZER("SimFile", sizeof(SimFile));
+
+/**
+ * @brief Ritorna l'indice del path 'path' nel trace 'trace', aggiungendolo se non presente.
+ *
+ * \retval -1 se errore (errno settato)
+ */
+static long internPath(Trace *trace, const char *path)
+{
+    char **paths;
+    void *found;
+
+    if ((found = icl_hash_find(trace->index, (void *)path)))
+        return (long)((uintptr_t)found - 1);
+
+    if (trace->nPaths == trace->pathsCap)
+    {
+        trace->pathsCap = trace->pathsCap ? 2 * trace->pathsCap : 1024;
+
+        if (!(paths = realloc(trace->paths, trace->pathsCap * sizeof(char *))))
+            return -1;
+
+        trace->paths = paths;
+    }
+
+    if (!(trace->paths[trace->nPaths] = strdup(path)))
+        return -1;
+
+    if (!icl_hash_insert(trace->index, trace->paths[trace->nPaths], (void *)(uintptr_t)(trace->nPaths + 1)))
+    {
+        free(trace->paths[trace->nPaths]);
+        errno = ENOMEM;
+        return -1;
+    }
+
+    return (long)trace->nPaths++;
+}
+
+/**
+ * @brief Aggiunge al trace 'trace' l'operazione 'op' sul path 'path' di 'size' bytes.
+ *
+ * \retval 0 se successo
+ * \retval -1 se errore (errno settato)
+ */
+static int addOp(Trace *trace, char op, const char *path, size_t size)
+{
+    TraceOp *ops;
+    long object;
+
+    if ((object = internPath(trace, path)) == -1)
+        return -1;
+
+    if (trace->len == trace->cap)
+    {
+        trace->cap = trace->cap ? 2 * trace->cap : 4096;
+
+        if (!(ops = realloc(trace->ops, trace->cap * sizeof(TraceOp))))
+            return -1;
+
+        trace->ops = ops;
+    }
+
+    trace->ops[trace->len].op = op;
+    trace->ops[trace->len].object = (size_t)object;
+    trace->ops[trace->len].size = size;
+    trace->len++;
+
+    return 0;
+}
+
+/**
+ * @brief Ritorna il codice dell'operazione 'name' del trace o del file di log del server, 0 se va ignorata.
+ */
+static char parseOp(const char *name)
+{
+    if (!strcmp(name, "r") || !strcmp(name, "read") || !strcmp(name, "readFile"))
+        return OP_READ;
+
+    if (!strcmp(name, "w") || !strcmp(name, "write"))
+        return OP_WRITE;
+
+    // la writeFile del server scrive in append
+    if (!strcmp(name, "a") || !strcmp(name, "append") || !strcmp(name, "writeFile") || !strcmp(name, "appendToFile"))
+        return OP_APPEND;
+
+    if (!strcmp(name, "d") || !strcmp(name, "remove") || !strcmp(name, "removeFile"))
+        return OP_REMOVE;
+
+    return 0;
+}
+
+/**
+ * @brief Carica il trace dal file 'tracePath'. Ogni riga e' un'operazione "op path [size]" con op r (lettura), w
+ *  (scrittura che sostituisce il contenuto del file), a (scrittura in append) o d (rimozione); le righe vuote e quelle
+ *  che iniziano con '#' vengono ignorate. E' accettato anche il file di log del server, di cui vengono usate le
+ *  operazioni readFile, writeFile (in append, come nel server) e removeFile.
+ *
+ * \retval 0 se successo
+ * \retval -1 se errore (errno settato)
+ */
+static int loadTrace(Trace *trace, const char *tracePath)
+{
+    FILE *file;
+    char *line = NULL,
+         *op,
+         *path,
+         *size,
+         *saveptr,
+         logOp = 0,
+         logPath[PATH_MAX] = "";
+    size_t lineCap = 0,
+           lineNo = 0;
+    long nBytes;
+    int err = 0;
+
+    if (!(file = fopen(tracePath, "r")))
+        return -1;
+
+    while (!err && getline(&line, &lineCap, file) != -1)
+    {
+        lineNo++;
+        line[strcspn(line, "\r\n")] = '\0';
+
+        // record del file di log: operationType, filePath e bytesProcessed su righe diverse
+        if (!strncmp(line, "operationType: ", 15))
+        {
+            logOp = parseOp(line + 15);
+            continue;
+        }
+
+        if (!strncmp(line, "filePath: ", 10))
+        {
+            strncpy(logPath, line + 10, PATH_MAX - 1);
+            continue;
+        }
+
+        if (!strncmp(line, "bytesProcessed: ", 16))
+        {
+            if (logOp && *logPath && isNumber(line + 16, &nBytes) == 0)
+                err = addOp(trace, logOp, logPath, (size_t)nBytes);
+
+            logOp = 0;
+            continue;
+        }
+
+        if (!(op = strtok_r(line, " \t", &saveptr)) || *op == '#' || strchr(line, ':'))
+            continue;
+
+        path = strtok_r(NULL, " \t", &saveptr);
+        size = strtok_r(NULL, " \t", &saveptr);
+        nBytes = 0;
+
+        if (!parseOp(op) || !path || (size && (isNumber(size, &nBytes) != 0 || nBytes < 0)))
+        {
+            fprintf(stderr, "%s:%zu: operazione non valida\n", tracePath, lineNo);
+            continue;
+        }
+
+        err = addOp(trace, parseOp(op), path, (size_t)nBytes);
+    }
+
+    free(line);
+    fclose(file);
+
+    return err;
+}
+
+static void freeTrace(Trace *trace)
+{
+    size_t i;
+
+    if (trace->index)
+        icl_hash_destroy(trace->index, NULL, NULL);
+
+    for (i = 0; i < trace->nPaths; i++)
+        free(trace->paths[i]);
+
+    free(trace->paths);
+    free(trace->ops);
+}
+
+/**
+ * @brief Registra un accesso di tipo 'kind' al file 'file', come touchFile nel filesystem.
+ */
+static void simTouch(CacheSim *sim, SimFile *file, int kind)
+{
+    file->file.lastUsed = ++sim->clock;
+    file->file.usedTimes++;
+
+    if (sim->fs.policy->on_access)
+        sim->fs.policy->on_access(&(sim->fs), &(file->file), kind);
+}
+
+/**
+ * @brief Rimuove il file 'file' dalla cache, come espulso se 'evicted' e' settato.
+ */
+static void simRemove(CacheSim *sim, SimFile *file, int evicted)
+{
+    sim->fs.policy->on_remove(&(sim->fs), &(file->file), evicted);
+
+    sim->fs.currFiles--;
+    sim->fs.currMemory -= file->file.dataSize;
+
+    if (evicted)
+    {
+        sim->fs.evictedFiles++;
+        sim->fs.evictedBytes += file->file.dataSize;
+    }
+
+    sim->objects[file->object] = NULL;
+    slabFree(file);
+}
+
+/**
+ * @brief Espelle la vittima scelta dalla politica per fare posto al file 'toAdd' (NULL per un nuovo file).
+ *
+ * \retval 0 se successo
+ * \retval -1 se non c'e' una vittima (errno settato come da choose_victim)
+ */
+static int simEvict(CacheSim *sim, SimFile *toAdd)
+{
+    File *victim;
+
+    if (!(victim = sim->fs.policy->choose_victim(&(sim->fs), toAdd ? &(toAdd->file) : NULL)))
+        return -1;
+
+    simRemove(sim, (SimFile *)victim, 1);
+
+    return 0;
+}
+
+/**
+ * @brief Crea il file vuoto 'object', espellendo un file se la cache ha gia' MAXFILES file.
+ *
+ * \retval NULL se errore (errno settato)
+ */
+static SimFile *simCreate(CacheSim *sim, size_t object, char *path)
+{
+    SimFile *file;
+
+    while (sim->fs.currFiles >= sim->fs.maxFiles)
+    {
+        if (simEvict(sim, NULL) == -1)
+            return NULL;
+    }
+
+    if (!(file = slabAlloc(&simFileCache)))
+        return NULL;
+
+    memset(file, 0, sizeof(*file));
+    file->file.path = path;
+    file->file.insertionTime = file->file.lastUsed = ++sim->clock;
+    file->file.usedTimes = 1;
+    file->object = object;
+
+    sim->fs.policy->on_insert(&(sim->fs), &(file->file));
+    file->file.queued = 1;
+
+    sim->fs.currFiles++;
+    sim->objects[object] = file;
+
+    return file;
+}
+
+/**
+ * @brief Porta il file 'file' a 'size' bytes, espellendo altri file se la memoria non basta, come una writeFile che
+ *  registra un solo accesso al file.
+ *
+ * \retval 0 se successo
+ * \retval -1 se i dati non sono stati scritti e il file e' rimasto com'era (errno settato a ECANCELED se la politica non
+ *  li ha ammessi)
+ */
+static int simWrite(CacheSim *sim, SimFile *file, size_t size)
+{
+    simTouch(sim, file, TOUCH_ACCESS);
+
+    while (sim->fs.currMemory - file->file.dataSize + size > sim->fs.maxMemory)
+    {
+        if (simEvict(sim, file) == -1)
+        {
+            if (errno == ECANCELED)
+                sim->fs.rejectedWrites++;
+
+            return -1;
+        }
+    }
+
+    sim->fs.currMemory = sim->fs.currMemory - file->file.dataSize + size;
+
+    if (sim->fs.policy->on_resize)
+        sim->fs.policy->on_resize(&(sim->fs), &(file->file), size);
+
+    file->file.dataSize = size;
+
+    return 0;
+}
+
+/**
+ * @brief Crea il file 'object' e lo scrive, come un client con openFile(O_CREATE | O_LOCK), writeFile e closeFile: la
+ *  politica vede l'inserimento e un solo accesso. Un file i cui dati non vengono scritti e' rimosso: in cache resta solo
+ *  cio' che e' stato ammesso.
+ */
+static void simInsert(CacheSim *sim, size_t object, char *path, size_t size)
+{
+    SimFile *file;
+
+    if (!(file = simCreate(sim, object, path)))
+        return;
+
+    if (simWrite(sim, file, size) == -1)
+        simRemove(sim, file, 0);
+}
+
+/**
+ * @brief Esegue l'operazione 'op' del trace 'trace', con la sequenza di richieste che invierebbe un client. Come nel
+ *  server, ogni operazione su un file gia' in cache registra due accessi, l'apertura (TOUCH_OPEN) e la lettura
+ *  (TOUCH_READ) o la scrittura (TOUCH_ACCESS), cosi' le politiche basate sulla frequenza pesano allo stesso modo letture
+ *  e scritture; la chiusura non registra accessi.
+ */
+static void simStep(CacheSim *sim, Trace *trace, TraceOp *op)
+{
+    SimFile *file = sim->objects[op->object];
+
+    switch (op->op)
+    {
+    case OP_READ:
+        if (!file)
+        {
+            // openFile senza O_CREATE fallisce, poi il file viene letto dall'origine e inserito
+            sim->fs.readMisses++;
+            sim->readBytes += op->size;
+
+            if (sim->fs.policy->on_miss)
+                sim->fs.policy->on_miss(&(sim->fs), trace->paths[op->object]);
+
+            simInsert(sim, op->object, trace->paths[op->object], op->size);
+            break;
+        }
+
+        // il server invia il contenuto del file in cache, non la dimensione registrata nel trace
+        sim->fs.readHits++;
+        sim->readBytes += file->file.dataSize;
+        sim->hitBytes += file->file.dataSize;
+
+        simTouch(sim, file, TOUCH_OPEN);
+        simTouch(sim, file, TOUCH_READ);
+        break;
+
+    case OP_WRITE:
+    case OP_APPEND:
+        if (!file)
+        {
+            simInsert(sim, op->object, trace->paths[op->object], op->size);
+            break;
+        }
+
+        simTouch(sim, file, TOUCH_OPEN);
+        simWrite(sim, file, op->op == OP_APPEND ? file->file.dataSize + op->size : op->size);
+        break;
+
+    case OP_REMOVE:
+        if (file)
+            simRemove(sim, file, 0);
+        break;
+    }
+}
+
+/**
+ * @brief Riproduce il trace 'trace' su una cache con politica 'policy', 'maxFiles' file e 'maxMemory' bytes e stampa i
+ *  risultati.
+ *
+ * \retval 0 se successo
+ * \retval -1 se errore (errno settato)
+ */
+static int simulate(Trace *trace, int policy, size_t maxFiles, size_t maxMemory)
+{
+    CacheSim sim;
+    struct timespec start,
+        end;
+    double seconds;
+    size_t i;
+
+    memset(&sim, 0, sizeof(sim));
+
+    sim.fs.maxFiles = maxFiles;
+    sim.fs.maxMemory = maxMemory;
+
+    if (!(sim.fs.policy = getPolicy(policy)))
+        return -1;
+
+    if (!(sim.objects = calloc(trace->nPaths, sizeof(SimFile *))))
+        return -1;
+
+    if (sim.fs.policy->init(&(sim.fs)) == -1)
+    {
+        free(sim.objects);
+        return -1;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for (i = 0; i < trace->len; i++)
+        simStep(&sim, trace, &(trace->ops[i]));
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+    printf("%-14s %9zu %10.2f %9.2f%% %9.2f%% %9zu %13zu %9zu %9.2f\n", sim.fs.policy->name, maxFiles, maxMemory / MEGABYTE,
+           sim.fs.readHits + sim.fs.readMisses ? 100.0 * sim.fs.readHits / (sim.fs.readHits + sim.fs.readMisses) : 0.0,
+           sim.readBytes ? 100.0 * sim.hitBytes / sim.readBytes : 0.0, sim.fs.evictedFiles, sim.fs.evictedBytes,
+           sim.fs.rejectedWrites, seconds > 0 ? trace->len / seconds / 1e6 : 0.0);
+
+    for (i = 0; i < trace->nPaths; i++)
+    {
+        if (sim.objects[i])
+            slabFree(sim.objects[i]);
+    }
+
+    sim.fs.policy->destroy(&(sim.fs));
+    free(sim.objects);
+
+    return 0;
+}
+
+/**
+ * @brief Legge in 'values' la lista di numeri separati da virgola 'list', moltiplicati per 'scale', che devono essere
+ *  almeno 'min'.
+ *
+ * \retval n numero di valori letti
+ * \retval -1 se la lista non e' valida
+ */
+static int parseList(char *list, double scale, double min, size_t *values)
+{
+    char *token,
+        *end,
+        *saveptr;
+    double value;
+    int n = 0;
+
+    for (token = strtok_r(list, ",", &saveptr); token; token = strtok_r(NULL, ",", &saveptr))
+    {
+        errno = 0;
+        value = strtod(token, &end);
+
+        if (errno || end == token || *end || value * scale < min || n == MAX_SWEEP)
+            return -1;
+
+        values[n++] = (size_t)(value * scale);
+    }
+
+    return n ? n : -1;
+}
+
+static void usage(const char *prog)
+{
+    printf("Uso: %s [-a algoritmi] [-f maxFiles] [-m maxMemory] trace\n"
+           "  -a lista di REPL_ALG separati da virgola (default: tutti)\n"
+           "  -f lista di valori di MAXFILES separati da virgola (default: " DFL_MAXFILES ")\n"
+           "  -m lista di valori di MAXMEMORY in Mbytes separati da virgola (default: " DFL_MAXMEMORY ")\n"
+           "Ogni riga del trace e' un'operazione \"op path [size]\", con op r (lettura), w (scrittura che sostituisce il\n"
+           "contenuto), a (scrittura in append) o d (rimozione).\n"
+           "E' accettato anche il file di log del server.\n",
+           prog);
+}
+
+int main(int argc, char *argv[])
+{
+    char algList[LIST_LEN] = "",
+         filesList[LIST_LEN] = DFL_MAXFILES,
+         memoryList[LIST_LEN] = DFL_MAXMEMORY;
+    size_t algs[MAX_SWEEP],
+        files[MAX_SWEEP],
+        memory[MAX_SWEEP];
+    int nAlgs,
+        nFiles,
+        nMemory,
+        opt,
+        a, f, m;
+    Trace trace;
+
+    while ((opt = getopt(argc, argv, "ha:f:m:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'a':
+            strncpy(algList, optarg, sizeof(algList) - 1);
+            break;
+        case 'f':
+            strncpy(filesList, optarg, sizeof(filesList) - 1);
+            break;
+        case 'm':
+            strncpy(memoryList, optarg, sizeof(memoryList) - 1);
+            break;
+        default:
+            usage(argv[0]);
+            exit(opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE);
+        }
+    }
+
+    if (optind != argc - 1)
+    {
+        usage(argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    if (!*algList)
+    {
+        for (nAlgs = 0; nAlgs < N_POLICIES; nAlgs++)
+            algs[nAlgs] = nAlgs;
+    }
+    else if ((nAlgs = parseList(algList, 1, 0, algs)) == -1)
+    {
+        fprintf(stderr, "Lista di algoritmi non valida\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for (a = 0; a < nAlgs; a++)
+    {
+        if (!getPolicy((int)algs[a]))
+        {
+            fprintf(stderr, "Algoritmo %zu non valido\n", algs[a]);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    nFiles = parseList(filesList, 1, 1, files);
+    nMemory = parseList(memoryList, MEGABYTE, 1, memory);
+
+    if (nFiles == -1 || nMemory == -1)
+    {
+        fprintf(stderr, "Lista di valori di MAXFILES o MAXMEMORY non valida\n");
+        exit(EXIT_FAILURE);
+    }
+
+    memset(&trace, 0, sizeof(trace));
+
+    if (!(trace.index = icl_hash_create(TRACE_BUCKETS, NULL, NULL)) || loadTrace(&trace, argv[optind]) == -1)
+    {
+        perror("Errore caricando il trace");
+        freeTrace(&trace);
+        exit(EXIT_FAILURE);
+    }
+
+    printf("Trace: %zu operazioni su %zu file\n\n", trace.len, trace.nPaths);
+    printf("%-14s %9s %10s %10s %10s %9s %13s %9s %9s\n", "Algoritmo", "MAXFILES", "MAXMEMORY", "Hit", "Byte hit",
+           "Vittime", "Byte espulsi", "Rifiutate", "Mops/s");
+
+    for (a = 0; a < nAlgs; a++)
+    {
+        for (f = 0; f < nFiles; f++)
+        {
+            for (m = 0; m < nMemory; m++)
+            {
+                if (simulate(&trace, (int)algs[a], files[f], memory[m]) == -1)
+                    perror("Errore nella simulazione");
+            }
+        }
+    }
+
+    freeTrace(&trace);
+    slabCleanup();
+
+    return 0;
+}
@@ -0,0 +1,77 @@
+#include "../include/define_source.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+
+#include "../include/chunk_pool.h"
+#include "../include/mutex.h"
+
+static pthread_mutex_t poolLock = PTHREAD_MUTEX_INITIALIZER;
+static FileChunk *freeList = NULL;
+static size_t nFree = 0;
+
+FileChunk *allocChunk(void)
+{
+    FileChunk *chunk;
+
+    LOCK(&poolLock);
+
+    if ((chunk = freeList))
+    {
+        freeList = chunk->next;
+        nFree--;
+    }
+
+    UNLOCK(&poolLock);
+
+    if (!chunk && !(chunk = malloc(sizeof(FileChunk))))
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    chunk->next = NULL;
+
+    return chunk;
+}
+
+void freeChunks(FileChunk *chunks)
+{
+    FileChunk *tmp;
+
+    while (chunks)
+    {
+        tmp = chunks;
+        chunks = chunks->next;
+
+        LOCK(&poolLock);
+
+        if (nFree < CHUNK_POOL_MAX_FREE)
+        {
+            tmp->next = freeList;
+            freeList = tmp;
+            nFree++;
+            tmp = NULL;
+        }
+
+        UNLOCK(&poolLock);
+
+        if (tmp)
+            free(tmp);
+    }
+}
+
+void deleteChunkPool(void)
+{
+    FileChunk *tmp;
+
+    while (freeList)
+    {
+        tmp = freeList;
+        freeList = freeList->next;
+        free(tmp);
+    }
+
+    nFree = 0;
+}
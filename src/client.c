@@ -37,6 +37,7 @@
     "-l file1[,file2],      lista di file su cui acquisire la mutua esclusione separati da ','.\n"                                      \
     "-u file1[,file2],      lista di file su cui rilasciare la mutua esclusione separati da ','.\n"                                     \
     "-c file1[,file2],      lista di file da rimuovere dal server separati da ','.\n"                                                   \
+    "-s,                    stampa le statistiche del server e il miss ratio stimato per diverse dimensioni della cache.\n"             \
     "-p,                    abilita le stampe sullo standard output per ogni operazione.\n"
 
 #define RETRY_TIME_MSEC 1000
@@ -402,6 +403,19 @@ int main(int argc, char *argv[])
         case 'c':
             CALL_API_ON_TOKEN(removeFile, selectedOption->arg);
             break;
+        case 's':;
+            char *stats = NULL;
+            size_t statsSize = 0;
+
+            if (getStats(&stats, &statsSize) == -1)
+            {
+                PRINT(perror("getStats"));
+                break;
+            }
+
+            fputs(stats, stdout);
+            free(stats);
+            break;
         default:
             if (toPrint)
                 fprintf(stderr, "Errore opzione -%c gia' impostata.\n", selectedOption->opt); // opizioni -f -p o -t duplicate
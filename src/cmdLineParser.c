@@ -140,7 +140,7 @@ OptionList *parseCmdLine(int argc, char *argv[])
         return NULL;
     }
 
-    for (int opt = 0; (opt = getopt(argc, argv, ":hf:w:W:D:r:R::d:t:l:u:c:p")) != -1;)
+    for (int opt = 0; (opt = getopt(argc, argv, ":hf:w:W:D:r:R::d:t:l:u:c:ps")) != -1;)
     {
         switch (opt)
         {
@@ -0,0 +1,232 @@
+#include "../include/define_source.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../include/epoch.h"
+#include "../include/mutex.h"
+
+#define EPOCH_LISTS 3 // un dato ritirato nell'epoca e puo' essere deallocato quando l'epoca globale diventa e + 2
+#define CACHE_LINE_SIZE 64
+
+/** Stato di un thread lettore. Ogni record occupa una linea di cache per non condividerla con gli altri thread.
+ *
+ */
+typedef struct epochRecord
+{
+    unsigned long epoch; // epoca globale osservata all'ingresso nella sezione di lettura
+    int active;
+    int inUse; // il record e' assegnato ad un thread
+    struct epochRecord *next;
+} __attribute__((aligned(CACHE_LINE_SIZE))) EpochRecord;
+
+typedef struct retired
+{
+    void *ptr;
+    void (*freeFunc)(void *);
+    struct retired *next;
+} Retired;
+
+static unsigned long globalEpoch = 0;
+
+static EpochRecord *records = NULL; // i record vengono solo aggiunti e riusati, mai rimossi fino a epochCleanup
+
+static pthread_key_t recordKey;
+static pthread_once_t recordKeyOnce = PTHREAD_ONCE_INIT;
+
+static pthread_mutex_t retireLock = PTHREAD_MUTEX_INITIALIZER;
+static Retired *limbo[EPOCH_LISTS];
+
+/**
+ * @brief Rilascia il record di un thread terminato, che potra' essere riusato da un nuovo thread.
+ */
+static void releaseRecord(void *record)
+{
+    __atomic_store_n(&(((EpochRecord *)record)->inUse), 0, __ATOMIC_RELEASE);
+}
+
+static void createRecordKey(void)
+{
+    if (pthread_key_create(&recordKey, &releaseRecord) != 0)
+    {
+        fprintf(stderr, "ERRORE FATALE pthread_key_create\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+/**
+ * @brief Ritorna il record del thread chiamante, assegnandogliene uno alla prima chiamata.
+ *
+ * \retval NULL se non e' stato possibile allocare il record (errno settato)
+ */
+static EpochRecord *getRecord(void)
+{
+    EpochRecord *record;
+    int notInUse;
+
+    pthread_once(&recordKeyOnce, &createRecordKey);
+
+    if ((record = (EpochRecord *)pthread_getspecific(recordKey)))
+        return record;
+
+    // provo a riusare il record di un thread terminato
+    for (record = __atomic_load_n(&records, __ATOMIC_ACQUIRE); record; record = record->next)
+    {
+        notInUse = 0;
+        if (__atomic_compare_exchange_n(&(record->inUse), &notInUse, 1, 0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+            break;
+    }
+
+    if (!record)
+    {
+        if (posix_memalign((void **)&record, CACHE_LINE_SIZE, sizeof(*record)) != 0)
+        {
+            errno = ENOMEM;
+            return NULL;
+        }
+
+        record->epoch = 0;
+        record->active = 0;
+        record->inUse = 1;
+        record->next = __atomic_load_n(&records, __ATOMIC_RELAXED);
+
+        while (!__atomic_compare_exchange_n(&records, &(record->next), record, 0, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+            ;
+    }
+
+    if (pthread_setspecific(recordKey, record) != 0)
+    {
+        releaseRecord(record);
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    return record;
+}
+
+/**
+ * @brief Avanza l'epoca globale se tutti i lettori attivi l'hanno osservata. Si assume la mutua esclusione su retireLock.
+ *
+ * @return la lista dei dati che non possono piu' essere visti da nessun lettore, da deallocare senza lock
+ */
+static Retired *tryAdvance(void)
+{
+    EpochRecord *record;
+    Retired *freeable;
+
+    unsigned long epoch = globalEpoch;
+
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    for (record = __atomic_load_n(&records, __ATOMIC_ACQUIRE); record; record = record->next)
+    {
+        if (__atomic_load_n(&(record->active), __ATOMIC_ACQUIRE) && __atomic_load_n(&(record->epoch), __ATOMIC_RELAXED) != epoch)
+            return NULL;
+    }
+
+    __atomic_store_n(&globalEpoch, epoch + 1, __ATOMIC_RELEASE);
+
+    // con l'epoca globale a epoch + 1 i dati ritirati nell'epoca epoch - 1 non sono piu' raggiungibili
+    freeable = limbo[(epoch + 2) % EPOCH_LISTS];
+    limbo[(epoch + 2) % EPOCH_LISTS] = NULL;
+
+    return freeable;
+}
+
+static void freeRetired(Retired *list)
+{
+    Retired *tmp;
+
+    while (list)
+    {
+        tmp = list;
+        list = list->next;
+
+        tmp->freeFunc(tmp->ptr);
+        free(tmp);
+    }
+}
+
+int epochEnter(void)
+{
+    EpochRecord *record = getRecord();
+
+    if (!record)
+        return -1;
+
+    __atomic_store_n(&(record->active), 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&(record->epoch), __atomic_load_n(&globalEpoch, __ATOMIC_ACQUIRE), __ATOMIC_RELAXED);
+
+    // le letture successive non possono essere anticipate rispetto all'annuncio dell'epoca
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    return 0;
+}
+
+void epochExit(void)
+{
+    EpochRecord *record = (EpochRecord *)pthread_getspecific(recordKey);
+
+    if (record)
+        __atomic_store_n(&(record->active), 0, __ATOMIC_RELEASE);
+}
+
+int epochRetire(void *ptr, void (*freeFunc)(void *))
+{
+    Retired *node,
+        *freeable[EPOCH_LISTS - 1];
+
+    int i;
+
+    if (!ptr || !freeFunc)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (!(node = malloc(sizeof(*node))))
+    {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    node->ptr = ptr;
+    node->freeFunc = freeFunc;
+
+    LOCK(&retireLock);
+
+    node->next = limbo[globalEpoch % EPOCH_LISTS];
+    limbo[globalEpoch % EPOCH_LISTS] = node;
+
+    // provo ad avanzare due volte, cosi' se non ci sono lettori anche il dato appena ritirato viene deallocato
+    for (i = 0; i < EPOCH_LISTS - 1; i++)
+        freeable[i] = tryAdvance();
+
+    UNLOCK(&retireLock);
+
+    for (i = 0; i < EPOCH_LISTS - 1; i++)
+        freeRetired(freeable[i]);
+
+    return 0;
+}
+
+void epochCleanup(void)
+{
+    EpochRecord *record;
+    int i;
+
+    for (i = 0; i < EPOCH_LISTS; i++)
+    {
+        freeRetired(limbo[i]);
+        limbo[i] = NULL;
+    }
+
+    while (records)
+    {
+        record = records;
+        records = records->next;
+        free(record);
+    }
+}
@@ -0,0 +1,59 @@
+#include "../include/define_source.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../include/eventcount.h"
+
+unsigned int eventPrepareWait(EventCount *event)
+{
+    unsigned int val = __atomic_load_n(event, __ATOMIC_RELAXED);
+
+    while (!(val & EVENT_WAITERS) &&
+           !__atomic_compare_exchange_n(event, &val, val | EVENT_WAITERS, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+
+    // mi registro prima di ricontrollare la condizione: o chi la rende vera vede il bit in eventNotify, o io vedo le sue
+    // modifiche
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    return val | EVENT_WAITERS;
+}
+
+void eventWait(EventCount *event, unsigned int val)
+{
+    // ritorna subito se il valore e' gia' cambiato; EINTR e risvegli spuri vengono gestiti dal chiamante
+    syscall(SYS_futex, event, FUTEX_WAIT_PRIVATE, val, NULL, NULL, 0);
+}
+
+int eventTimedWait(EventCount *event, unsigned int val, uint64_t timeout)
+{
+    struct timespec rel = {.tv_sec = timeout / 1000000000, .tv_nsec = timeout % 1000000000};
+
+    if (syscall(SYS_futex, event, FUTEX_WAIT_PRIVATE, val, &rel, NULL, 0) == -1 && errno == ETIMEDOUT)
+        return -1;
+
+    return 0;
+}
+
+void eventNotify(EventCount *event)
+{
+    unsigned int val;
+
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    val = __atomic_load_n(event, __ATOMIC_RELAXED);
+
+    while (val & EVENT_WAITERS)
+    {
+        if (__atomic_compare_exchange_n(event, &val, (val & ~EVENT_WAITERS) + 2, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+        {
+            syscall(SYS_futex, event, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+            return;
+        }
+    }
+}
@@ -3,8 +3,12 @@
 #include <stdlib.h>
 
 #include "../include/fdList.h"
+#include "../include/slab.h"
 #include "../include/utils.h"
 
+static SlabCache nodeCache = SLAB_CACHE_INITIALIZER("fdNode", sizeof(fdNode));
+static SlabCache listCache = SLAB_CACHE_INITIALIZER("fdList", sizeof(fdList));
+
 fdNode *initNode(int fd)
 {
     fdNode *newNode;
@@ -15,7 +19,7 @@ fdNode *initNode(int fd)
         return NULL;
     }
 
-    CHECK_RET_AND_ACTION(calloc, ==, NULL, newNode, errno = ENOMEM; return NULL, 1, sizeof(*newNode));
+    CHECK_RET_AND_ACTION(slabAlloc, ==, NULL, newNode, errno = ENOMEM; return NULL, &nodeCache);
 
     newNode->fd = fd;
     newNode->prev = newNode->next = NULL;
@@ -23,16 +27,16 @@ fdNode *initNode(int fd)
     return newNode;
 }
 
-void deleteNode(fdNode *node)
+void deleteNode(void *node)
 {
     if (node)
-        free(node);
+        slabFree(node);
 }
 
 fdList *initList()
 {
     fdList *newList;
-    CHECK_RET_AND_ACTION(calloc, ==, NULL, newList, errno = ENOMEM; return NULL, 1, sizeof(*newList));
+    CHECK_RET_AND_ACTION(slabAlloc, ==, NULL, newList, errno = ENOMEM; return NULL, &listCache);
 
     newList->head = newList->tail = NULL;
 
@@ -53,7 +57,7 @@ void deleteList(fdList **list)
         deleteNode(tmp);
     }
 
-    free(*list);
+    slabFree(*list);
 
     *list = NULL;
 }
@@ -72,17 +76,17 @@ fdNode *getNode(fdList *list, int key)
     {
         if (curr->fd == key)
         {
+            // il nodo rimosso continua a puntare al successivo per eventuali lettori concorrenti di findNode
             if (!curr->prev)
-                list->head = curr->next;
+                __atomic_store_n(&(list->head), curr->next, __ATOMIC_RELEASE);
             else
-                curr->prev->next = curr->next;
+                __atomic_store_n(&(curr->prev->next), curr->next, __ATOMIC_RELEASE);
 
             if (!curr->next)
                 list->tail = curr->prev;
             else
                 curr->next->prev = curr->prev;
 
-            curr->next = curr->prev = NULL;
             return curr;
         }
         curr = curr->next;
@@ -118,14 +122,14 @@ int findNode(fdList *list, int key)
         return 0;
     }
 
-    fdNode *curr = list->head;
+    fdNode *curr = __atomic_load_n(&(list->head), __ATOMIC_ACQUIRE);
 
     while (curr)
     {
         if (curr->fd == key)
             return 1;
 
-        curr = curr->next;
+        curr = __atomic_load_n(&(curr->next), __ATOMIC_ACQUIRE);
     }
 
     return 0;
@@ -144,16 +148,15 @@ int insertNode(fdList *list, int fd)
     if (!newNode)
         return -1;
 
+    if (list->tail)
+        newNode->prev = list->tail;
+
+    // pubblico il nodo solo dopo averlo inizializzato
     if (!list->head)
-    {
-        list->head = newNode;
-    }
+        __atomic_store_n(&(list->head), newNode, __ATOMIC_RELEASE);
 
     if (list->tail)
-    {
-        list->tail->next = newNode;
-        newNode->prev = list->tail;
-    }
+        __atomic_store_n(&(list->tail->next), newNode, __ATOMIC_RELEASE);
 
     list->tail = newNode;
     return 0;
@@ -176,4 +179,6 @@ void concanateList(fdList **dest, fdList *src)
         src->head->prev = (*dest)->tail;
 
     (*dest)->tail = src->tail;
+
+    slabFree(src);
 }
\ No newline at end of file
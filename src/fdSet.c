@@ -0,0 +1,279 @@
+#include "../include/define_source.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/epoch.h"
+#include "../include/fdSet.h"
+
+#define WORD_BITS (sizeof(unsigned long) * CHAR_BIT)
+
+/**
+ * @brief Alloca una bitmap azzerata con almeno 'minBits' bit, arrotondati alla potenza di 2 successiva.
+ */
+static FdBitmap *allocBitmap(size_t minBits)
+{
+    FdBitmap *bitmap;
+    size_t nbits = WORD_BITS;
+
+    while (nbits < minBits)
+        nbits *= 2;
+
+    if (!(bitmap = calloc(1, sizeof(FdBitmap) + nbits / CHAR_BIT)))
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    bitmap->nbits = nbits;
+
+    return bitmap;
+}
+
+static void setBit(FdBitmap *bitmap, int fd)
+{
+    __atomic_or_fetch(&(bitmap->bits[fd / WORD_BITS]), 1UL << (fd % WORD_BITS), __ATOMIC_RELAXED);
+}
+
+static int testBit(FdBitmap *bitmap, int fd)
+{
+    return (size_t)fd < bitmap->nbits &&
+           (__atomic_load_n(&(bitmap->bits[fd / WORD_BITS]), __ATOMIC_RELAXED) >> (fd % WORD_BITS)) & 1UL;
+}
+
+void initFdSet(FdSet *set)
+{
+    memset(set, 0, sizeof(FdSet));
+}
+
+int fdSetInsert(FdSet *set, int fd)
+{
+    FdBitmap *bitmap,
+        *old;
+    int i,
+        freeSlot = -1,
+        maxFd = fd;
+
+    if (!set || fd <= 0)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if ((old = set->bitmap))
+    {
+        if ((size_t)fd < old->nbits)
+        {
+            setBit(old, fd);
+            return 0;
+        }
+
+        // la bitmap sostituita resta valida per i lettori che la stanno consultando
+        if (!(bitmap = allocBitmap((size_t)fd + 1)))
+            return -1;
+
+        memcpy(bitmap->bits, old->bits, old->nbits / CHAR_BIT);
+        setBit(bitmap, fd);
+
+        __atomic_store_n(&(set->bitmap), bitmap, __ATOMIC_RELEASE);
+
+        if (epochRetire(old, &free) == -1)
+            perror("epochRetire");
+
+        return 0;
+    }
+
+    for (i = 0; i < FDSET_INLINE; i++)
+    {
+        if (set->inlineFds[i] == fd)
+            return 0;
+
+        if (!set->inlineFds[i] && freeSlot == -1)
+            freeSlot = i;
+
+        if (set->inlineFds[i] > maxFd)
+            maxFd = set->inlineFds[i];
+    }
+
+    if (freeSlot != -1)
+    {
+        __atomic_store_n(&(set->inlineFds[freeSlot]), fd, __ATOMIC_RELEASE);
+        return 0;
+    }
+
+    // gli slot sono pieni: passo alla bitmap, da ora gli slot non vengono piu' modificati
+    if (!(bitmap = allocBitmap((size_t)maxFd + 1)))
+        return -1;
+
+    for (i = 0; i < FDSET_INLINE; i++)
+        setBit(bitmap, set->inlineFds[i]);
+
+    setBit(bitmap, fd);
+
+    __atomic_store_n(&(set->bitmap), bitmap, __ATOMIC_RELEASE);
+
+    return 0;
+}
+
+int fdSetRemove(FdSet *set, int fd)
+{
+    int i;
+
+    if (!set || fd <= 0)
+        return 0;
+
+    if (set->bitmap)
+    {
+        if (!testBit(set->bitmap, fd))
+            return 0;
+
+        __atomic_and_fetch(&(set->bitmap->bits[fd / WORD_BITS]), ~(1UL << (fd % WORD_BITS)), __ATOMIC_RELAXED);
+        return 1;
+    }
+
+    for (i = 0; i < FDSET_INLINE; i++)
+    {
+        if (set->inlineFds[i] == fd)
+        {
+            __atomic_store_n(&(set->inlineFds[i]), 0, __ATOMIC_RELAXED);
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+int fdSetContains(FdSet *set, int fd)
+{
+    FdBitmap *bitmap;
+    int i;
+
+    if (!set || fd <= 0)
+        return 0;
+
+    if ((bitmap = __atomic_load_n(&(set->bitmap), __ATOMIC_ACQUIRE)))
+        return testBit(bitmap, fd);
+
+    for (i = 0; i < FDSET_INLINE; i++)
+    {
+        if (__atomic_load_n(&(set->inlineFds[i]), __ATOMIC_ACQUIRE) == fd)
+            return 1;
+    }
+
+    return 0;
+}
+
+void destroyFdSet(FdSet *set)
+{
+    if (!set)
+        return;
+
+    free(set->bitmap);
+    set->bitmap = NULL;
+}
+
+void initFdQueue(FdQueue *queue)
+{
+    memset(queue, 0, sizeof(FdQueue));
+
+    queue->buf = queue->inlineFds;
+    queue->capacity = FDQUEUE_INLINE;
+}
+
+int fdQueuePush(FdQueue *queue, int fd)
+{
+    int *buf;
+    size_t i;
+
+    if (!queue || fd <= 0)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (queue->count == queue->capacity)
+    {
+        if (!(buf = malloc(2 * queue->capacity * sizeof(int))))
+        {
+            errno = ENOMEM;
+            return -1;
+        }
+
+        // ricopio gli fd in ordine a partire dalla posizione 0
+        for (i = 0; i < queue->count; i++)
+            buf[i] = queue->buf[(queue->head + i) & (queue->capacity - 1)];
+
+        if (queue->buf != queue->inlineFds)
+            free(queue->buf);
+
+        queue->buf = buf;
+        queue->capacity *= 2;
+        queue->head = 0;
+    }
+
+    queue->buf[(queue->head + queue->count) & (queue->capacity - 1)] = fd;
+    queue->count++;
+
+    return 0;
+}
+
+int fdQueuePop(FdQueue *queue)
+{
+    int fd;
+
+    if (!queue || !queue->count)
+        return 0;
+
+    fd = queue->buf[queue->head];
+    queue->head = (queue->head + 1) & (queue->capacity - 1);
+    queue->count--;
+
+    return fd;
+}
+
+int fdQueueRemove(FdQueue *queue, int fd)
+{
+    size_t mask,
+        i;
+
+    if (!queue)
+        return 0;
+
+    mask = queue->capacity - 1;
+
+    for (i = 0; i < queue->count; i++)
+    {
+        if (queue->buf[(queue->head + i) & mask] == fd)
+            break;
+    }
+
+    if (i == queue->count)
+        return 0;
+
+    // sposto indietro di una posizione gli fd che seguono
+    for (; i + 1 < queue->count; i++)
+        queue->buf[(queue->head + i) & mask] = queue->buf[(queue->head + i + 1) & mask];
+
+    queue->count--;
+
+    return 1;
+}
+
+size_t fdQueueLength(const FdQueue *queue)
+{
+    return queue ? queue->count : 0;
+}
+
+void destroyFdQueue(FdQueue *queue)
+{
+    if (!queue)
+        return;
+
+    if (queue->buf != queue->inlineFds)
+        free(queue->buf);
+
+    initFdQueue(queue);
+}
@@ -3,22 +3,37 @@
 #include <errno.h>
 #include <limits.h>
 #include <pthread.h>
+#include <sched.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-#include "../include/compare_func.h"
 #include "../include/definitions.h"
+#include "../include/epoch.h"
 #include "../include/filesystem.h"
 #include "../include/mutex.h"
+#include "../include/policy.h"
+#include "../include/scheduler.h"
+#include "../include/session.h"
+#include "../include/shards.h"
+#include "../include/slab.h"
 #include "../include/utils.h"
 
-#define UPDATE_FILE_REFERENCE(file) \
-    file->lastUsed = time(NULL);    \
-    file->usedTimes++;              \
-    file->referenceBit = 1;
+// numero di blocchi necessari per 'size' bytes
+#define CHUNKS_FOR(size) (((size) + FILE_CHUNK_SIZE - 1) / FILE_CHUNK_SIZE)
 
-int logOperation(BQueue_t *logger_msg_queue, const char *op, const char *pathname, const int clientFd, const size_t dataSize)
+// avanza il clock logico del filesystem e ritorna il nuovo istante
+#define TICK(fs) __atomic_add_fetch(&((fs)->logicalClock), 1, __ATOMIC_RELAXED)
+
+// il filesystem supera la soglia di 'files' file o di 'memory' bytes
+#define ABOVE_WATERMARK(fs, files, memory) ((fs)->currFiles > (files) || (fs)->currMemory > (memory))
+
+#define EVICTOR_RETRY_MS 10 // attesa del thread di espulsione quando le vittime sono in uso
+#define RESERVE_BUSY_RETRIES 1024 // tentativi di reserveSpace quando le vittime sono in uso prima di rinunciare
+
+static SlabCache fileCache = SLAB_CACHE_INITIALIZER("File", sizeof(File));
+
+int logOperation(MPMCQueue_t *logger_msg_queue, const char *op, const char *pathname, const int clientFd, const size_t dataSize)
 {
     char *operation_buf;
 
@@ -47,202 +62,237 @@ int logOperation(BQueue_t *logger_msg_queue, const char *op, const char *pathnam
 
     snprintf(operation_buf, buf_len, "\ntimestamp: %s\nclientFd: %d\nworkerTid: %ld\noperationType: %s\nfilePath: %s\nbytesProcessed: %zu\n", timeString, clientFd, pthread_self(), op, pathname, dataSize);
 
-    return push(logger_msg_queue, operation_buf);
+    return mpmcPush(logger_msg_queue, operation_buf);
+}
+
+void initFsPath(FsPath *path, const char *name)
+{
+    path->name = name;
+    path->len = strlen(name);
+    path->hash = icl_hash_bytes(name, path->len);
+}
+
+/**
+ * @brief Registra una richiesta per il path 'path' di un file non presente, per la stima della curva dei miss ratio e
+ *  per le politiche che ne tengono conto.
+ */
+static void recordMiss(Filesystem *fs, const FsPath *path)
+{
+    shardsAccess(fs->mrc, path->hash, 0);
+
+    if (!fs->policy->on_miss)
+        return;
+
+    LOCK(&(fs->queueLock));
+    fs->policy->on_miss(fs, path->name);
+    UNLOCK(&(fs->queueLock));
 }
 
 /**
- * @brief Aggiunge alla coda del filesystem 'fs' un file
+ * @brief Aggiunge alla coda di espulsione del filesystem 'fs' un file. Si assume la mutua esclusione sulla coda.
  *
  * @param fs puntatore al filesystem
  * @param file file da aggiungere
  */
 static void addFileToQueue(Filesystem *fs, File *file)
 {
-    if (!fs->file_queue_head)
-    {
-        fs->file_queue_head = file;
-    }
-    else
-    {
-        file->prev = fs->file_queue_tail;
-        fs->file_queue_tail->next = file;
-    }
+    fs->policy->on_insert(fs, file);
 
-    fs->file_queue_tail = file;
+    file->queued = 1;
 }
 
 /**
- * @brief Rimuove dalla coda del filesystem 'fs' un file
+ * @brief Rimuove dalla coda di espulsione del filesystem 'fs' un file espulso ('evicted' diverso da 0) o rimosso da un
+ *  client. Si assume la mutua esclusione sulla coda.
  *
  * @param fs puntatore al filesystem
- * @param file file da aggiungere
+ * @param file file da rimuovere
  */
-static void removeFileFromQueue(Filesystem *fs, File *file)
+static void removeFileFromQueue(Filesystem *fs, File *file, int evicted)
 {
-    // il file è il primo della coda
-    if (!file->prev)
-        fs->file_queue_head = file->next;
-    else
-        file->prev->next = file->next;
+    fs->policy->on_remove(fs, file, evicted);
 
-    // il file è l'ultimo della coda
-    if (!file->next)
-        fs->file_queue_tail = file->prev;
-    else
-        file->next->prev = file->prev;
-
-    file->prev = file->next = NULL;
+    file->queued = 0;
 }
 
 /**
- * @brief Sceglie il file da espellere dal filesystem 'fs' per aggiungere il file 'toAdd'.
- *  Si assume la mutua esclusione sia sul filesystem sia sul file da aggiungere.
- *
- * @param fs puntattore al file system
- * @param toAdd puntatore al file
- * @return il file da espellere se successo, NULL altrimenti e errno settato.
+ * @brief Registra un accesso di tipo 'kind' al file 'file' e lo segnala alla politica di rimpiazzamento, prendendo la
+ *  lock sulla coda solo se la politica la richiede. Le letture non attendono la lock: se e' occupata il riordinamento
+ *  della coda viene saltato, cosi' il percorso di lettura senza lock non si serializza sulla coda globale (i contatori di
+ *  uso del file vengono comunque aggiornati). Sotto contesa la politica vede quindi solo una parte delle letture: quelle
+ *  saltate sono contate in droppedTouches e riportate nelle statistiche. Non vengono accumulate per applicarle piu'
+ *  tardi perche' il file e' garantito solo durante la chiamata.
+ *  Si assume che il chiamante non abbia la lock sul file (l'ordine delle lock e' coda e poi file) e che il file non possa
+ *  essere deallocato durante la chiamata (lock sulla partizione, file acquisito o sezione di lettura).
  */
-static File *evictFile(Filesystem *fs, File *toAdd)
+static void touchFile(Filesystem *fs, File *file, int kind)
 {
-    File *toEvict,
-        *currFile,
-        *tmp;
+    __atomic_store_n(&(file->lastUsed), TICK(fs), __ATOMIC_RELAXED);
+    __atomic_add_fetch(&(file->usedTimes), 1, __ATOMIC_RELAXED);
 
-    int res;
+    if (!fs->policy->on_access)
+        return;
 
-    if (!fs)
+    if (fs->policy->lockFreeAccess)
     {
-        errno = EINVAL;
-        return NULL;
+        fs->policy->on_access(fs, file, kind);
+        return;
     }
 
-    toEvict = fs->file_queue_head != toAdd ? fs->file_queue_head : fs->file_queue_head->next;
-
-    if (fs->replacement_algo != FIFO)
+    if (kind == TOUCH_READ)
     {
-        currFile = fs->file_queue_head;
-        while (currFile)
+        if (pthread_mutex_trylock(&(fs->queueLock)) != 0)
         {
-            if (currFile != toAdd && (res = (*replace_algo[fs->replacement_algo])(currFile, toEvict)) > 0)
-                toEvict = currFile;
-
-            tmp = currFile;
-            currFile = currFile->next;
-
-            if (fs->replacement_algo == SECOND_CHANCE && tmp != toAdd)
-            {
-                // Ho troavto un file con il referenceBit settato a 0
-                if (res == 1)
-                    break;
-
-                // Sposto il file alla fine della coda
-                removeFileFromQueue(fs, tmp);
-                addFileToQueue(fs, tmp);
-            }
+            __atomic_add_fetch(&(fs->droppedTouches), 1, __ATOMIC_RELAXED);
+            return;
         }
     }
+    else
+    {
+        LOCK(&(fs->queueLock));
+    }
 
-    fs->evictedFiles++;
+    // il file potrebbe non essere ancora stato aggiunto alla coda o esserne gia' stato rimosso
+    if (file->queued)
+        fs->policy->on_access(fs, file, kind);
 
-    return toEvict;
+    UNLOCK(&(fs->queueLock));
 }
 
 /**
- * @brief Aggiunge al buffer 'buf' di dimensione corrente 'bufCurrSize' bytes un file.
- * Si assume la mutua esclusione sul file
- *
- * @param file file da aggiungere
- * @param buf buffer di file
- * @param bufCurrSize dimensione attuale del buffer
- * @return 0 successo, -1 altrimenti e errno settato
+ * @brief Segnala alla politica di rimpiazzamento che il file 'file' avra' dimensione 'size'. Si assume la mutua
+ *  esclusione sulla coda.
  */
-static int copyFileToBuffer(File *file, char **buf, size_t *bufCurrSize)
+static void resizeFile(Filesystem *fs, File *file, size_t size)
 {
-    size_t path_len,
-        bufNewSize;
-
-    void *tmp;
+    if (fs->policy->on_resize && file->queued)
+        fs->policy->on_resize(fs, file, size);
+}
 
-    if (!file)
+/**
+ * @brief Sceglie il file da espellere dal filesystem 'fs' per aggiungere il file 'toAdd'. Vengono saltati solo i file in
+ *  uso. Si assume la mutua esclusione sulla coda del filesystem.
+ *
+ * @param fs puntattore al file system
+ * @param toAdd puntatore al file
+ * @return il file da espellere se successo, NULL altrimenti e errno settato (EBUSY se tutti i possibili file da
+ *  espellere sono in uso, ENOENT se non ci sono file da espellere, ECANCELED se la politica non ammette i dati di 'toAdd').
+ */
+static File *evictFile(Filesystem *fs, File *toAdd)
+{
+    if (!fs)
     {
         errno = EINVAL;
-        return -1;
+        return NULL;
     }
 
-    path_len = strlen(file->path) + 1;
-
-    bufNewSize = *bufCurrSize + sizeof(size_t) + path_len + sizeof(size_t) + file->dataSize;
+    return fs->policy->choose_victim(fs, toAdd);
+}
 
-    tmp = realloc(*buf, bufNewSize);
+/**
+ * @brief Segna il file 'file' come in fase di espulsione e lo rimuove dalla coda del filesystem 'fs', in modo che
+ *  nessuna nuova operazione possa iniziare su di esso. Se 'noWaiters' e' settato il file non viene preso se ci sono
+ *  client in attesa della lock, che il chiamante non potrebbe avvisare. Si assume la mutua esclusione sulla coda del
+ *  filesystem.
+ *
+ * \retval 0 se successo
+ * \retval -1 se il file e' in uso o e' gia' in fase di espulsione (errno settato a EBUSY) o ha client in attesa della lock
+ *  (errno settato a EAGAIN)
+ */
+static int claimFile(Filesystem *fs, File *file, int noWaiters)
+{
+    LOCK(&(file->fileLock));
 
-    if (!tmp)
+    if (file->evicting || file->users > 0)
     {
-        errno = ENOMEM;
-        free(*buf);
+        UNLOCK(&(file->fileLock));
+        errno = EBUSY;
         return -1;
     }
 
-    *buf = tmp;
-
-    memcpy(*buf + *bufCurrSize, &path_len, sizeof(size_t)); // Copio la dimensione del path del file
-
-    memcpy(*buf + *bufCurrSize + sizeof(size_t), file->path, path_len); // Copio il path del file
+    if (noWaiters && fdQueueLength(&(file->waitingForLock)) > 0)
+    {
+        UNLOCK(&(file->fileLock));
+        errno = EAGAIN;
+        return -1;
+    }
 
-    memcpy(*buf + *bufCurrSize + sizeof(size_t) + path_len, &(file->dataSize), sizeof(size_t)); // Copio la dimensione del file
+    file->evicting = 1;
 
-    memcpy(*buf + bufNewSize - (file->dataSize), file->data, file->dataSize); // Copio il file
+    UNLOCK(&(file->fileLock));
 
-    *bufCurrSize = bufNewSize;
+    removeFileFromQueue(fs, file, 1);
 
     return 0;
 }
 
 /**
- * @brief Alloca e inizializza un file con pathname @param path pathname del file.
+ * @brief Alloca e inizializza un file con pathname @param path pathname del file, di cui copia lunghezza e hash.
  *
  * \retval NULL se non è stato possibile allocare o inizializzare il file (errno settato)
  * \retval newFile puntatore al file allocato
  */
-static File *initFile(const char *path)
+static File *initFile(const FsPath *path)
 {
-    if (!path)
+    if (!path || !path->name)
     {
         errno = EINVAL;
         return NULL;
     }
 
     File *newFile;
-    // alloco e inizializzo una struttura di tipo File, ritorno NULL se c'è stato un errore
-    CHECK_RET_AND_ACTION(calloc, ==, NULL, newFile, perror("calloc"); return NULL, 1, sizeof(File));
+    size_t path_len = path->len;
+    int errnum;
+
+    // alloco e inizializzo una struttura di tipo File dalla slab, ritorno NULL se c'è stato un errore
+    CHECK_RET_AND_ACTION(slabAlloc, ==, NULL, newFile, perror("slabAlloc"); return NULL, &fileCache);
+    memset(newFile, 0, sizeof(File));
 
-    // duplico il path del file, ritorno NULL se c'è stato un errore
-    CHECK_RET_AND_ACTION(strdup, ==, NULL, newFile->path, perror("strdup"); return NULL, path);
-    newFile->path[strlen(path)] = '\0';
+    // i path corti vengono copiati nella struttura del file, gli altri duplicati
+    if (path_len < FILE_INLINE_PATH)
+    {
+        newFile->path = memcpy(newFile->inlinePath, path->name, path_len + 1);
+    }
+    else
+    {
+        CHECK_RET_AND_ACTION(strdup, ==, NULL, newFile->path, perror("strdup"); slabFree(newFile); return NULL, path->name);
+    }
 
-    newFile->data = NULL;
+    newFile->pathLen = path_len;
+    newFile->hash = path->hash;
+    newFile->chunks = newFile->lastChunk = NULL;
     newFile->dataSize = 0;
 
-    // inizializzo la mutex del file, setto errno e ritorno NULL in caso di errore
-    CHECK_PTHREAD_AND_ACTION(pthread_mutex_init, !=, 0, return NULL,
-                             &(newFile->fileLock), NULL);
+    // inizializzo la mutex del file, in caso di errore dealloco il file, setto errno e ritorno NULL
+    if ((errnum = pthread_mutex_init(&(newFile->fileLock), NULL)) != 0)
+        goto error;
 
     // iniziallizzo la variabile di condizione
-    CHECK_PTHREAD_AND_ACTION(pthread_cond_init, !=, 0, return NULL,
-                             &(newFile->readWrite), NULL);
+    if ((errnum = pthread_cond_init(&(newFile->readWrite), NULL)) != 0)
+    {
+        pthread_mutex_destroy(&(newFile->fileLock));
+        goto error;
+    }
 
     newFile->isWritten = 0;
-    newFile->nReaders = 0;
-    // alloco e inizializzo la lista dei fd che hanno aperto il file, ritorno NULL in caso di errore
-    CHECK_RET_AND_ACTION(initList, ==, NULL, newFile->openedBy, ; return NULL, NULL);
-
-    // alloco e inizializzo la lista dei fd che attendo di poter acquisire la lock sul file, ritorno NULL in caso di errore
-    CHECK_RET_AND_ACTION(initList, ==, NULL, newFile->waitingForLock, ; return NULL, NULL);
+    // insieme dei fd che hanno aperto il file e coda di quelli che attendono la lock, senza allocazioni finche' sono pochi
+    initFdSet(&(newFile->openedBy));
+    initFdQueue(&(newFile->waitingForLock));
     // inizialmente il file non è in stato di locked
     newFile->lockedBy = 0;
 
     newFile->prev = newFile->next = NULL;
 
     return newFile;
+
+error:
+    if (newFile->path != newFile->inlinePath)
+        free(newFile->path);
+
+    slabFree(newFile);
+    errno = errnum;
+
+    return NULL;
 }
 
 /**
@@ -254,116 +304,485 @@ static void freeFile(void *filePtr)
 {
     File *file = (File *)filePtr;
 
-    if (file->waitingForLock)
-        deleteList(&(file->waitingForLock));
+    destroyFdQueue(&(file->waitingForLock));
+    destroyFdSet(&(file->openedBy));
 
-    if (file->openedBy)
-        deleteList(&(file->openedBy));
-
-    if (file->path)
+    if (file->path && file->path != file->inlinePath)
         free(file->path);
 
-    if (file->data)
-        free(file->data);
+    // Restituisco i blocchi al pool
+    freeChunks(file->chunks);
 
     CHECK_PTHREAD_AND_ACTION(pthread_mutex_destroy, !=, 0, pthread_exit((void *)EXIT_FAILURE), &(file->fileLock));
 
     CHECK_PTHREAD_AND_ACTION(pthread_cond_destroy, !=, 0, pthread_exit((void *)EXIT_FAILURE), &(file->readWrite));
 
     if (file)
-        free(file);
+        slabFree(file);
 }
 
 /**
- * @brief Rimuove il file dal filesystem 'fs' e salva la lista dei client che attendevano la lock sul puntatore 'signalForLock' che dovra' essere deallocata dal chiamante.
- * Si assume che il chiamante abbia la mutua esclusione sullo storage.
+ * @brief Si assicura che il buffer 'buf' abbia spazio per altre 'n' iovec.
  *
- * @param fs puntatore al filesystem
- * @param file file da rimuovere
- * @param signalForLock puntatore alla lista di client che attendono la lock sul file
+ * @return 0 successo, -1 altrimenti e errno settato
+ */
+static int reserveIov(FileBuffer *buf, int n)
+{
+    struct iovec *tmp;
+    int newCap;
+
+    if (buf->iovcnt + n <= buf->iovcap)
+        return 0;
+
+    newCap = MAX(buf->iovcap * 2, buf->iovcnt + n);
+
+    if (!(tmp = realloc(buf->iov, newCap * sizeof(struct iovec))))
+    {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    buf->iov = tmp;
+    buf->iovcap = newCap;
+
+    return 0;
+}
+
+static void addIov(FileBuffer *buf, void *base, size_t len)
+{
+    buf->iov[buf->iovcnt].iov_base = base;
+    buf->iov[buf->iovcnt].iov_len = len;
+    buf->iovcnt++;
+    buf->size += len;
+}
+
+/**
+ * @brief Aggiunge al buffer 'buf' i blocchi del file 'file', preceduti se richiesto dall'header con path e dimensione.
+ * Si assume che il chiamante sia in una sezione epochEnter/epochExit o che il file non sia piu' raggiungibile.
+ *
+ * @param file file da aggiungere
+ * @param buf buffer di file
+ * @param header se settato aggiunge l'header del file
+ * @return 0 successo, -1 altrimenti e errno settato
  */
-static void deleteFile(Filesystem *fs, File *file, fdList **signalForLock)
+static int addFileToBuffer(FileBuffer *buf, File *file, int header)
 {
+    size_t path_len,
+        fileSize,
+        left,
+        len;
+
+    FileChunk *chunk;
+    FileHeader *hdr = NULL;
+
+    if (!buf || !file)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    // i bytes entro la dimensione pubblicata non vengono piu' modificati dagli scrittori
+    fileSize = __atomic_load_n(&(file->dataSize), __ATOMIC_ACQUIRE);
+
+    if (reserveIov(buf, CHUNKS_FOR(fileSize) + 1) == -1)
+        return -1;
+
+    if (header)
+    {
+        path_len = file->pathLen + 1;
+
+        if (!(hdr = malloc(sizeof(FileHeader) + sizeof(size_t) + path_len + sizeof(size_t))))
+        {
+            errno = ENOMEM;
+            return -1;
+        }
+
+        memcpy(hdr->data, &path_len, sizeof(size_t)); // Copio la dimensione del path del file
+
+        memcpy(hdr->data + sizeof(size_t), file->path, path_len); // Copio il path del file
+
+        memcpy(hdr->data + sizeof(size_t) + path_len, &fileSize, sizeof(size_t)); // Copio la dimensione del file
+
+        hdr->next = buf->headers;
+        buf->headers = hdr;
+
+        addIov(buf, hdr->data, sizeof(size_t) + path_len + sizeof(size_t));
+    }
+
+    // Aggiungo i blocchi del file senza copiarli
+    chunk = __atomic_load_n(&(file->chunks), __ATOMIC_ACQUIRE);
+
+    for (left = fileSize; left > 0; left -= len)
+    {
+        len = MIN(left, (size_t)FILE_CHUNK_SIZE);
+
+        addIov(buf, chunk->data, len);
+
+        if (left > len)
+            chunk = __atomic_load_n(&(chunk->next), __ATOMIC_ACQUIRE);
+    }
+
+    return 0;
+}
+
+void releaseFileBuffer(FileBuffer *buf)
+{
+    FileHeader *hdr;
+    File *file;
+
+    if (!buf)
+        return;
+
+    while ((hdr = buf->headers))
+    {
+        buf->headers = hdr->next;
+        free(hdr);
+    }
+
+    // i file espulsi potrebbero essere ancora attraversati da lettori senza lock
+    while ((file = buf->evicted))
+    {
+        buf->evicted = file->next;
+
+        if (epochRetire(file, &freeFile) == -1)
+            perror("epochRetire");
+    }
+
+    if (buf->pinned)
+        epochExit();
+
+    free(buf->iov);
+
+    memset(buf, 0, sizeof(FileBuffer));
+}
+
+/**
+ * @brief Ritorna la partizione del filesystem 'fs' in cui si trova (o si troverebbe) il file il cui path ha hash 'hash'.
+ */
+static FsShard *getShard(Filesystem *fs, uint64_t hash)
+{
+    // uso bit diversi da quelli che la tabella hash usa per scegliere il gruppo e per i byte di controllo
+    return &(fs->shards[(hash >> 32) & (FS_SHARDS - 1)]);
+}
+
+/**
+ * @brief Cerca il file con pathname 'path' nella partizione 'shard' usando l'hash gia' calcolato.
+ */
+static File *findFile(FsShard *shard, const FsPath *path)
+{
+    return (File *)icl_hash_find_hashed(shard->hashTable, (void *)path->name, path->len, path->hash);
+}
+
+/**
+ * @brief Cerca il file con pathname 'path' senza prendere lock. Si assume che il chiamante sia in una sezione
+ *  epochEnter/epochExit: il file ritornato resta valido fino a epochExit.
+ */
+static File *lookupFile(Filesystem *fs, const FsPath *path)
+{
+    return findFile(getShard(fs, path->hash), path);
+}
+
+/**
+ * @brief Cerca il file con pathname 'path' e segnala che il thread chiamante ci sta operando: il file non potra' essere
+ *  deallocato finché non verra' chiamata releaseFile. Se 'touch' non e' TOUCH_NONE registra anche un accesso al file.
+ *
+ * \retval NULL se il file non esiste o e' in fase di espulsione (errno settato a ENOENT)
+ * \retval file puntatore al file, ritornato con la lock sul file acquisita
+ */
+static File *acquireFile(Filesystem *fs, const FsPath *path, int touch)
+{
+    FsShard *shard = getShard(fs, path->hash);
+    File *file;
+
+    LOCK(&(shard->shardLock));
+
+    file = findFile(shard, path);
+
+    if (!file)
+    {
+        UNLOCK(&(shard->shardLock));
+        errno = ENOENT;
+        return NULL;
+    }
+
+    // la lock sulla partizione impedisce che il file venga deallocato, e precede la lock sulla coda
+    if (touch)
+        touchFile(fs, file, touch);
+
     LOCK(&(file->fileLock));
 
-    // Attendo che non ci siano scrittori e lettori
-    while (file->nReaders > 0 || file->isWritten)
+    UNLOCK(&(shard->shardLock));
+
+    if (file->evicting)
     {
-        WAIT(&(file->readWrite), &(file->fileLock));
+        UNLOCK(&(file->fileLock));
+        errno = ENOENT;
+        return NULL;
     }
 
-    // Rimuovo il file dall coda del server
-    removeFileFromQueue(fs, file);
+    __atomic_add_fetch(&(file->users), 1, __ATOMIC_RELEASE);
 
-    // Rimuovo il file dall'hashtable
-    icl_hash_delete(fs->hastTable, file->path, NULL, NULL);
+    return file;
+}
 
-    // Se fornito mi salvo la lista dei client che attendono la lock su questo file
-    if (file->waitingForLock && *signalForLock)
+/**
+ * @brief Segnala che il thread chiamante ha terminato di operare sul file e rilascia la lock sul file.
+ *  Si assume che il chiamante abbia la lock sul file.
+ */
+static void releaseFile(File *file)
+{
+    if (__atomic_sub_fetch(&(file->users), 1, __ATOMIC_RELEASE) == 0)
     {
-        *signalForLock = file->waitingForLock;
-        file->waitingForLock = NULL;
+        BCAST(&(file->readWrite));
     }
 
-    // Elimino la lista dei client che hanno aperto questo file
-    if (file->openedBy)
-        deleteList(&(file->openedBy));
+    UNLOCK(&(file->fileLock));
+}
+
+/**
+ * @brief Sposta in ordine i client in attesa della lock sul file 'file' nella lista '*signalForLock', allocandola se
+ *  serve. Si assume che il chiamante abbia la mutua esclusione sul file.
+ */
+static void drainWaiters(File *file, fdList **signalForLock)
+{
+    int fd;
+
+    while ((fd = fdQueuePop(&(file->waitingForLock))))
+    {
+        if (!(*signalForLock) && !(*signalForLock = initList()))
+        {
+            perror("initList");
+            return;
+        }
+
+        if (insertNode(*signalForLock, fd) == -1)
+            perror("insertNode");
+    }
+}
+
+/**
+ * @brief Rimuove il file dal filesystem 'fs', se richiesto lo aggiunge al buffer 'evicted' e salva la lista dei client che
+ * attendevano la lock sul puntatore 'signalForLock' che dovra' essere deallocata dal chiamante.
+ * Si assume che il file sia gia' stato segnato come in fase di espulsione e rimosso dalla coda e che il chiamante non abbia
+ * nessuna lock.
+ *
+ * @param fs puntatore al filesystem
+ * @param file file da rimuovere
+ * @param evicted buffer a cui aggiungere il file, che verra' deallocato da releaseFileBuffer (puo' essere NULL)
+ * @param signalForLock puntatore alla lista di client che attendono la lock sul file (puo' essere NULL)
+ */
+static void deleteFile(Filesystem *fs, File *file, FileBuffer *evicted, fdList **signalForLock)
+{
+    FsShard *shard = getShard(fs, file->hash);
+
+    LOCK(&(file->fileLock));
+
+    // Attendo che nessun thread stia piu' operando sul file
+    while (file->users > 0)
+    {
+        WAIT(&(file->readWrite), &(file->fileLock));
+    }
 
-    // Ora il file non è più accessibile e posso rilasciare tranquillamente la lock
     UNLOCK(&(file->fileLock));
 
+    // Rimuovo il file dall'hashtable, i lettori senza lock potrebbero ancora stare confrontando il suo path
+    LOCK(&(shard->shardLock));
+    icl_hash_delete_hashed(shard->hashTable, file->path, file->pathLen, file->hash, NULL, NULL);
+    UNLOCK(&(shard->shardLock));
+
+    // Ora il file non è più raggiungibile da nessun nuovo thread e posso accederci senza lock
+
+    // Se fornito mi salvo la lista dei client che attendono la lock su questo file
+    if (signalForLock)
+        drainWaiters(file, signalForLock);
+
     // Aggiorno i valori del filesystem
+    LOCK(&(fs->queueLock));
     fs->currFiles--;
     fs->currMemory -= file->dataSize;
+    UNLOCK(&(fs->queueLock));
 
-    // Dealloco il file
-    freeFile((void *)file);
+    // Il file espulso verra' deallocato dopo essere stato inviato al client, senza copiarne i blocchi
+    if (evicted && addFileToBuffer(evicted, file, 1) == 0)
+    {
+        file->next = evicted->evicted;
+        evicted->evicted = file;
+    }
+    else if (epochRetire(file, &freeFile) == -1)
+        perror("epochRetire");
 }
 
-static File *getFile(Filesystem *fs, const char *path)
+/**
+ * @brief Espelle il file 'file', gia' preso con claimFile, aggiornando le statistiche del filesystem 'fs'. I parametri
+ *  'evicted' e 'signalForLock' sono quelli di deleteFile. Si assume di avere la lock sulla coda, che viene rilasciata
+ *  durante l'eliminazione del file e riacquisita prima di ritornare.
+ */
+static void expelFile(Filesystem *fs, File *file, FileBuffer *evicted, fdList **signalForLock, int clientFd)
 {
-    return (File *)icl_hash_find(fs->hastTable, (void *)path);
+    size_t dataSize = __atomic_load_n(&(file->dataSize), __ATOMIC_ACQUIRE);
+
+    fs->evictedFiles++;
+    fs->evictedBytes += dataSize;
+
+    UNLOCK(&(fs->queueLock));
+
+    logOperation(fs->logger_msg_queue, "evicted", file->path, clientFd, dataSize);
+
+    deleteFile(fs, file, evicted, signalForLock);
+
+    LOCK(&(fs->queueLock));
 }
 
 /**
- * @brief aggiunge un file al filesystem 'fs'. Si assume di avere la mutua esclusione sia sul filesytem che sul file.
+ * @brief Riserva lo spazio per 'dataSize' bytes del file 'file' o, se 'file' e' NULL, per un nuovo file, espellendo i file
+ * necessari. I file espulsi vengono aggiunti al buffer 'evicted', se fornito. Si assume che il chiamante non abbia nessuna lock.
+ * Se le vittime restano in uso per RESERVE_BUSY_RETRIES tentativi la richiesta fallisce: due scritture concorrenti
+ * potrebbero avere come unica vittima il file tenuto dall'altra, e nessuna delle due libererebbe mai il proprio.
+ *
+ * \retval 0 se successo
+ * \retval -1 se errore (errno settato)
+ */
+static int reserveSpace(Filesystem *fs, File *file, size_t dataSize, FileBuffer *evicted, fdList **signalForLock, int clientFd)
+{
+    File *toEvict;
+
+    int stalled = 0,
+        busyRetries = 0;
+
+    LOCK(&(fs->queueLock));
+
+    while (1)
+    {
+        // il file e' stato rimosso mentre attendevo
+        if (file && file->evicting)
+        {
+            UNLOCK(&(fs->queueLock));
+            errno = ENOENT;
+            return -1;
+        }
+
+        if (file && fs->currMemory + dataSize <= fs->maxMemory)
+        {
+            fs->currMemory += dataSize;
+            fs->absMaxMemory = MAX(fs->absMaxMemory, fs->currMemory);
+
+            // la priorita' di GDSF dipende dalla dimensione che il file avra' dopo la scrittura
+            resizeFile(fs, file, __atomic_load_n(&(file->dataSize), __ATOMIC_ACQUIRE) + dataSize);
+
+            break;
+        }
+
+        if (!file && fs->currFiles < fs->maxFiles)
+        {
+            fs->currFiles++;
+            fs->absMaxFiles = MAX(fs->absMaxFiles, fs->currFiles);
+            break;
+        }
+
+        toEvict = evictFile(fs, file);
+
+        if (!toEvict || claimFile(fs, toEvict, 0) == -1)
+        {
+            // i file da espellere sono in uso da altri thread, riprovo quando avranno terminato
+            if (errno == EBUSY && ++busyRetries < RESERVE_BUSY_RETRIES)
+            {
+                UNLOCK(&(fs->queueLock));
+                sched_yield();
+                LOCK(&(fs->queueLock));
+                continue;
+            }
+
+            if (errno == ECANCELED)
+                fs->rejectedWrites++;
+            else // nessuna vittima, o vittime rimaste in uso
+                errno = file ? EFBIG : ENOMEM;
+
+            UNLOCK(&(fs->queueLock));
+            return -1;
+        }
+
+        // il thread di espulsione non ha liberato abbastanza spazio in anticipo
+        if (!stalled)
+        {
+            stalled = 1;
+            fs->syncEvictions++;
+        }
+
+        expelFile(fs, toEvict, evicted, signalForLock, clientFd);
+    }
+
+    // sveglio il thread di espulsione prima che le prossime richieste debbano espellere file
+    if (fs->evictorActive && ABOVE_WATERMARK(fs, fs->highFiles, fs->highMemory))
+    {
+        SIGNAL(&(fs->evictorCond));
+    }
+
+    UNLOCK(&(fs->queueLock));
+
+    return 0;
+}
+
+/**
+ * @brief Libera lo spazio riservato con reserveSpace per un'operazione che non e' andata a buon fine.
+ */
+static void releaseSpace(Filesystem *fs, File *file, size_t dataSize)
+{
+    LOCK(&(fs->queueLock));
+
+    if (file)
+    {
+        fs->currMemory -= dataSize;
+
+        resizeFile(fs, file, __atomic_load_n(&(file->dataSize), __ATOMIC_ACQUIRE));
+    }
+    else
+        fs->currFiles--;
+
+    UNLOCK(&(fs->queueLock));
+}
+
+/**
+ * @brief aggiunge un file al filesystem 'fs'. Si assume di avere la mutua esclusione sulla partizione 'shard' del file
+ *  e che lo spazio per il file sia stato riservato con reserveSpace.
  *
  * @param fs filesytem a cui aggiungere il file
+ * @param shard partizione del file
  * @param file file da aggiungere
  * @return 0 se successo, -1 altrimenti e errno settato.
  */
-static int addFile(Filesystem *fs, File *file)
+static int addFile(Filesystem *fs, FsShard *shard, File *file)
 {
-    if (!fs || !file)
+    if (!fs || !shard || !file)
     {
         errno = EINVAL;
         return -1;
     }
 
+    // inizializzo i dati per il rimpiazzamento prima che il file diventi visibile ai lettori senza lock
+    file->insertionTime = file->lastUsed = TICK(fs); // Fifo e Lru
+    file->usedTimes = 1;                              // Lfu
+
     // Inserisco il file nell'hashtable
-    if (!icl_hash_insert(fs->hastTable, file->path, file))
+    if (!icl_hash_insert_hashed(shard->hashTable, file->path, file->pathLen, file->hash, file))
     {
         errno = ENOMEM;
         return -1;
     }
 
-    file->insertionTime = time(NULL); // Fifo
-    file->lastUsed = time(NULL);      // Lru
-    file->usedTimes = 1;              // Lfu
-    file->referenceBit = 1;           // Second-chance
-
     // Inserisco il file alla fine della coda
+    LOCK(&(fs->queueLock));
     addFileToQueue(fs, file);
-
-    fs->currFiles++;
-    fs->absMaxFiles = MAX(fs->absMaxFiles, fs->currFiles);
+    UNLOCK(&(fs->queueLock));
 
     return 0;
 }
 
 Filesystem *initFileSystem(size_t maxFiles, size_t maxMemory, int replacement_algo)
 {
-    int errnum;
+    int errnum,
+        nbuckets;
+
+    size_t i;
 
     if (maxFiles <= 0 || maxMemory <= 0)
     {
@@ -382,70 +801,368 @@ Filesystem *initFileSystem(size_t maxFiles, size_t maxMemory, int replacement_al
     newFilesystem->currMemory = 0;
     newFilesystem->absMaxMemory = 0;
 
-    newFilesystem->replacement_algo = replacement_algo;
+    if (!(newFilesystem->policy = getPolicy(replacement_algo)))
+    {
+        free(newFilesystem);
+        errno = EINVAL;
+        return NULL;
+    }
 
     newFilesystem->evictedFiles = 0;
+    newFilesystem->evictedBytes = 0;
+    newFilesystem->rejectedWrites = 0;
 
-    if ((errnum = pthread_mutex_init(&(newFilesystem->fileSystemLock), NULL)) != 0)
+    if ((errnum = pthread_mutex_init(&(newFilesystem->queueLock), NULL)) != 0)
     {
+        free(newFilesystem);
         errno = errnum;
         return NULL;
     }
 
-    newFilesystem->hastTable = icl_hash_create((int)(maxFiles * (0.75F)), NULL, NULL);
-    if (!newFilesystem->hastTable)
+    if ((errnum = pthread_cond_init(&(newFilesystem->evictorCond), NULL)) != 0)
     {
-        pthread_mutex_destroy(&(newFilesystem->fileSystemLock));
-        errno = ENOMEM;
+        pthread_mutex_destroy(&(newFilesystem->queueLock));
+        free(newFilesystem);
+        errno = errnum;
         return NULL;
     }
 
-    newFilesystem->logger_msg_queue = initBQueue(LOGGER_MSG_QUEUE_LEN);
+    nbuckets = MAX((int)(maxFiles * (0.75F) / FS_SHARDS), 1);
+
+    for (i = 0; i < FS_SHARDS; i++)
+    {
+        if ((errnum = pthread_mutex_init(&(newFilesystem->shards[i].shardLock), NULL)) != 0)
+            break;
+
+        newFilesystem->shards[i].hashTable = icl_hash_create(nbuckets, NULL, NULL);
+        if (!newFilesystem->shards[i].hashTable)
+        {
+            pthread_mutex_destroy(&(newFilesystem->shards[i].shardLock));
+            errnum = ENOMEM;
+            break;
+        }
+
+        // le tabelle sostituite quando la tabella cresce potrebbero essere ancora percorse dai lettori senza lock
+        icl_hash_set_retire(newFilesystem->shards[i].hashTable, &epochRetire);
+    }
+
+    if (i == FS_SHARDS)
+        newFilesystem->logger_msg_queue = initMPMCQueue(LOGGER_MSG_QUEUE_LEN);
 
     if (!newFilesystem->logger_msg_queue)
     {
-        pthread_mutex_destroy(&(newFilesystem->fileSystemLock));
-        icl_hash_destroy(newFilesystem->hastTable, NULL, NULL);
+        errnum = (i == FS_SHARDS) ? errno : errnum;
+
+        while (i-- > 0)
+        {
+            pthread_mutex_destroy(&(newFilesystem->shards[i].shardLock));
+            icl_hash_destroy(newFilesystem->shards[i].hashTable, NULL, NULL);
+        }
+
+        pthread_cond_destroy(&(newFilesystem->evictorCond));
+        pthread_mutex_destroy(&(newFilesystem->queueLock));
+        free(newFilesystem);
+        errno = errnum;
         return NULL;
     }
 
-    newFilesystem->file_queue_head = newFilesystem->file_queue_tail = NULL;
+    if (newFilesystem->policy->init(newFilesystem) == -1 || !(newFilesystem->mrc = initShards(newFilesystem->maxMemory)) ||
+        !(newFilesystem->sessions = initSessionTable()))
+    {
+        errnum = errno;
+        deleteFileSystem(newFilesystem);
+        errno = errnum;
+        return NULL;
+    }
+
+    return newFilesystem;
+}
+
+void deleteFileSystem(Filesystem *fs)
+{
+    size_t i;
+
+    if (!fs)
+    {
+        errno = EINVAL;
+        return;
+    }
+
+    for (i = 0; i < FS_SHARDS; i++)
+    {
+        icl_hash_destroy(fs->shards[i].hashTable, NULL, &freeFile);
+
+        CHECK_PTHREAD_AND_ACTION(pthread_mutex_destroy, !=, 0, ;, &(fs->shards[i].shardLock));
+    }
+
+    if (fs->policyState)
+        fs->policy->destroy(fs);
+
+    deleteShards(fs->mrc);
+    deleteSessionTable(fs->sessions);
+
+    CHECK_PTHREAD_AND_ACTION(pthread_cond_destroy, !=, 0, ;, &(fs->evictorCond));
+    CHECK_PTHREAD_AND_ACTION(pthread_mutex_destroy, !=, 0, ;, &(fs->queueLock));
+
+    // dealloco i file ancora in attesa che i lettori uscissero dalla loro epoca
+    epochCleanup();
+
+    deleteChunkPool();
+
+    deleteMPMCQueue(fs->logger_msg_queue, NULL);
+
+    free(fs);
+}
+
+void printFileSystem(Filesystem *fs)
+{
+    char *tmpFileName;
+    File *tmpFile;
+    int tmpIndex;
+    icl_entry_t *tmpEntry;
+    size_t i;
+
+    for (i = 0; i < FS_SHARDS; i++)
+    {
+        icl_hash_foreach(fs->shards[i].hashTable, tmpIndex, tmpEntry, tmpFileName, tmpFile, printf("File: %s\n", tmpFileName));
+    }
+}
+
+int getStatsHandler(Filesystem *fs, Scheduler *sched, char **buf, size_t *size)
+{
+    FILE *report;
+
+    size_t currFiles,
+        currMemory,
+        evictedFiles,
+        evictedBytes,
+        readHits,
+        readMisses,
+        droppedTouches;
+
+    if (!fs || !buf || !size)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    LOCK(&(fs->queueLock));
+    currFiles = fs->currFiles;
+    currMemory = fs->currMemory;
+    evictedFiles = fs->evictedFiles;
+    evictedBytes = fs->evictedBytes;
+    UNLOCK(&(fs->queueLock));
+
+    readHits = __atomic_load_n(&(fs->readHits), __ATOMIC_RELAXED);
+    readMisses = __atomic_load_n(&(fs->readMisses), __ATOMIC_RELAXED);
+    droppedTouches = __atomic_load_n(&(fs->droppedTouches), __ATOMIC_RELAXED);
+
+    if (!(report = open_memstream(buf, size)))
+        return -1;
+
+    fprintf(report, "Politica di rimpiazzamento: %s\n", fs->policy->name);
+    fprintf(report, "File presenti: %zu/%zu\nMemoria occupata: %zu/%zu bytes\n", currFiles, fs->maxFiles, currMemory,
+            fs->maxMemory);
+    fprintf(report, "File espulsi: %zu (%zu bytes)\n", evictedFiles, evictedBytes);
+    fprintf(report, "Hit ratio delle letture: %.2f%% (%zu/%zu)\n",
+            readHits + readMisses ? 100.0 * readHits / (readHits + readMisses) : 0.0, readHits, readHits + readMisses);
+    fprintf(report, "Letture non segnalate alla politica (coda occupata): %zu\n", droppedTouches);
+
+    shardsPrint(fs->mrc, report);
+
+    if (sched)
+        schedulerPrintStats(sched, report);
+
+    if (fclose(report) == EOF)
+    {
+        free(*buf);
+        *buf = NULL;
+        return -1;
+    }
+
+    // il client riceve anche il terminatore
+    (*size)++;
+
+    return 0;
+}
+
+int setWatermarks(Filesystem *fs, size_t highWatermark, size_t lowWatermark)
+{
+    if (!fs || highWatermark == 0 || highWatermark > 100 || lowWatermark >= highWatermark)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    LOCK(&(fs->queueLock));
+
+    fs->highFiles = fs->maxFiles * highWatermark / 100;
+    fs->highMemory = fs->maxMemory / 100 * highWatermark;
+    fs->lowFiles = fs->maxFiles * lowWatermark / 100;
+    fs->lowMemory = fs->maxMemory / 100 * lowWatermark;
+    fs->evictorActive = 1;
+
+    UNLOCK(&(fs->queueLock));
+
+    return 0;
+}
+
+void *evictInBackground(void *args)
+{
+    Filesystem *fs = (Filesystem *)args;
+    File *toEvict;
+    struct timespec retry;
+
+    LOCK(&(fs->queueLock));
+
+    while (!fs->evictorStop)
+    {
+        if (!ABOVE_WATERMARK(fs, fs->highFiles, fs->highMemory))
+        {
+            WAIT(&(fs->evictorCond), &(fs->queueLock));
+            continue;
+        }
+
+        // espello fino a scendere sotto la soglia bassa, cosi' le prossime richieste trovano spazio libero
+        while (!fs->evictorStop && ABOVE_WATERMARK(fs, fs->lowFiles, fs->lowMemory))
+        {
+            toEvict = evictFile(fs, NULL);
+
+            // i file in uso o con client in attesa della lock verranno espulsi dalle richieste, se necessario
+            if (!toEvict || claimFile(fs, toEvict, 1) == -1)
+                break;
+
+            fs->backgroundEvictions++;
+
+            expelFile(fs, toEvict, NULL, NULL, 0);
+        }
+
+        // non sono riuscito a scendere sotto la soglia alta: riprovo tra poco senza attendere nuove richieste
+        if (!fs->evictorStop && ABOVE_WATERMARK(fs, fs->highFiles, fs->highMemory))
+        {
+            clock_gettime(CLOCK_REALTIME, &retry);
+            retry.tv_nsec += EVICTOR_RETRY_MS * 1000000L;
+            retry.tv_sec += retry.tv_nsec / 1000000000L;
+            retry.tv_nsec %= 1000000000L;
+
+            TWAIT(&(fs->evictorCond), &(fs->queueLock), &retry);
+        }
+    }
+
+    UNLOCK(&(fs->queueLock));
+
+    return NULL;
+}
+
+void stopBackgroundEviction(Filesystem *fs)
+{
+    LOCK(&(fs->queueLock));
+
+    fs->evictorStop = 1;
+    SIGNAL(&(fs->evictorCond));
+
+    UNLOCK(&(fs->queueLock));
+}
+
+/**
+ * @brief Registra nella sessione del client 'clientFd' che ha aperto il file 'path', ne ha la lock o la attende. Se la
+ *  sessione non puo' registrarlo viene segnata come incompleta e alla sua uscita verranno controllati tutti i file.
+ */
+static void trackFile(Filesystem *fs, const FsPath *path, int clientFd)
+{
+    sessionAdd(fs->sessions, clientFd, path->name, path->len, path->hash);
+}
+
+/**
+ * @brief Rimuove il file 'path' dalla sessione del client 'clientFd', quando il client non lo ha piu' aperto e non ne
+ *  ha la lock.
+ */
+static void untrackFile(Filesystem *fs, const FsPath *path, int clientFd)
+{
+    sessionRemove(fs->sessions, clientFd, path->name, path->len, path->hash);
+}
+
+/**
+ * @brief Rilascia la lock del client 'clientFd' sul file 'file', passandola al primo client in attesa che viene aggiunto
+ *  a 'signalForLock', e rimuove il client dalle liste del file. Si assume che il chiamante abbia la lock sulla
+ *  partizione del file e sul file.
+ */
+static void releaseClientFromFile(File *file, fdList **signalForLock, int clientFd)
+{
+    int nextFd;
+
+    if (file->lockedBy == clientFd)
+    {
+        nextFd = fdQueuePop(&(file->waitingForLock));
+
+        file->lockedBy = 0;
+
+        if (nextFd)
+        {
+            if (!(*signalForLock))
+                *signalForLock = initList();
+
+            insertNode(*signalForLock, nextFd);
+
+            file->lockedBy = nextFd;
+        }
+    }
+
+    fdQueueRemove(&(file->waitingForLock), clientFd);
+    fdSetRemove(&(file->openedBy), clientFd);
+}
+
+/**
+ * @brief Rilascia i file del client 'clientFd' scorrendo tutti i file del filesystem, quando la sua sessione non e'
+ *  completa.
+ */
+static int releaseAllFiles(Filesystem *fs, fdList **signalForLock, int clientFd)
+{
+    File *currFile;
+
+    icl_hash_iter_t *iter;
+
+    size_t i;
+
+    for (i = 0; i < FS_SHARDS; i++)
+    {
+        LOCK(&(fs->shards[i].shardLock));
+
+        iter = icl_hash_iterator_create(fs->shards[i].hashTable);
 
-    return newFilesystem;
-}
+        if (!iter)
+        {
+            UNLOCK(&(fs->shards[i].shardLock));
+            errno = ENOMEM;
+            return -1;
+        }
 
-void deleteFileSystem(Filesystem *fs)
-{
-    if (!fs)
-    {
-        errno = EINVAL;
-        return;
-    }
+        while (icl_hash_next(iter) != 0)
+        {
+            currFile = (File *)iter->currEntry->data;
 
-    icl_hash_destroy(fs->hastTable, NULL, &freeFile);
+            // le liste del file sono protette dalla lock sul file, non serve attendere lettori e scrittori
+            LOCK(&(currFile->fileLock));
+            releaseClientFromFile(currFile, signalForLock, clientFd);
+            UNLOCK(&(currFile->fileLock));
+        }
 
-    CHECK_PTHREAD_AND_ACTION(pthread_mutex_destroy, !=, 0, ;, &(fs->fileSystemLock));
+        icl_hash_iterator_destroy(iter);
 
-    deleteBQueue(fs->logger_msg_queue, NULL);
+        UNLOCK(&(fs->shards[i].shardLock));
+    }
 
-    free(fs);
+    return 0;
 }
 
-void printFileSystem(Filesystem *fs)
+int openFileHandler(Filesystem *fs, const FsPath *path, int openFlags, fdList **signalForLock, int clientFd)
 {
-    char *tmpFileName;
-    File *tmpFile;
-    int tmpIndex;
-    icl_entry_t *tmpEntry;
-    icl_hash_foreach(fs->hastTable, tmpIndex, tmpEntry, tmpFileName, tmpFile, printf("File: %s\n", tmpFileName));
-}
+    File *file;
+    FsShard *shard;
 
-int openFileHandler(Filesystem *fs, const char *path, int openFlags, fdList **signalForLock, int clientFd)
-{
-    File *file,
-        *toEvict;
+    int exists;
 
-    if (!fs || !path || (clientFd <= 0))
+    if (!fs || !path || !path->name || (clientFd <= 0))
     {
         errno = EINVAL;
         return -1;
@@ -454,131 +1171,150 @@ int openFileHandler(Filesystem *fs, const char *path, int openFlags, fdList **si
     int create = FLAG_ISSET(openFlags, O_CREATE);
     int lock = FLAG_ISSET(openFlags, O_LOCK);
 
-    LOCK(&(fs->fileSystemLock));
-
-    file = getFile(fs, path);
-
-    // il file non esiste, ma non ho settato la flag O_CREATE
-    if (!file && !create)
-    {
-        UNLOCK(&(fs->fileSystemLock));
-        errno = ENOENT;
-        return -1;
-    }
-
-    // il file esiste, ma ho settato la flag O_CREATE
-    if (file && create)
-    {
-        UNLOCK(&(fs->fileSystemLock));
-        errno = EEXIST;
-        return -1;
-    }
-
-    // Dopo i check precedenti qua sono sicuro di creare un nuovo file solo se non esiste
-    if (create)
+    if (!create)
     {
-        file = initFile(path);
-
-        if (!file)
+        // il file non esiste
+        if (!(file = acquireFile(fs, path, TOUCH_OPEN)))
         {
-            UNLOCK(&(fs->fileSystemLock));
+            recordMiss(fs, path);
+            errno = ENOENT;
             return -1;
         }
 
-        if (fs->currFiles == fs->maxFiles)
+        shardsAccess(fs->mrc, path->hash, __atomic_load_n(&(file->dataSize), __ATOMIC_ACQUIRE));
+
+        if (lock)
         {
-            toEvict = evictFile(fs, NULL);
-            logOperation(fs->logger_msg_queue, "evicted", toEvict->path, clientFd, 0);
-            deleteFile(fs, toEvict, signalForLock);
+            // il file è già in stato di lock
+            if (file->lockedBy && file->lockedBy != clientFd)
+            {
+                releaseFile(file);
+                errno = EACCES;
+                return -1;
+            }
+
+            file->lockedBy = clientFd;
         }
 
-        CHECK_AND_ACTION(insertNode, ==, -1,
-                         UNLOCK(&(file->fileLock));
-                         UNLOCK(&(fs->fileSystemLock)); errno = ENOMEM; return -1, file->openedBy, clientFd);
+        CHECK_AND_ACTION(fdSetInsert, ==, -1, releaseFile(file); errno = ENOMEM; return -1, &(file->openedBy), clientFd);
 
-        logOperation(fs->logger_msg_queue, "openFile", path, clientFd, 0);
+        logOperation(fs->logger_msg_queue, "openFile", path->name, clientFd, 0);
 
         if (lock)
-        {
-            file->lockedBy = clientFd;
-            logOperation(fs->logger_msg_queue, "open-lock", path, clientFd, 0);
-        }
+            logOperation(fs->logger_msg_queue, "open-lock", path->name, clientFd, 0);
 
-        addFile(fs, file);
+        releaseFile(file);
 
-        UNLOCK(&(fs->fileSystemLock));
+        trackFile(fs, path, clientFd);
 
         return 0;
     }
 
-    LOCK(&(file->fileLock));
+    shard = getShard(fs, path->hash);
 
-    if (lock)
+    LOCK(&(shard->shardLock));
+    exists = findFile(shard, path) != NULL;
+    UNLOCK(&(shard->shardLock));
+
+    // il file esiste, ma ho settato la flag O_CREATE
+    if (exists)
     {
-        // il file è già in stato di lock
-        if (file->lockedBy && file->lockedBy != clientFd)
-        {
-            UNLOCK(&(file->fileLock));
-            UNLOCK(&(fs->fileSystemLock));
-            errno = EACCES;
-            return -1;
-        }
+        errno = EEXIST;
+        return -1;
+    }
+
+    file = initFile(path);
+
+    if (!file)
+        return -1;
+
+    if (reserveSpace(fs, NULL, 0, NULL, signalForLock, clientFd) == -1)
+    {
+        freeFile((void *)file);
+        return -1;
+    }
+
+    // il file non e' ancora visibile agli altri thread
+    CHECK_AND_ACTION(fdSetInsert, ==, -1,
+                     releaseSpace(fs, NULL, 0);
+                     freeFile((void *)file); errno = ENOMEM; return -1, &(file->openedBy), clientFd);
 
+    if (lock)
         file->lockedBy = clientFd;
+
+    LOCK(&(shard->shardLock));
+
+    // un altro client ha creato lo stesso file mentre liberavo spazio
+    if (findFile(shard, path) != NULL || addFile(fs, shard, file) == -1)
+    {
+        exists = findFile(shard, path) != NULL;
+        UNLOCK(&(shard->shardLock));
+        releaseSpace(fs, NULL, 0);
+        freeFile((void *)file);
+        errno = exists ? EEXIST : ENOMEM;
+        return -1;
     }
 
-    CHECK_AND_ACTION(insertNode, ==, -1,
-                     UNLOCK(&(file->fileLock));
-                     UNLOCK(&(fs->fileSystemLock)); errno = ENOMEM; return -1, file->openedBy, clientFd);
+    UNLOCK(&(shard->shardLock));
 
-    logOperation(fs->logger_msg_queue, "openFile", path, clientFd, 0);
+    shardsAccess(fs->mrc, path->hash, 0);
 
-    if (lock)
-        logOperation(fs->logger_msg_queue, "open-lock", path, clientFd, 0);
+    trackFile(fs, path, clientFd);
 
-    UNLOCK(&(file->fileLock));
-    UNLOCK(&(fs->fileSystemLock));
+    logOperation(fs->logger_msg_queue, "openFile", path->name, clientFd, 0);
+
+    if (lock)
+        logOperation(fs->logger_msg_queue, "open-lock", path->name, clientFd, 0);
 
     return 0;
 }
 
-int writeFileHandler(Filesystem *fs, const char *path, void *data, size_t dataSize, void **evicted_files, size_t *evicted_files_size, fdList **signalForLock, int clientFd)
+/**
+ * @brief Copia 'dataSize' bytes di 'data' nella lista di blocchi 'chunk'.
+ */
+static void copyToChunks(FileChunk *chunk, const char *data, size_t dataSize)
 {
-    File *file,
-        *toEvict;
-
-    char *fileData,
-        *toEvict_buf = NULL;
+    size_t len;
 
-    size_t toEvict_size = 0;
+    while (dataSize > 0)
+    {
+        len = MIN(dataSize, (size_t)FILE_CHUNK_SIZE);
 
-    fdList *tmp_signalForLock;
+        memcpy(chunk->data, data, len);
 
-    if (!fs || !path || !data || dataSize <= 0 || clientFd <= 0)
-    {
-        errno = EINVAL;
-        return -1;
+        data += len;
+        dataSize -= len;
+        chunk = chunk->next;
     }
+}
 
-    LOCK(&(fs->fileSystemLock));
+int writeFileHandler(Filesystem *fs, const FsPath *path, void *data, size_t dataSize, FileBuffer *evicted, fdList **signalForLock, int clientFd)
+{
+    File *file;
 
-    file = getFile(fs, path);
+    FileChunk *newChunks = NULL,
+              *lastNew = NULL,
+              *tmp;
 
-    // il file che voglio scrivere non esiste
-    if (!file)
+    size_t tailFree,
+        nNew,
+        len,
+        i;
+
+    if (!fs || !path || !path->name || !data || dataSize <= 0 || clientFd <= 0)
     {
-        UNLOCK(&(fs->fileSystemLock));
-        errno = ENOENT;
+        errno = EINVAL;
         return -1;
     }
 
-    LOCK(&(file->fileLock))
+    // il file che voglio scrivere non esiste
+    if (!(file = acquireFile(fs, path, TOUCH_NONE)))
+        return -1;
 
     // il file è in stato di lock oppure il client non ha aperto il file
-    if ((file->lockedBy && file->lockedBy != clientFd) || !findNode(file->openedBy, clientFd))
+    if ((file->lockedBy && file->lockedBy != clientFd) || !fdSetContains(&(file->openedBy), clientFd))
     {
-        UNLOCK(&(file->fileLock));
-        UNLOCK(&(fs->fileSystemLock));
+        releaseFile(file);
         errno = EACCES;
         return -1;
     }
@@ -586,416 +1322,410 @@ int writeFileHandler(Filesystem *fs, const char *path, void *data, size_t dataSi
     // I dati da scrivere sono troppi per lo storage
     if ((file->dataSize + dataSize) > fs->maxMemory)
     {
-        UNLOCK(&(file->fileLock));
-        UNLOCK(&(fs->fileSystemLock));
+        releaseFile(file);
         errno = EFBIG;
         return -1;
     }
 
-    // attendo finché non ci sono piu' lettori per scrivere il file
-    while (file->nReaders > 0)
+    UNLOCK(&(file->fileLock));
+
+    touchFile(fs, file, TOUCH_ACCESS);
+
+    // espello i file necessari senza avere lock, il file non puo' essere deallocato finché non chiamo releaseFile
+    if (reserveSpace(fs, file, dataSize, evicted, signalForLock, clientFd) == -1)
+    {
+        LOCK(&(file->fileLock));
+        releaseFile(file);
+        return -1;
+    }
+
+    LOCK(&(file->fileLock));
+
+    // attendo finché non ci sono altri scrittori, i lettori continuano a leggere i bytes gia' pubblicati
+    while (file->isWritten)
     {
         WAIT(&(file->readWrite), &(file->fileLock));
     }
 
     file->isWritten = 1;
 
-    UPDATE_FILE_REFERENCE(file);
-
     UNLOCK(&(file->fileLock));
 
-    fileData = calloc((file->dataSize + dataSize), sizeof(*fileData));
+    // spazio libero nell'ultimo blocco e nuovi blocchi necessari
+    tailFree = CHUNKS_FOR(file->dataSize) * FILE_CHUNK_SIZE - file->dataSize;
+    nNew = dataSize > tailFree ? CHUNKS_FOR(dataSize - tailFree) : 0;
 
-    if (!fileData)
+    for (i = 0; i < nNew; i++)
     {
-        errno = ENOMEM;
-        goto cleanup;
+        if (!(tmp = allocChunk()))
+            break;
+
+        if (lastNew)
+            lastNew->next = tmp;
+        else
+            newChunks = tmp;
+
+        lastNew = tmp;
     }
 
-    while (fs->currMemory + dataSize > fs->maxMemory)
+    if (i == nNew)
     {
-        tmp_signalForLock = NULL;
+        // scrivo i nuovi bytes oltre la dimensione pubblicata, nessun lettore puo' vederli
+        len = MIN(dataSize, tailFree);
 
-        toEvict = evictFile(fs, file);
+        if (len > 0)
+            memcpy(file->lastChunk->data + FILE_CHUNK_SIZE - tailFree, data, len);
 
-        logOperation(fs->logger_msg_queue, "evicted", toEvict->path, clientFd, 0);
+        copyToChunks(newChunks, (char *)data + len, dataSize - len);
 
-        copyFileToBuffer(toEvict, &toEvict_buf, &toEvict_size);
+        // collego i nuovi blocchi e solo dopo pubblico la nuova dimensione
+        if (newChunks)
+        {
+            if (file->lastChunk)
+                __atomic_store_n(&(file->lastChunk->next), newChunks, __ATOMIC_RELEASE);
+            else
+                __atomic_store_n(&(file->chunks), newChunks, __ATOMIC_RELEASE);
 
-        deleteFile(fs, toEvict, &tmp_signalForLock);
+            file->lastChunk = lastNew;
+        }
 
-        concanateList(signalForLock, tmp_signalForLock);
+        __atomic_store_n(&(file->dataSize), file->dataSize + dataSize, __ATOMIC_RELEASE);
 
-        deleteList(&tmp_signalForLock);
+        shardsAccess(fs->mrc, path->hash, file->dataSize);
     }
-
-    *evicted_files = toEvict_buf;
-    *evicted_files_size = toEvict_size;
-
-    // se il file ha già dei dati copio questi ultimi prima di copiare i dati nuovi
-    if (file->data)
+    else
     {
-        memcpy(fileData, file->data, file->dataSize);
-        free(file->data);
+        freeChunks(newChunks);
+        releaseSpace(fs, file, dataSize);
     }
 
-    // copio i file in append
-    memcpy(fileData + file->dataSize, data, dataSize);
-    file->data = fileData;
-    file->dataSize += dataSize;
-
-    fs->currMemory += file->dataSize;
-    fs->absMaxMemory = MAX(fs->absMaxMemory, fs->currMemory);
-
-    logOperation(fs->logger_msg_queue, "writeFile", path, clientFd, dataSize);
-
-cleanup:
     LOCK(&(file->fileLock));
 
     file->isWritten = 0;
 
-    BCAST(&(file->readWrite));
+    releaseFile(file);
 
-    UNLOCK(&(file->fileLock));
-    UNLOCK(&(fs->fileSystemLock));
+    if (i != nNew)
+    {
+        errno = ENOMEM;
+        return -1;
+    }
 
-    return errno ? -1 : 0;
+    logOperation(fs->logger_msg_queue, "writeFile", path->name, clientFd, dataSize);
+
+    return 0;
 }
 
-int readFileHandler(Filesystem *fs, const char *path, void **data_buf, size_t *dataSize, int clientFd)
+int readFileHandler(Filesystem *fs, const FsPath *path, FileBuffer *buf, int clientFd)
 {
-    if (!fs || !path || (clientFd <= 0))
+    File *file;
+
+    int lockedBy;
+
+    if (!fs || !path || !path->name || !buf || (clientFd <= 0))
     {
         errno = EINVAL;
         return -1;
     }
 
-    LOCK(&(fs->fileSystemLock));
+    if (epochEnter() == -1)
+        return -1;
 
-    File *file = getFile(fs, path);
+    file = lookupFile(fs, path);
 
-    // il file che voglio leggere non esiste
-    if (!file)
+    // il file che voglio leggere non esiste o sta per essere rimosso
+    if (!file || __atomic_load_n(&(file->evicting), __ATOMIC_ACQUIRE))
     {
-        UNLOCK(&(fs->fileSystemLock));
+        epochExit();
+        __atomic_add_fetch(&(fs->readMisses), 1, __ATOMIC_RELAXED);
+        recordMiss(fs, path);
         errno = ENOENT;
         return -1;
     }
 
-    LOCK(&(file->fileLock))
-
-    UNLOCK(&(fs->fileSystemLock));
+    lockedBy = __atomic_load_n(&(file->lockedBy), __ATOMIC_RELAXED);
 
-    // il file è in stato di lock oppure il client non ha aperto il file
-    if ((file->lockedBy && file->lockedBy != clientFd) || !findNode(file->openedBy, clientFd))
+    // il file è in stato di lock oppure il client non ha aperto il file. Solo il client stesso puo' modificare la propria
+    // presenza in openedBy, quindi l'insieme puo' essere letto senza lock.
+    if ((lockedBy && lockedBy != clientFd) || !fdSetContains(&(file->openedBy), clientFd))
     {
-        UNLOCK(&(file->fileLock));
+        epochExit();
         errno = EACCES;
         return -1;
     }
 
-    // attendo finché non ci sono scrittori
-    while (file->isWritten)
-    {
-        WAIT(&(file->readWrite), &(file->fileLock));
-    }
-
-    file->nReaders++;
-
-    UPDATE_FILE_REFERENCE(file);
-
-    UNLOCK(&(file->fileLock));
-
-    *data_buf = calloc(file->dataSize, sizeof(char));
-
-    if (!(*data_buf))
+    if (addFileToBuffer(buf, file, 0) == -1)
     {
-        errno = ENOMEM;
-        goto cleanup;
+        epochExit();
+        return -1;
     }
 
-    memcpy(*data_buf, file->data, file->dataSize);
+    touchFile(fs, file, TOUCH_READ);
 
-    *dataSize = file->dataSize;
+    shardsAccess(fs->mrc, path->hash, buf->size);
 
-    logOperation(fs->logger_msg_queue, "readFile", path, clientFd, file->dataSize);
+    __atomic_add_fetch(&(fs->readHits), 1, __ATOMIC_RELAXED);
 
-cleanup:
-
-    LOCK(&(file->fileLock))
-
-    file->nReaders--;
-
-    // Segnalo che non ci sono più lettori
-    if (!file->nReaders)
-    {
-        SIGNAL(&(file->readWrite));
-    }
+    // resto nella sezione di lettura finché i blocchi non sono stati inviati
+    buf->pinned = 1;
 
-    UNLOCK(&(file->fileLock));
+    logOperation(fs->logger_msg_queue, "readFile", path->name, clientFd, buf->size);
 
-    return errno ? -1 : 0;
+    return 0;
 }
 
-int readNFilesHandler(Filesystem *fs, const int upperLimit, void **data_buf, size_t *dataSize, int clientFd)
+int readNFilesHandler(Filesystem *fs, const int upperLimit, FileBuffer *buf, int clientFd)
 {
-    int readCount;
-
-    size_t bufCurrSize = 0;
+    int readCount = 0;
 
-    char *file_data_buf = NULL;
+    size_t i;
 
     File *currFile;
 
     icl_hash_iter_t *iter;
 
-    if (!fs)
+    if (!fs || !buf)
     {
         errno = EINVAL;
         return -1;
     }
 
-    LOCK(&(fs->fileSystemLock));
+    if (epochEnter() == -1)
+        return -1;
 
-    iter = icl_hash_iterator_create(fs->hastTable);
+    // resto nella sezione di lettura finché i blocchi non sono stati inviati
+    buf->pinned = 1;
 
-    if (!iter)
+    for (i = 0; i < FS_SHARDS && (readCount < upperLimit || upperLimit <= 0); i++)
     {
-        UNLOCK(&(fs->fileSystemLock));
-        errno = ENOMEM;
-        return -1;
-    }
-
-    if (icl_hash_next(iter) == 0)
-        goto cleanup;
+        LOCK(&(fs->shards[i].shardLock));
 
-    currFile = (File *)iter->currEntry->data;
+        iter = icl_hash_iterator_create(fs->shards[i].hashTable);
 
-    readCount = 0;
-    while (currFile && (readCount < upperLimit || upperLimit <= 0))
-    {
-        if (copyFileToBuffer(currFile, &file_data_buf, &bufCurrSize) == -1)
-            break;
+        if (!iter)
+        {
+            UNLOCK(&(fs->shards[i].shardLock));
+            errno = ENOMEM;
+            return -1;
+        }
 
-        readCount++;
+        while ((readCount < upperLimit || upperLimit <= 0) && icl_hash_next(iter) != 0)
+        {
+            currFile = (File *)iter->currEntry->data;
 
-        if (icl_hash_next(iter) == 0)
-            break;
+            // il file sta per essere rimosso
+            if (__atomic_load_n(&(currFile->evicting), __ATOMIC_ACQUIRE))
+                continue;
 
-        currFile = (File *)iter->currEntry->data;
-    }
+            // aggiungo i bytes pubblicati senza attendere eventuali scrittori
+            if (addFileToBuffer(buf, currFile, 1) == -1)
+                break;
 
-cleanup:
-    icl_hash_iterator_destroy(iter);
+            readCount++;
+        }
 
-    UNLOCK(&(fs->fileSystemLock));
+        icl_hash_iterator_destroy(iter);
 
-    *data_buf = file_data_buf;
-    *dataSize = bufCurrSize;
+        UNLOCK(&(fs->shards[i].shardLock));
+    }
 
-    logOperation(fs->logger_msg_queue, "readFile", "readNFiles", clientFd, bufCurrSize);
+    logOperation(fs->logger_msg_queue, "readFile", "readNFiles", clientFd, buf->size);
     return readCount;
 }
 
-int lockFileHandler(Filesystem *fs, const char *path, int clientFd)
+int lockFileHandler(Filesystem *fs, const FsPath *path, int clientFd)
 {
     File *file;
 
-    if (!fs || !path || (clientFd <= 0))
+    if (!fs || !path || !path->name || (clientFd <= 0))
     {
         errno = EINVAL;
         return -1;
     }
 
-    LOCK(&(fs->fileSystemLock));
-
-    file = getFile(fs, path);
-
-    if (!file)
-    {
-        UNLOCK(&(fs->fileSystemLock));
-        errno = ENOENT;
+    if (!(file = acquireFile(fs, path, TOUCH_ACCESS)))
         return -1;
-    }
-
-    LOCK(&(file->fileLock));
 
-    UNLOCK(&(fs->fileSystemLock));
-
-    while (file->nReaders > 0 || file->isWritten)
+    while (file->isWritten)
     {
         WAIT(&(file->readWrite), &(file->fileLock));
     }
 
-    UPDATE_FILE_REFERENCE(file);
-
     if (file->lockedBy && file->lockedBy != clientFd)
     {
-        CHECK_AND_ACTION(insertNode, ==, -1, return -1, file->waitingForLock, clientFd);
-        logOperation(fs->logger_msg_queue, "lockFile", path, clientFd, 1);
-        UNLOCK(&(file->fileLock));
+        CHECK_AND_ACTION(fdQueuePush, ==, -1, releaseFile(file); errno = ENOMEM; return -1, &(file->waitingForLock), clientFd);
+        logOperation(fs->logger_msg_queue, "lockFile", path->name, clientFd, 1);
+        releaseFile(file);
+        trackFile(fs, path, clientFd);
         return -2;
     }
 
     file->lockedBy = clientFd;
-    logOperation(fs->logger_msg_queue, "lockFile", path, clientFd, 0);
+    logOperation(fs->logger_msg_queue, "lockFile", path->name, clientFd, 0);
 
     BCAST(&(file->readWrite));
 
-    UNLOCK(&(file->fileLock));
+    releaseFile(file);
+
+    trackFile(fs, path, clientFd);
 
     return 0;
 }
 
-int unlockFileHandler(Filesystem *fs, const char *path, int *nextLockFd, int clientFd)
+int unlockFileHandler(Filesystem *fs, const FsPath *path, int *nextLockFd, int clientFd)
 {
     File *file;
-    fdNode *nextLock;
+    int nextLock,
+        opened;
 
-    if (!fs || !path || (clientFd <= 0))
+    if (!fs || !path || !path->name || (clientFd <= 0))
     {
         errno = EINVAL;
         return -1;
     }
 
-    LOCK(&(fs->fileSystemLock));
-
-    file = getFile(fs, path);
-
-    if (!file)
+    if (!(file = acquireFile(fs, path, TOUCH_ACCESS)))
     {
-        UNLOCK(&(fs->fileSystemLock));
-        errno = ENOENT;
+        untrackFile(fs, path, clientFd);
         return -1;
     }
 
-    LOCK(&(file->fileLock));
-
-    UNLOCK(&(fs->fileSystemLock));
-
-    while (file->nReaders > 0 || file->isWritten)
+    while (file->isWritten)
     {
         WAIT(&(file->readWrite), &(file->fileLock));
     }
 
-    UPDATE_FILE_REFERENCE(file);
-
     // il file è in stato di lock da parte di un altro processo
     if (file->lockedBy != clientFd)
     {
-        UNLOCK(&(file->fileLock));
+        releaseFile(file);
         errno = EACCES;
         return -1;
     }
 
     *nextLockFd = file->lockedBy = 0;
 
-    logOperation(fs->logger_msg_queue, "unlockFile", path, clientFd, 0);
+    logOperation(fs->logger_msg_queue, "unlockFile", path->name, clientFd, 0);
 
-    nextLock = popNode(file->waitingForLock);
+    nextLock = fdQueuePop(&(file->waitingForLock));
 
     if (nextLock)
-        *nextLockFd = file->lockedBy = nextLock->fd;
+        *nextLockFd = file->lockedBy = nextLock;
 
-    deleteNode(nextLock);
+    opened = fdSetContains(&(file->openedBy), clientFd);
 
     BCAST(&(file->readWrite));
 
-    UNLOCK(&(file->fileLock));
+    releaseFile(file);
+
+    if (!opened)
+        untrackFile(fs, path, clientFd);
 
     return 0;
 }
 
-int removeFileHandler(Filesystem *fs, const char *path, fdList **signalForLock, int clientFd)
+int removeFileHandler(Filesystem *fs, const FsPath *path, fdList **signalForLock, int clientFd)
 {
     File *file;
 
-    if (!fs || !path || (clientFd <= 0))
+    if (!fs || !path || !path->name || (clientFd <= 0))
     {
         errno = EINVAL;
         return -1;
     }
 
-    LOCK(&(fs->fileSystemLock));
-
-    file = getFile(fs, path);
-
     // il file non esiste
-    if (!file)
-    {
-        UNLOCK(&(fs->fileSystemLock));
-        errno = ENOENT;
+    if (!(file = acquireFile(fs, path, TOUCH_NONE)))
         return -1;
-    }
+
     // il file è in stato di lock da parte di un altro processo o non è in stato di lock
     if (!file->lockedBy || file->lockedBy != clientFd)
     {
-        UNLOCK(&(fs->fileSystemLock));
         errno = !file->lockedBy ? EINVAL : EACCES;
+        releaseFile(file);
+        return -1;
+    }
+
+    // rispetto l'ordine delle lock: prima la coda e poi il file
+    UNLOCK(&(file->fileLock));
+    LOCK(&(fs->queueLock));
+    LOCK(&(file->fileLock));
+
+    // il file e' stato espulso nel frattempo
+    if (file->evicting)
+    {
+        releaseFile(file);
+        UNLOCK(&(fs->queueLock));
+        errno = ENOENT;
         return -1;
     }
 
-    deleteFile(fs, file, signalForLock);
-    logOperation(fs->logger_msg_queue, "removeFile", path, clientFd, 0);
+    file->evicting = 1;
+
+    releaseFile(file);
+
+    removeFileFromQueue(fs, file, 0);
+
+    UNLOCK(&(fs->queueLock));
 
-    UNLOCK(&(fs->fileSystemLock));
+    deleteFile(fs, file, NULL, signalForLock);
+    untrackFile(fs, path, clientFd);
+    logOperation(fs->logger_msg_queue, "removeFile", path->name, clientFd, 0);
 
     return 0;
 }
 
-int closeFileHandler(Filesystem *fs, const char *path, int clientFd)
+int closeFileHandler(Filesystem *fs, const FsPath *path, int clientFd)
 {
     File *file;
-    fdNode *fdToClose;
+    int locked;
 
-    if (!fs || !path || (clientFd <= 0))
+    if (!fs || !path || !path->name || (clientFd <= 0))
     {
         errno = EINVAL;
         return -1;
     }
 
-    LOCK(&(fs->fileSystemLock));
-
-    file = getFile(fs, path);
-
     // il file che voglio chiudere non esiste
-    if (!file)
+    if (!(file = acquireFile(fs, path, TOUCH_ACCESS)))
     {
-        UNLOCK(&(fs->fileSystemLock));
-        errno = ENOENT;
+        untrackFile(fs, path, clientFd);
         return -1;
     }
 
-    LOCK(&(file->fileLock));
-
-    while (file->nReaders > 0 || file->isWritten)
+    while (file->isWritten)
     {
         WAIT(&(file->readWrite), &(file->fileLock));
     }
 
-    UPDATE_FILE_REFERENCE(file);
+    // Rimuovo l'fd del client dall'insieme di quelli che hanno aperto il file
+    fdSetRemove(&(file->openedBy), clientFd);
 
-    // Rimuovo l'fd del client dalla lista di quelli aperti.
-    fdToClose = getNode(file->openedBy, clientFd);
-    deleteNode(fdToClose);
+    logOperation(fs->logger_msg_queue, "closeFile", path->name, clientFd, 0);
 
-    logOperation(fs->logger_msg_queue, "closeFile", path, clientFd, 0);
+    locked = (file->lockedBy == clientFd);
 
     BCAST(&(file->readWrite));
 
-    UNLOCK(&(file->fileLock));
-    UNLOCK(&(fs->fileSystemLock));
+    releaseFile(file);
+
+    if (!locked)
+        untrackFile(fs, path, clientFd);
 
     return 0;
 }
 
 int clientExitHandler(Filesystem *fs, fdList **signalForLock, int clientFd)
 {
+    ClientSession *session;
+    FsShard *shard;
     File *currFile;
+    icl_entry_t *entry;
+    FsPath path;
 
-    icl_hash_iter_t *iter;
+    int complete;
 
-    fdNode *tmp;
+    size_t i;
 
     if (!fs || clientFd <= 0)
     {
@@ -1003,101 +1733,65 @@ int clientExitHandler(Filesystem *fs, fdList **signalForLock, int clientFd)
         return -1;
     }
 
-    LOCK(&(fs->fileSystemLock));
+    session = detachSession(fs->sessions, clientFd, &complete);
 
-    iter = icl_hash_iterator_create(fs->hastTable);
-
-    if (!iter)
+    // la sessione potrebbe non contenere tutti i file del client: li controllo tutti
+    if (!complete)
     {
-        UNLOCK(&(fs->fileSystemLock));
-        errno = ENOMEM;
-        return -1;
+        deleteSession(session);
+        return releaseAllFiles(fs, signalForLock, clientFd);
     }
 
-    if (icl_hash_next(iter) == 0)
-        goto cleanup;
-
-    currFile = (File *)iter->currEntry->data;
+    if (!session)
+        return 0;
 
-    while (currFile)
+    for (i = 0; i < icl_hash_capacity(session->paths); i++)
     {
-        LOCK(&(currFile->fileLock));
-
-        while (currFile->nReaders > 0 || currFile->isWritten)
-        {
-            WAIT(&(currFile->readWrite), &(currFile->fileLock));
-        }
-
-        if (currFile->lockedBy == clientFd)
-        {
-            fdNode *nextNode = popNode(currFile->waitingForLock);
+        if (!(entry = icl_hash_slot(session->paths, i)) || !entry->key)
+            continue;
 
-            currFile->lockedBy = 0;
+        path.name = entry->key;
+        path.len = entry->len;
+        path.hash = entry->hash;
 
-            if (nextNode)
-            {
-                if (!(*signalForLock))
-                    *signalForLock = initList();
-
-                insertNode(*signalForLock, nextNode->fd);
+        shard = getShard(fs, path.hash);
 
-                currFile->lockedBy = nextNode->fd;
-            }
+        // tengo la lock sulla partizione come releaseAllFiles, cosi' il file non puo' essere rimosso dalla tabella
+        LOCK(&(shard->shardLock));
 
-            deleteNode(nextNode);
+        if ((currFile = findFile(shard, &path)))
+        {
+            LOCK(&(currFile->fileLock));
+            releaseClientFromFile(currFile, signalForLock, clientFd);
+            UNLOCK(&(currFile->fileLock));
         }
 
-        tmp = getNode(currFile->waitingForLock, clientFd);
-        deleteNode(tmp);
-
-        tmp = getNode(currFile->openedBy, clientFd);
-        deleteNode(tmp);
-
-        UNLOCK(&(currFile->fileLock));
-
-        if (icl_hash_next(iter) == 0)
-            break;
-
-        currFile = (File *)iter->currEntry->data;
+        UNLOCK(&(shard->shardLock));
     }
 
-cleanup:
-    icl_hash_iterator_destroy(iter);
-
-    UNLOCK(&(fs->fileSystemLock));
+    deleteSession(session);
 
     return 0;
 }
 
-int canWrite(Filesystem *fs, const char *path, int clientFd)
+int canWrite(Filesystem *fs, const FsPath *path, int clientFd)
 {
     int canWrite;
     File *file;
 
-    if (!fs || !path || (clientFd <= 0))
+    if (!fs || !path || !path->name || (clientFd <= 0))
     {
         errno = EINVAL;
         return -1;
     }
 
-    LOCK(&(fs->fileSystemLock));
-
-    file = getFile(fs, path);
-
     // il file non esiste
-    if (!file)
-    {
-        UNLOCK(&(fs->fileSystemLock));
-        errno = ENOENT;
+    if (!(file = acquireFile(fs, path, TOUCH_NONE)))
         return -1;
-    }
 
-    LOCK(&(file->fileLock));
-
-    canWrite = (file->lockedBy == clientFd && findNode(file->openedBy, clientFd));
+    canWrite = (file->lockedBy == clientFd && fdSetContains(&(file->openedBy), clientFd));
 
-    UNLOCK(&(file->fileLock));
-    UNLOCK(&(fs->fileSystemLock));
+    releaseFile(file);
 
     return canWrite;
-}
\ No newline at end of file
+}
@@ -5,95 +5,593 @@
  *
  * This simple hash table implementation should be easy to drop into
  * any other peice of code, it does not depend on anything else :-)
- * 
+ *
+ * The table uses open addressing in the style of Swiss tables: every slot
+ * has a control byte holding 7 bits of the hash of its key (or the empty
+ * and deleted markers) and lookups compare a whole group of control bytes
+ * at once, with SSE2 or with 64-bit words. Entries live in the slots
+ * together with their cached 64-bit hash and key length, so there is no
+ * allocation per entry and a lookup only compares the key of the
+ * candidates whose control byte, hash and length all match. Callers that
+ * already know the length and the hash of a key (see icl_hash_bytes) can
+ * pass them with the _hashed functions.
+ *
+ * When the table gets too full a bigger table is allocated and every later
+ * insert or delete migrates a few slots of the old one, so no request pays
+ * for a full rehash. Writers must be serialized by the caller. Readers
+ * (icl_hash_find) can run concurrently with a writer: they validate what
+ * they read against a sequence counter and retry if a writer was active.
+ * If keys and data can be freed while a reader may still be looking at
+ * them, the caller must defer it (e.g. with epoch based reclamation) and
+ * set the same deferred free for the replaced tables with
+ * icl_hash_set_retire.
+ *
  * @author Jakub Kurzak
  */
 /* $Id: icl_hash.c 2838 2011-11-22 04:25:02Z mfaverge $ */
 /* $UTK_Copyright: $ */
 
+#include "../include/define_source.h"
+
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
-#include <assert.h>
+#include <sched.h>
 
 #include "../include/icl_hash.h"
 
-#include <limits.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+
+#define CTRL_EMPTY      0xFF    /* never used slot: a lookup can stop at a group with an empty slot */
+#define CTRL_DELETED    0x80    /* removed entry: a lookup must go on probing */
+#define IS_FREE(ctrl)   ((ctrl) & 0x80) /* full slots hold 7 bits of the hash, with the high bit clear */
+#define SPIN_LIMIT      64      /* busy waits of a reader before yielding to a preempted writer */
+
+#define MAX_LOAD_NUM    7       /* a table is replaced when full and deleted slots exceed 7/8 of it */
+#define MAX_LOAD_DEN    8
+#define MIGRATE_STEP    (2 * GROUP_WIDTH) /* slots of the old table migrated by every insert or delete */
+
+#define TABLE_HEADER    ((sizeof(icl_table_t) + 15) & ~(size_t)15)
+
+#if defined(__SSE2__)
+
+#define GROUP_WIDTH     16
+#define BITMASK_SHIFT   0
+
+typedef unsigned int bitmask_t;
+
+static bitmask_t
+group_match(const unsigned char *group, unsigned char h2)
+{
+    __m128i ctrl = _mm_loadu_si128((const __m128i *)group);
+
+    return (bitmask_t)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char)h2)));
+}
+
+static bitmask_t
+group_match_empty(const unsigned char *group)
+{
+    __m128i ctrl = _mm_loadu_si128((const __m128i *)group);
+
+    return (bitmask_t)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char)CTRL_EMPTY)));
+}
+
+/* empty or deleted slots: the only control bytes with the high bit set */
+static bitmask_t
+group_match_free(const unsigned char *group)
+{
+    return (bitmask_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)group));
+}
+
+#else
+
+#define GROUP_WIDTH     8
+#define BITMASK_SHIFT   3
+
+#define LSB_BYTES       0x0101010101010101ULL
+#define MSB_BYTES       0x8080808080808080ULL
+
+typedef uint64_t bitmask_t;
+
+/* the control bytes of a group as a word, first byte in the low bits */
+static uint64_t
+group_load(const unsigned char *group)
+{
+    uint64_t word = __atomic_load_n((const uint64_t *)group, __ATOMIC_RELAXED);
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    word = __builtin_bswap64(word);
+#endif
+
+    return word;
+}
+
+/* may report a false match right after a real one, the caller checks the hash anyway */
+static bitmask_t
+group_match(const unsigned char *group, unsigned char h2)
+{
+    uint64_t cmp = group_load(group) ^ (LSB_BYTES * h2);
+
+    return (cmp - LSB_BYTES) & ~cmp & MSB_BYTES;
+}
+
+static bitmask_t
+group_match_empty(const unsigned char *group)
+{
+    uint64_t word = group_load(group);
+
+    return word & (word << 1) & MSB_BYTES;
+}
+
+static bitmask_t
+group_match_free(const unsigned char *group)
+{
+    return group_load(group) & MSB_BYTES;
+}
+
+#endif
+
+#define BITMASK_LOWEST(mask) ((size_t)__builtin_ctzll(mask) >> BITMASK_SHIFT)
+
+/* secrets of wyhash, odd numbers with 32 bits set */
+static const uint64_t wyp[4] = {0x2d358dccaa6c78a5ULL, 0x8bb84b93962eacc9ULL, 0x4b33a62ed433d4a3ULL, 0x4d5a2da51de1aa47ULL};
+
+#if defined(__SIZEOF_INT128__)
+__extension__ typedef unsigned __int128 u128_t;
+
+/* 64x64 -> 128 bit multiply: low half in *a, high half in *b */
+static void
+wymum(uint64_t *a, uint64_t *b)
+{
+    u128_t r = (u128_t)*a * *b;
+
+    *a = (uint64_t)r;
+    *b = (uint64_t)(r >> 64);
+}
+#else
+static void
+wymum(uint64_t *a, uint64_t *b)
+{
+    uint64_t ha = *a >> 32, hb = *b >> 32, la = (uint32_t)*a, lb = (uint32_t)*b,
+        rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb, t = rl + (rm0 << 32), c = t < rl, lo, hi;
+
+    lo = t + (rm1 << 32);
+    c += lo < t;
+    hi = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+
+    *a = lo;
+    *b = hi;
+}
+#endif
 
+static uint64_t
+wymix(uint64_t a, uint64_t b)
+{
+    wymum(&a, &b);
+    return a ^ b;
+}
+
+static uint64_t
+wyr8(const unsigned char *p)
+{
+    uint64_t v;
+
+    memcpy(&v, p, 8);
+    return v;
+}
+
+static uint64_t
+wyr4(const unsigned char *p)
+{
+    uint32_t v;
+
+    memcpy(&v, p, 4);
+    return v;
+}
+
+/* 1, 2 or 3 bytes */
+static uint64_t
+wyr3(const unsigned char *p, size_t k)
+{
+    return ((uint64_t)p[0] << 16) | ((uint64_t)p[k >> 1] << 8) | p[k - 1];
+}
 
-#define BITS_IN_int     ( sizeof(int) * CHAR_BIT )
-#define THREE_QUARTERS  ((int) ((BITS_IN_int * 3) / 4))
-#define ONE_EIGHTH      ((int) (BITS_IN_int / 8))
-#define HIGH_BITS       ( ~((unsigned int)(~0) >> ONE_EIGHTH ))
 /**
- * A simple string hash.
+ * Hash of 'len' bytes of 'data': wyhash (Wang Yi, public domain). Reads
+ * 16 bytes per step with two 8-byte loads and one 128-bit multiply, and
+ * 48 bytes per step on three independent lanes for long keys such as
+ * absolute paths. The bits are well spread: the table uses the low ones
+ * to choose the first group and the high ones for the control bytes.
+ *
+ * @param[in] data -- the bytes to be hashed
+ * @param[in] len -- number of bytes
  *
- * An adaptation of Peter Weinberger's (PJW) generic hashing
- * algorithm based on Allen Holub's version. Accepts a pointer
- * to a datum to be hashed and returns an unsigned integer.
- * From: Keith Seymour's proxy library code
+ * @returns the 64-bit hash
+ */
+uint64_t
+icl_hash_bytes(const void *data, size_t len)
+{
+    const unsigned char *p = (const unsigned char *)data;
+    uint64_t seed = wymix(wyp[0], wyp[1]), see1, see2, a, b;
+    size_t i = len;
+
+    if (len <= 16) {
+        if (len >= 4) {
+            a = (wyr4(p) << 32) | wyr4(p + ((len >> 3) << 2));
+            b = (wyr4(p + len - 4) << 32) | wyr4(p + len - 4 - ((len >> 3) << 2));
+        }
+        else if (len > 0) {
+            a = wyr3(p, len);
+            b = 0;
+        }
+        else
+            a = b = 0;
+    }
+    else {
+        if (i > 48) {
+            see1 = see2 = seed;
+
+            do {
+                seed = wymix(wyr8(p) ^ wyp[1], wyr8(p + 8) ^ seed);
+                see1 = wymix(wyr8(p + 16) ^ wyp[2], wyr8(p + 24) ^ see1);
+                see2 = wymix(wyr8(p + 32) ^ wyp[3], wyr8(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while (i > 48);
+
+            seed ^= see1 ^ see2;
+        }
+
+        while (i > 16) {
+            seed = wymix(wyr8(p) ^ wyp[1], wyr8(p + 8) ^ seed);
+            p += 16;
+            i -= 16;
+        }
+
+        a = wyr8(p + i - 16);
+        b = wyr8(p + i - 8);
+    }
+
+    a ^= wyp[1];
+    b ^= seed;
+    wymum(&a, &b);
+
+    return wymix(a ^ wyp[0] ^ len, b ^ wyp[1]);
+}
+
+/**
+ * Default hash of a string key.
  *
  * @param[in] key -- the string to be hashed
  *
- * @returns the hash index
+ * @returns the 64-bit hash
  */
-unsigned int
-hash_pjw(void* key)
+uint64_t
+hash_string(void* key)
 {
-    char *datum = (char *)key;
-    unsigned int hash_value, i;
+    if(!key) return 0;
+
+    return icl_hash_bytes(key, strlen((char *)key));
+}
+
+int string_compare(void* a, void* b)
+{
+    return (strcmp( (char*)a, (char*)b ) == 0);
+}
+
+#define H2(hash) ((unsigned char)((hash) >> 57))
 
-    if(!datum) return 0;
+/* reader side of the sequence counter: wait for the writer to finish */
+static unsigned long
+read_begin(icl_hash_t *ht)
+{
+    unsigned long seq;
+    int spins = 0;
 
-    for (hash_value = 0; *datum; ++datum) {
-        hash_value = (hash_value << ONE_EIGHTH) + *datum;
-        if ((i = hash_value & HIGH_BITS) != 0)
-            hash_value = (hash_value ^ (i >> THREE_QUARTERS)) & ~HIGH_BITS;
+    while ((seq = __atomic_load_n(&ht->seq, __ATOMIC_ACQUIRE)) & 1) {
+        if (++spins == SPIN_LIMIT) {
+            spins = 0;
+            sched_yield();
+        }
     }
-    return (hash_value);
+
+    return seq;
 }
 
-int string_compare(void* a, void* b) 
+/* returns 1 if a writer modified the tables since read_begin returned 'seq' */
+static int
+read_retry(icl_hash_t *ht, unsigned long seq)
 {
-    return (strcmp( (char*)a, (char*)b ) == 0);
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+    return __atomic_load_n(&ht->seq, __ATOMIC_RELAXED) != seq;
+}
+
+static void
+write_begin(icl_hash_t *ht)
+{
+    __atomic_store_n(&ht->seq, ht->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static void
+write_end(icl_hash_t *ht)
+{
+    __atomic_store_n(&ht->seq, ht->seq + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * Allocate an empty table of 'capacity' slots (a power of 2, at least a
+ * group) with control bytes and slots in the same block.
+ */
+static icl_table_t *
+table_create(size_t capacity)
+{
+    icl_table_t *t;
+
+    t = (icl_table_t*) malloc(TABLE_HEADER + capacity + capacity * sizeof(icl_entry_t));
+    if(!t) return NULL;
+
+    t->capacity = capacity;
+    t->used = 0;
+    t->ctrl = (unsigned char *)t + TABLE_HEADER;
+    t->slots = (icl_entry_t *)(t->ctrl + capacity);
+
+    memset(t->ctrl, CTRL_EMPTY, capacity);
+    memset(t->slots, 0, capacity * sizeof(icl_entry_t));
+
+    return t;
+}
+
+static void
+table_free(icl_hash_t *ht, icl_table_t *t)
+{
+    /* on failure the table is leaked: a reader may still be probing it */
+    if (ht->retire)
+        (* ht->retire)(t, free);
+    else
+        free(t);
+}
+
+/**
+ * Probe 'table' for 'key'. The groups are visited with triangular steps,
+ * which cover all of them since their number is a power of 2.
+ *
+ * @returns the slot of the key, NULL if the key is not in the table.
+ */
+static icl_entry_t *
+table_find(icl_hash_t *ht, icl_table_t *t, uint64_t hash, void *key, size_t len)
+{
+    size_t ngroups = t->capacity / GROUP_WIDTH,
+        group = hash & (ngroups - 1),
+        step, pos;
+    icl_entry_t *slot;
+    bitmask_t match;
+    void *slot_key;
+
+    for (step = 1; step <= ngroups; group = (group + step++) & (ngroups - 1)) {
+        pos = group * GROUP_WIDTH;
+
+        for (match = group_match(t->ctrl + pos, H2(hash)); match; match &= match - 1) {
+            slot = &t->slots[pos + BITMASK_LOWEST(match)];
+            slot_key = __atomic_load_n(&slot->key, __ATOMIC_RELAXED);
+
+            /* the key is compared only if hash and length match */
+            if (__atomic_load_n(&slot->hash, __ATOMIC_RELAXED) == hash && __atomic_load_n(&slot->len, __ATOMIC_RELAXED) == len &&
+                slot_key && ht->hash_key_compare(slot_key, key))
+                return slot;
+        }
+
+        if (group_match_empty(t->ctrl + pos))
+            return NULL;
+    }
+
+    return NULL;
+}
+
+static void
+set_ctrl(icl_table_t *t, size_t index, unsigned char ctrl)
+{
+    __atomic_store_n(&t->ctrl[index], ctrl, __ATOMIC_RELAXED);
+}
+
+/**
+ * Put an entry in the first free slot of its probe sequence. The table
+ * must not contain the key and must have a free slot.
+ */
+static icl_entry_t *
+table_add(icl_table_t *t, uint64_t hash, void *key, size_t len, void *data)
+{
+    size_t ngroups = t->capacity / GROUP_WIDTH,
+        group = hash & (ngroups - 1),
+        step, pos;
+    icl_entry_t *slot;
+    bitmask_t free_slots;
+
+    for (step = 1; step <= ngroups; group = (group + step++) & (ngroups - 1)) {
+        pos = group * GROUP_WIDTH;
+
+        if ((free_slots = group_match_free(t->ctrl + pos)) != 0) {
+            pos += BITMASK_LOWEST(free_slots);
+            slot = &t->slots[pos];
+
+            if (t->ctrl[pos] == CTRL_EMPTY)
+                t->used++;
+
+            __atomic_store_n(&slot->key, key, __ATOMIC_RELAXED);
+            __atomic_store_n(&slot->data, data, __ATOMIC_RELAXED);
+            __atomic_store_n(&slot->hash, hash, __ATOMIC_RELAXED);
+            __atomic_store_n(&slot->len, len, __ATOMIC_RELAXED);
+            set_ctrl(t, pos, H2(hash));
+
+            return slot;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Remove the entry in 'slot'. If its group still has an empty slot no
+ * probe sequence ever went past the group, so the slot can be empty
+ * again instead of deleted.
+ */
+static void
+table_remove(icl_table_t *t, icl_entry_t *slot)
+{
+    size_t index = slot - t->slots;
+
+    if (group_match_empty(t->ctrl + index - index % GROUP_WIDTH)) {
+        set_ctrl(t, index, CTRL_EMPTY);
+        t->used--;
+    }
+    else
+        set_ctrl(t, index, CTRL_DELETED);
+}
+
+/**
+ * Move up to 'n' slots of the old table into the current one. When the
+ * old table is empty it is freed. Called by writers only.
+ */
+static void
+migrate(icl_hash_t *ht, size_t n)
+{
+    icl_table_t *old = ht->old;
+    icl_entry_t *slot;
+
+    for (; n > 0 && ht->migrated < old->capacity; n--, ht->migrated++) {
+        if (IS_FREE(old->ctrl[ht->migrated]))
+            continue;
+
+        slot = &old->slots[ht->migrated];
+
+        table_add(ht->table, slot->hash, slot->key, slot->len, slot->data);
+        table_remove(old, slot);
+    }
+
+    if (ht->migrated == old->capacity) {
+        __atomic_store_n(&ht->old, NULL, __ATOMIC_RELAXED);
+        table_free(ht, old);
+    }
+}
+
+/**
+ * Make room for one more entry: when full and deleted slots would exceed
+ * the maximum load, start migrating into a table at most half full.
+ *
+ * @returns 0 on success, -1 if there is no room and no memory.
+ */
+static int
+reserve(icl_hash_t *ht)
+{
+    icl_table_t *t;
+    size_t capacity;
+
+    if ((ht->table->used + 1) * MAX_LOAD_DEN <= ht->table->capacity * MAX_LOAD_NUM)
+        return 0;
+
+    /* the previous migration is not over yet: finish it before starting another one */
+    if (ht->old)
+        migrate(ht, ht->old->capacity);
+
+    for (capacity = ht->table->capacity; ((size_t)ht->nentries + 1) * 2 > capacity; capacity *= 2)
+        ;
+
+    if (!(t = table_create(capacity)))
+        return ht->table->used < ht->table->capacity ? 0 : -1;
+
+    ht->migrated = 0;
+    /* a reader that sees the new table must also see it initialized */
+    __atomic_store_n(&ht->old, ht->table, __ATOMIC_RELEASE);
+    __atomic_store_n(&ht->table, t, __ATOMIC_RELEASE);
+    ht->nbuckets = (int)capacity;
+
+    return 0;
+}
+
+/**
+ * Look for the slot of 'key' in the current and in the old table.
+ * Called by writers only.
+ */
+static icl_entry_t *
+find_slot(icl_hash_t *ht, uint64_t hash, void *key, size_t len, icl_table_t **table)
+{
+    icl_entry_t *slot;
+
+    if ((slot = table_find(ht, ht->table, hash, key, len))) {
+        *table = ht->table;
+        return slot;
+    }
+
+    if (ht->old && (slot = table_find(ht, ht->old, hash, key, len))) {
+        *table = ht->old;
+        return slot;
+    }
+
+    return NULL;
 }
 
 
 /**
  * Create a new hash table.
  *
- * @param[in] nbuckets -- number of buckets to create
- * @param[in] hash_function -- pointer to the hashing function to be used
+ * @param[in] nbuckets -- number of entries expected, the table grows if needed
+ * @param[in] hash_function -- pointer to the hashing function to be used, it must spread the hash over 64 bits
  * @param[in] hash_key_compare -- pointer to the hash key comparison function to be used
  *
  * @returns pointer to new hash table.
  */
 
 icl_hash_t *
-icl_hash_create( int nbuckets, unsigned int (*hash_function)(void*), int (*hash_key_compare)(void*, void*) )
+icl_hash_create( int nbuckets, uint64_t (*hash_function)(void*), int (*hash_key_compare)(void*, void*) )
 {
     icl_hash_t *ht;
-    int i;
+    size_t capacity = GROUP_WIDTH;
 
     ht = (icl_hash_t*) malloc(sizeof(icl_hash_t));
     if(!ht) return NULL;
 
-    ht->nentries = 0;
-    ht->buckets = (icl_entry_t**)malloc(nbuckets * sizeof(icl_entry_t*));
-    if(!ht->buckets) return NULL;
+    while (nbuckets > 0 && (size_t)nbuckets * MAX_LOAD_DEN > capacity * MAX_LOAD_NUM)
+        capacity *= 2;
 
-    ht->nbuckets = nbuckets;
-    for(i=0;i<ht->nbuckets;i++)
-        ht->buckets[i] = NULL;
+    ht->table = table_create(capacity);
+    if(!ht->table) {
+        free(ht);
+        return NULL;
+    }
+
+    ht->nbuckets = (int)capacity;
+    ht->nentries = 0;
+    ht->old = NULL;
+    ht->migrated = 0;
+    ht->seq = 0;
+    ht->retire = NULL;
 
-    ht->hash_function = hash_function ? hash_function : hash_pjw;
+    ht->hash_function = hash_function ? hash_function : hash_string;
     ht->hash_key_compare = hash_key_compare ? hash_key_compare : string_compare;
 
     return ht;
 }
 
 /**
- * Search for an entry in a hash table.
+ * Set the function that frees the tables replaced by a resize, for
+ * tables searched by readers without locks.
+ *
+ * @param ht -- the hash table
+ * @param retire -- deferred free, called with the table and the function that frees it
+ */
+void
+icl_hash_set_retire(icl_hash_t *ht, int (*retire)(void *, void (*)(void *)))
+{
+    if (ht)
+        ht->retire = retire;
+}
+
+/**
+ * Search for an entry in a hash table. Can run concurrently with a writer.
  *
  * @param ht -- the hash table to be searched
  * @param key -- the key of the item to search for
@@ -105,18 +603,47 @@ icl_hash_create( int nbuckets, unsigned int (*hash_function)(void*), int (*hash_
 void *
 icl_hash_find(icl_hash_t *ht, void* key)
 {
-    icl_entry_t* curr;
-    unsigned int hash_val;
+    if(!ht || !key) return NULL;
+
+    return icl_hash_find_hashed(ht, key, strlen((char *)key), (* ht->hash_function)(key));
+}
+
+/**
+ * Same as icl_hash_find for a key whose length and hash are already known.
+ *
+ * @param ht -- the hash table to be searched
+ * @param key -- the key of the item to search for
+ * @param len -- length of the key
+ * @param hash -- hash of the key, as computed by the hash function of the table
+ *
+ * @returns pointer to the data corresponding to the key.
+ *   If the key was not found, returns NULL.
+ */
+
+void *
+icl_hash_find_hashed(icl_hash_t *ht, void* key, size_t len, uint64_t hash)
+{
+    icl_table_t *t;
+    icl_entry_t *slot;
+    unsigned long seq;
+    void *data;
 
     if(!ht || !key) return NULL;
 
-    hash_val = (* ht->hash_function)(key) % ht->nbuckets;
+    do {
+        seq = read_begin(ht);
+        data = NULL;
 
-    for (curr=ht->buckets[hash_val]; curr != NULL; curr=curr->next)
-        if ( ht->hash_key_compare(curr->key, key))
-            return(curr->data);
+        slot = table_find(ht, __atomic_load_n(&ht->table, __ATOMIC_ACQUIRE), hash, key, len);
 
-    return NULL;
+        if (!slot && (t = __atomic_load_n(&ht->old, __ATOMIC_ACQUIRE)))
+            slot = table_find(ht, t, hash, key, len);
+
+        if (slot)
+            data = __atomic_load_n(&slot->data, __ATOMIC_RELAXED);
+    } while (read_retry(ht, seq));
+
+    return data;
 }
 
 /**
@@ -126,34 +653,57 @@ icl_hash_find(icl_hash_t *ht, void* key)
  * @param key -- the key of the new item
  * @param data -- pointer to the new item's data
  *
- * @returns pointer to the new item.  Returns NULL on error.
+ * @returns pointer to the new item, valid until the next insert or
+ *   delete. Returns NULL on error.
  */
 
 icl_entry_t *
 icl_hash_insert(icl_hash_t *ht, void* key, void *data)
 {
+    if(!ht || !key) return NULL;
+
+    return icl_hash_insert_hashed(ht, key, strlen((char *)key), (* ht->hash_function)(key), data);
+}
+
+/**
+ * Same as icl_hash_insert for a key whose length and hash are already known.
+ *
+ * @param ht -- the hash table
+ * @param key -- the key of the new item
+ * @param len -- length of the key
+ * @param hash -- hash of the key, as computed by the hash function of the table
+ * @param data -- pointer to the new item's data
+ *
+ * @returns pointer to the new item, valid until the next insert or
+ *   delete. Returns NULL on error.
+ */
+
+icl_entry_t *
+icl_hash_insert_hashed(icl_hash_t *ht, void* key, size_t len, uint64_t hash, void *data)
+{
+    icl_table_t *t;
     icl_entry_t *curr;
-    unsigned int hash_val;
 
     if(!ht || !key) return NULL;
 
-    hash_val = (* ht->hash_function)(key) % ht->nbuckets;
+    if (find_slot(ht, hash, key, len, &t))
+        return(NULL); /* key already exists */
 
-    for (curr=ht->buckets[hash_val]; curr != NULL; curr=curr->next)
-        if ( ht->hash_key_compare(curr->key, key))
-            return(NULL); /* key already exists */
+    write_begin(ht);
 
-    /* if key was not found */
-    curr = (icl_entry_t*)malloc(sizeof(icl_entry_t));
-    if(!curr) return NULL;
-
-    curr->key = key;
-    curr->data = data;
-    curr->next = ht->buckets[hash_val]; /* add at start */
+    if (reserve(ht) == -1) {
+        write_end(ht);
+        return NULL;
+    }
 
-    ht->buckets[hash_val] = curr;
+    curr = table_add(ht->table, hash, key, len, data);
     ht->nentries++;
 
+    if (ht->old)
+        migrate(ht, MIGRATE_STEP);
+
+    write_end(ht);
+
     return curr;
 }
 
@@ -163,7 +713,8 @@ icl_hash_insert(icl_hash_t *ht, void* key, void *data)
  * @param ht -- the hash table
  * @param key -- the key of the new item
  * @param data -- pointer to the new item's data
- * @param olddata -- pointer to the old item's data (set upon return)
+ * @param olddata -- pointer to the old item's data (set upon return, NULL
+ *   if the key was not in the table)
  *
  * @returns pointer to the new item.  Returns NULL on error.
  */
@@ -171,43 +722,28 @@ icl_hash_insert(icl_hash_t *ht, void* key, void *data)
 icl_entry_t *
 icl_hash_update_insert(icl_hash_t *ht, void* key, void *data, void **olddata)
 {
-    icl_entry_t *curr, *prev;
-    unsigned int hash_val;
+    icl_table_t *t;
+    icl_entry_t *curr;
 
     if(!ht || !key) return NULL;
 
-    hash_val = (* ht->hash_function)(key) % ht->nbuckets;
-
-    /* Scan bucket[hash_val] for key */
-    for (prev=NULL,curr=ht->buckets[hash_val]; curr != NULL; prev=curr, curr=curr->next)
-        /* If key found, remove node from list, free old key, and setup olddata for the return */
-        if ( ht->hash_key_compare(curr->key, key)) {
-            if (olddata != NULL) {
-                *olddata = curr->data;
-                free(curr->key);
-            }
-
-            if (prev == NULL)
-                ht->buckets[hash_val] = curr->next;
-            else
-                prev->next = curr->next;
-        }
+    if (olddata)
+        *olddata = NULL;
 
-    /* Since key was either not found, or found-and-removed, create and prepend new node */
-    curr = (icl_entry_t*)malloc(sizeof(icl_entry_t));
-    if(curr == NULL) return NULL; /* out of memory */
+    if ((curr = find_slot(ht, (* ht->hash_function)(key), key, strlen((char *)key), &t))) {
+        write_begin(ht);
 
-    curr->key = key;
-    curr->data = data;
-    curr->next = ht->buckets[hash_val]; /* add at start */
+        if (olddata)
+            *olddata = curr->data;
 
-    ht->buckets[hash_val] = curr;
-    ht->nentries++;
+        __atomic_store_n(&curr->key, key, __ATOMIC_RELAXED);
+        __atomic_store_n(&curr->data, data, __ATOMIC_RELAXED);
 
-    if(olddata!=NULL && *olddata!=NULL)
-        *olddata = NULL;
+        write_end(ht);
+        return curr;
+    }
 
-    return curr;
+    return icl_hash_insert(ht, key, data);
 }
 
 /**
@@ -222,30 +758,51 @@ icl_hash_update_insert(icl_hash_t *ht, void* key, void *data, void **olddata)
  */
 int icl_hash_delete(icl_hash_t *ht, void* key, void (*free_key)(void*), void (*free_data)(void*))
 {
-    icl_entry_t *curr, *prev;
-    unsigned int hash_val;
+    if(!ht || !key) return -1;
+
+    return icl_hash_delete_hashed(ht, key, strlen((char *)key), (* ht->hash_function)(key), free_key, free_data);
+}
+
+/**
+ * Same as icl_hash_delete for a key whose length and hash are already known.
+ *
+ * @param ht -- the hash table
+ * @param key -- the key of the item
+ * @param len -- length of the key
+ * @param hash -- hash of the key, as computed by the hash function of the table
+ * @param free_key -- pointer to function that frees the key
+ * @param free_data -- pointer to function that frees the data
+ *
+ * @returns 0 on success, -1 on failure.
+ */
+int icl_hash_delete_hashed(icl_hash_t *ht, void* key, size_t len, uint64_t hash, void (*free_key)(void*), void (*free_data)(void*))
+{
+    icl_table_t *t;
+    icl_entry_t *curr;
+    void *curr_key, *curr_data;
 
     if(!ht || !key) return -1;
-    hash_val = (* ht->hash_function)(key) % ht->nbuckets;
-
-    prev = NULL;
-    for (curr=ht->buckets[hash_val]; curr != NULL; )  {
-        if ( ht->hash_key_compare(curr->key, key)) {
-            if (prev == NULL) {
-                ht->buckets[hash_val] = curr->next;
-            } else {
-                prev->next = curr->next;
-            }
-            if (*free_key && curr->key) (*free_key)(curr->key);
-            if (*free_data && curr->data) (*free_data)(curr->data);
-            ht->nentries++;
-            free(curr);
-            return 0;
-        }
-        prev = curr;
-        curr = curr->next;
-    }
-    return -1;
+
+    if (!(curr = find_slot(ht, hash, key, len, &t)))
+        return -1;
+
+    curr_key = curr->key;
+    curr_data = curr->data;
+
+    write_begin(ht);
+
+    table_remove(t, curr);
+    ht->nentries--;
+
+    if (ht->old)
+        migrate(ht, MIGRATE_STEP);
+
+    write_end(ht);
+
+    if (free_key && curr_key) (*free_key)(curr_key);
+    if (free_data && curr_data) (*free_data)(curr_data);
+
+    return 0;
 }
 
 /**
@@ -260,24 +817,22 @@ int icl_hash_delete(icl_hash_t *ht, void* key, void (*free_key)(void*), void (*f
 int
 icl_hash_destroy(icl_hash_t *ht, void (*free_key)(void*), void (*free_data)(void*))
 {
-    icl_entry_t *bucket, *curr, *next;
-    int i;
+    icl_entry_t *curr;
+    size_t i;
 
     if(!ht) return -1;
 
-    for (i=0; i<ht->nbuckets; i++) {
-        bucket = ht->buckets[i];
-        for (curr=bucket; curr!=NULL; ) {
-            next=curr->next;
-            if (*free_key && curr->key) (*free_key)(curr->key);
-            if (*free_data && curr->data) (*free_data)(curr->data);
-            free(curr);
-            curr=next;
+    for (i = 0; i < icl_hash_capacity(ht); i++) {
+        if ((curr = icl_hash_slot(ht, i)) != NULL) {
+            if (free_key && curr->key) (*free_key)(curr->key);
+            if (free_data && curr->data) (*free_data)(curr->data);
         }
     }
 
-    if(ht->buckets) free(ht->buckets);
-    if(ht) free(ht);
+    /* nobody can search the table anymore */
+    free(ht->table);
+    if(ht->old) free(ht->old);
+    free(ht);
 
     return 0;
 }
@@ -294,23 +849,49 @@ icl_hash_destroy(icl_hash_t *ht, void (*free_key)(void*), void (*free_data)(void
 int
 icl_hash_dump(FILE* stream, icl_hash_t* ht)
 {
-    icl_entry_t *bucket, *curr;
-    int i;
+    icl_entry_t *curr;
+    size_t i;
 
     if(!ht) return -1;
 
-    for(i=0; i<ht->nbuckets; i++) {
-        bucket = ht->buckets[i];
-        for(curr=bucket; curr!=NULL; ) {
-            if(curr->key)
-                fprintf(stream, "icl_hash_dump: %s: %p\n", (char *)curr->key, curr->data);
-            curr=curr->next;
-        }
+    for (i = 0; i < icl_hash_capacity(ht); i++) {
+        if ((curr = icl_hash_slot(ht, i)) != NULL && curr->key)
+            fprintf(stream, "icl_hash_dump: %s: %p\n", (char *)curr->key, curr->data);
     }
 
     return 0;
 }
 
+/**
+ * Number of slots of the table, counting the old one during a migration.
+ * Slots are numbered from 0 and can be read with icl_hash_slot.
+ */
+size_t
+icl_hash_capacity(icl_hash_t *ht)
+{
+    return ht->table->capacity + (ht->old ? ht->old->capacity : 0);
+}
+
+/**
+ * Entry in slot 'index' (see icl_hash_capacity), NULL if the slot is free.
+ * The table must not be modified while its slots are read.
+ */
+icl_entry_t *
+icl_hash_slot(icl_hash_t *ht, size_t index)
+{
+    icl_table_t *t = ht->table;
+
+    if (index >= t->capacity) {
+        index -= t->capacity;
+        t = ht->old;
+    }
+
+    if (!t || index >= t->capacity || IS_FREE(t->ctrl[index]))
+        return NULL;
+
+    return &t->slots[index];
+}
+
 icl_hash_iter_t *icl_hash_iterator_create(icl_hash_t *ht) {
     icl_hash_iter_t *ht_iter;
 
@@ -331,28 +912,15 @@ icl_hash_iter_t *icl_hash_iterator_create(icl_hash_t *ht) {
 int icl_hash_next(icl_hash_iter_t* iter) {
     icl_hash_t* ht = iter->ht;
 
-    while (iter->currIndex < ht->nbuckets) 
+    while (iter->currIndex < icl_hash_capacity(ht))
     {
-        size_t i = iter->currIndex;
-        
-        if (ht->buckets[i])
-        {
-            if (!iter->currEntry)
-            {
-                iter->currEntry = ht->buckets[i];
-                return 1;
-            }
-
-            if (iter->currEntry->next)
-            {
-                iter->currEntry = iter->currEntry->next;
-                return 1;
-            }
-        }
+        iter->currEntry = icl_hash_slot(ht, iter->currIndex++);
 
-        iter->currEntry = NULL;
-        iter->currIndex++;
+        if (iter->currEntry)
+            return 1;
     }
+
+    iter->currEntry = NULL;
     return 0;
 }
 
@@ -364,4 +932,4 @@ int icl_hash_iterator_destroy(icl_hash_iter_t *ht_iter)
     free(ht_iter);
 
     return 0;
-}
\ No newline at end of file
+}
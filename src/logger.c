@@ -4,7 +4,6 @@
 
 #include "../include/logger.h"
 #include "../include/utils.h"
-#include "../include/boundedqueue.h"
 
 /**
  * @brief scrive le operazioni eseguite dal server sul file di log
@@ -19,49 +18,38 @@ void *writeLogToFile(void *args) {
     FILE* logFile;
     CHECK_RET_AND_ACTION(fopen, ==, NULL, logFile, perror("fopen"); pthread_exit((void*)EXIT_FAILURE), logger_args->logFilePath, "w"); //apro il file di log in scrittura
 
-    char *log_buf; //buffer per il log delle operazioni
+    void *logFromStorage[LOGGER_BATCH]; //messaggi estratti insieme dalla coda dello storage
+    size_t nMsgs,
+        i;
+    int stop = 0,
+        failed = 0;
 
-    while (1) {
-        char* logFromStorage;
-        CHECK_RET_AND_ACTION(pop, ==, NULL, logFromStorage, perror("pop"); pthread_exit((void*)EXIT_FAILURE), fs->logger_msg_queue); //estraggo i messaggi di log dalla coda dello storage
-        
-        if (strncmp(logFromStorage, STOP_MSG, strlen(STOP_MSG)) == 0) { //se il messaggio è quello di "STOP" allora mi fermo
-            free(logFromStorage);
-            break;
-        }
+    while (!stop) {
+        CHECK_RET_AND_ACTION(mpmcPopBatch, ==, 0, nMsgs, perror("mpmcPopBatch"); pthread_exit((void*)EXIT_FAILURE), fs->logger_msg_queue, logFromStorage, LOGGER_BATCH); //estraggo i messaggi di log dalla coda dello storage
 
-        log_buf = calloc(strlen(logFromStorage) + 1, sizeof(char));
+        for (i = 0; i < nMsgs; i++) {
+            char *msg = (char*)logFromStorage[i];
 
-        if (!log_buf)
-        {
-            errno = ENOMEM;
-            perror("calloc");
-            free(logFromStorage);
-            break;
-        }
-        memcpy(log_buf, logFromStorage, strlen(logFromStorage) + 1); //copio il messaggio sul buffer
+            if (!stop) {
+                if (strncmp(msg, STOP_MSG, strlen(STOP_MSG)) == 0) //se il messaggio è quello di "STOP" allora mi fermo
+                    stop = 1;
+                else if (fputs(msg, logFile) == EOF) {
+                    perror("fputs");
+                    stop = failed = 1;
+                }
+            }
 
-        if (fputs(log_buf, logFile) == EOF)
-        {
-            perror("fputs");
-            goto cleanup;
+            free(msg);
         }
 
-        if (fflush(logFile) == EOF) // e lo scrivo sul file
-        {
+        if (fflush(logFile) == EOF) { // scrivo sul file tutti i messaggi estratti insieme
             perror("fflush");
-            goto cleanup;
-        }
-
-        cleanup:
-        free(logFromStorage);
-        free(log_buf);
-
-        if (errno)
+            failed = 1;
             break;
+        }
     }
 
     fclose(logFile); //quando ho finito chiudo il file di log
 
-    pthread_exit(errno ? (void*)EXIT_FAILURE : NULL);
+    pthread_exit(failed ? (void*)EXIT_FAILURE : NULL);
 }
\ No newline at end of file
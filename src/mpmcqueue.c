@@ -0,0 +1,314 @@
+#include "../include/define_source.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "../include/eventcount.h"
+#include "../include/mpmcqueue.h"
+
+/**
+ * @brief Riserva fino a 'n' posizioni consecutive libere per i produttori.
+ *
+ * \retval numero di posizioni riservate a partire da '*first', 0 se la coda e' piena
+ */
+static size_t claimPush(MPMCQueue_t *q, size_t n, size_t *first)
+{
+    size_t pos = __atomic_load_n(&(q->enqueuePos), __ATOMIC_RELAXED),
+           k;
+    intptr_t diff;
+
+    while (1)
+    {
+        // conto le posizioni consecutive gia' liberate dai consumatori per questo giro
+        for (k = 0; k < n; k++)
+        {
+            if (__atomic_load_n(&(q->buf[(pos + k) & q->mask].seq), __ATOMIC_ACQUIRE) != pos + k)
+                break;
+        }
+
+        if (k > 0)
+        {
+            if (__atomic_compare_exchange_n(&(q->enqueuePos), &pos, pos + k, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+                break;
+
+            continue;
+        }
+
+        diff = (intptr_t)__atomic_load_n(&(q->buf[pos & q->mask].seq), __ATOMIC_ACQUIRE) - (intptr_t)pos;
+
+        // la posizione contiene ancora il dato del giro precedente
+        if (diff < 0)
+            return 0;
+
+        // un altro produttore l'ha gia' riservata
+        pos = __atomic_load_n(&(q->enqueuePos), __ATOMIC_RELAXED);
+    }
+
+    *first = pos;
+
+    return k;
+}
+
+/**
+ * @brief Riserva fino a 'n' posizioni consecutive piene per i consumatori.
+ *
+ * \retval numero di posizioni riservate a partire da '*first', 0 se la coda e' vuota
+ */
+static size_t claimPop(MPMCQueue_t *q, size_t n, size_t *first)
+{
+    size_t pos = __atomic_load_n(&(q->dequeuePos), __ATOMIC_RELAXED),
+           k;
+    intptr_t diff;
+
+    while (1)
+    {
+        for (k = 0; k < n; k++)
+        {
+            if (__atomic_load_n(&(q->buf[(pos + k) & q->mask].seq), __ATOMIC_ACQUIRE) != pos + k + 1)
+                break;
+        }
+
+        if (k > 0)
+        {
+            if (__atomic_compare_exchange_n(&(q->dequeuePos), &pos, pos + k, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+                break;
+
+            continue;
+        }
+
+        diff = (intptr_t)__atomic_load_n(&(q->buf[pos & q->mask].seq), __ATOMIC_ACQUIRE) - (intptr_t)(pos + 1);
+
+        // il produttore del giro corrente non ha ancora pubblicato il dato
+        if (diff < 0)
+            return 0;
+
+        pos = __atomic_load_n(&(q->dequeuePos), __ATOMIC_RELAXED);
+    }
+
+    *first = pos;
+
+    return k;
+}
+
+static size_t tryPush(MPMCQueue_t *q, void **data, size_t n)
+{
+    size_t first,
+        k,
+        i;
+
+    if (!(k = claimPush(q, n, &first)))
+        return 0;
+
+    for (i = 0; i < k; i++)
+    {
+        MPMCCell *cell = &(q->buf[(first + i) & q->mask]);
+
+        cell->data = data[i];
+        __atomic_store_n(&(cell->seq), first + i + 1, __ATOMIC_RELEASE);
+    }
+
+    eventNotify(&(q->notEmpty));
+
+    return k;
+}
+
+static size_t tryPop(MPMCQueue_t *q, void **data, size_t n)
+{
+    size_t first,
+        k,
+        i;
+
+    if (!(k = claimPop(q, n, &first)))
+        return 0;
+
+    for (i = 0; i < k; i++)
+    {
+        MPMCCell *cell = &(q->buf[(first + i) & q->mask]);
+
+        data[i] = cell->data;
+        // libero la posizione per il giro successivo dei produttori
+        __atomic_store_n(&(cell->seq), first + i + q->mask + 1, __ATOMIC_RELEASE);
+    }
+
+    eventNotify(&(q->notFull));
+
+    return k;
+}
+
+/**
+ * @brief Attende che 'try' trasferisca almeno un dato: prima riprova per q->spin volte, poi si registra su 'event' e, se
+ *  l'ultimo tentativo fallisce, si addormenta fino alla prossima notifica.
+ */
+static size_t park(MPMCQueue_t *q, size_t (*try)(MPMCQueue_t *, void **, size_t), void **data, size_t n, EventCount *event)
+{
+    unsigned int val;
+    size_t k;
+    int i;
+
+    while (1)
+    {
+        for (i = 0; i < q->spin; i++)
+        {
+            if ((k = try(q, data, n)))
+                return k;
+        }
+
+        val = eventPrepareWait(event);
+
+        if ((k = try(q, data, n)))
+            return k;
+
+        eventWait(event, val);
+    }
+}
+
+MPMCQueue_t *initMPMCQueue(size_t n)
+{
+    MPMCQueue_t *q;
+    size_t size = 2,
+           i;
+
+    if (n <= 0)
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    while (size < n)
+        size *= 2;
+
+    if (!(q = calloc(1, sizeof(MPMCQueue_t))))
+    {
+        perror("calloc");
+        return NULL;
+    }
+
+    if (!(q->buf = malloc(size * sizeof(MPMCCell))))
+    {
+        perror("malloc buf");
+        free(q);
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    for (i = 0; i < size; i++)
+    {
+        q->buf[i].seq = i;
+        q->buf[i].data = NULL;
+    }
+
+    q->mask = size - 1;
+    q->spin = sysconf(_SC_NPROCESSORS_ONLN) > 1 ? MPMC_SPIN : 0;
+
+    return q;
+}
+
+void deleteMPMCQueue(MPMCQueue_t *q, void (*F)(void *))
+{
+    void *data;
+
+    if (!q)
+    {
+        errno = EINVAL;
+        return;
+    }
+
+    if (F)
+    {
+        while (tryPop(q, &data, 1))
+            F(data);
+    }
+
+    free(q->buf);
+    free(q);
+}
+
+int mpmcPush(MPMCQueue_t *q, void *data)
+{
+    return mpmcPushBatch(q, &data, 1);
+}
+
+void *mpmcPop(MPMCQueue_t *q)
+{
+    void *data;
+
+    if (!mpmcPopBatch(q, &data, 1))
+        return NULL;
+
+    return data;
+}
+
+int mpmcPushBatch(MPMCQueue_t *q, void **data, size_t n)
+{
+    size_t i;
+
+    if (!q || !data)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    for (i = 0; i < n; i++)
+    {
+        if (!data[i])
+        {
+            errno = EINVAL;
+            return -1;
+        }
+    }
+
+    while (n > 0)
+    {
+        if (!(i = tryPush(q, data, n)))
+            i = park(q, &tryPush, data, n, &(q->notFull));
+
+        data += i;
+        n -= i;
+    }
+
+    return 0;
+}
+
+size_t mpmcPopBatch(MPMCQueue_t *q, void **data, size_t n)
+{
+    size_t k;
+
+    if (!q || !data || n == 0)
+    {
+        errno = EINVAL;
+        return 0;
+    }
+
+    if (!(k = tryPop(q, data, n)))
+        k = park(q, &tryPop, data, n, &(q->notEmpty));
+
+    return k;
+}
+
+void *mpmcTryPop(MPMCQueue_t *q)
+{
+    void *data;
+
+    if (!q)
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    if (!tryPop(q, &data, 1))
+        return NULL;
+
+    return data;
+}
+
+size_t mpmcLength(MPMCQueue_t *q)
+{
+    size_t dequeuePos = __atomic_load_n(&(q->dequeuePos), __ATOMIC_RELAXED),
+           enqueuePos = __atomic_load_n(&(q->enqueuePos), __ATOMIC_RELAXED);
+
+    // i due contatori vengono letti in momenti diversi: il risultato e' solo una stima
+    return enqueuePos > dequeuePos ? enqueuePos - dequeuePos : 0;
+}
@@ -0,0 +1,1154 @@
+#include "../include/define_source.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/icl_hash.h"
+#include "../include/mutex.h"
+#include "../include/policy.h"
+#include "../include/sketch.h"
+#include "../include/slab.h"
+#include "../include/utils.h"
+
+#define STATE(fs, type) ((type *)((fs)->policyState))
+
+#define CMP(a, b) (((a) > (b)) - ((a) < (b)))
+
+// liste in cui puo' trovarsi un file (o da cui e' stato espulso, per i ghost)
+#define LIST_MAIN 0
+#define LIST_T1 1     // ARC: file acceduti una sola volta di recente
+#define LIST_T2 2     // ARC: file acceduti piu' volte
+#define LIST_WINDOW 3 // W-TinyLFU: file non ancora ammessi
+#define LIST_SMALL 4  // S3-FIFO: file in prova
+
+#define S3FIFO_MAX_FREQ 3 // S3-FIFO: letture ricordate da referenceBit, come un contatore da 2 bit
+
+/**
+ * @brief Controlla se il file puo' essere scelto come vittima: non deve essere il file da aggiungere e nessun thread
+ *  deve starci operando. Il valore di 'users' e' letto senza la lock sul file, verra' ricontrollato dal filesystem.
+ */
+#define IS_EVICTABLE(file, toAdd) ((file) != (toAdd) && __atomic_load_n(&((file)->users), __ATOMIC_ACQUIRE) == 0)
+
+/** Lista di file collegati tramite i campi prev e next.
+ *
+ */
+typedef struct fileList
+{
+    File *head;
+    File *tail;
+    size_t len;
+} FileList;
+
+/** Bucket di frequenza per LFU: contiene in ordine di arrivo i file con lo stesso numero di accessi. I bucket sono ordinati
+ *  per frequenza crescente, quindi la vittima e' il primo file del primo bucket non vuoto e un accesso sposta il file nel
+ *  bucket successivo in tempo costante.
+ *
+ */
+typedef struct lfuBucket
+{
+    size_t freq;
+    FileList files;
+    struct lfuBucket *prev;
+    struct lfuBucket *next;
+} LfuBucket;
+
+/** Path di un file espulso (ghost): ricorda da quale lista e' stato espulso il file senza occupare memoria per i dati.
+ *
+ */
+typedef struct ghost
+{
+    char *path;
+    short list;
+    struct ghost *prev;
+    struct ghost *next;
+} Ghost;
+
+typedef struct ghostList
+{
+    Ghost *head;
+    Ghost *tail;
+    size_t len;
+} GhostList;
+
+/** Second-chance: lista circolare dei file e lancetta.
+ *
+ */
+typedef struct clockState
+{
+    FileList queue;
+    File *hand; // prossimo file esaminato dalla lancetta
+} ClockState;
+
+/** ARC. T1 contiene i file acceduti una sola volta di recente e T2 quelli acceduti piu' volte, B1 e B2 i ghost dei file
+ *  espulsi rispettivamente da T1 e T2. Un file ricreato mentre il suo ghost e' in B1 (o in B2) indica che T1 (o T2) e'
+ *  troppo piccola: 'p', la dimensione obiettivo di T1, viene spostata di conseguenza. Le liste ghost sono limitate a
+ *  MAXFILES elementi in totale.
+ *
+ */
+typedef struct arcState
+{
+    FileList t1, t2;
+    GhostList b1, b2;
+    icl_hash_t *ghosts; // path -> ghost
+    size_t p;
+} ArcState;
+
+/** GDSF: min-heap dei file per priorita' L + accessi / dimensione, dove L e' la priorita' dell'ultima vittima e fa
+ *  invecchiare i file rimasti.
+ *
+ */
+typedef struct gdsfState
+{
+    File **heap; // capacita' MAXFILES
+    size_t len;
+    double inflation;
+} GdsfState;
+
+/** W-TinyLFU. I nuovi file entrano in una piccola finestra LRU e vengono ammessi nella coda principale (LRU) finche' c'e'
+ *  posto; poi un file della finestra entra nella coda principale solo se lo sketch stima per il suo path una frequenza
+ *  maggiore di quella della vittima che dovrebbe sostituire, altrimenti viene espulso lui. Allo stesso modo una scrittura
+ *  su un file della finestra che richiederebbe di espellere un file piu' frequente viene rifiutata.
+ *
+ */
+typedef struct tinyLfuState
+{
+    FileList window;
+    FileList main;
+    size_t windowMax; // 1% di MAXFILES, almeno un file
+
+    FreqSketch *sketch; // frequenze recenti dei path, anche di quelli non presenti
+} TinyLfuState;
+
+/** S3-FIFO. I nuovi file entrano nella coda piccola (10% di MAXFILES); quando ne escono passano nella coda principale se
+ *  sono stati letti nel frattempo, altrimenti vengono espulsi e il loro path resta tra i ghost. La coda principale e' una
+ *  FIFO in cui i file letti vengono reinseriti in fondo, consumando una lettura. Un file ricreato mentre il suo path e'
+ *  tra i ghost entra direttamente nella coda principale. Le letture incrementano solo referenceBit, senza lock.
+ *
+ */
+typedef struct s3fifoState
+{
+    FileList small;
+    FileList main;
+    size_t smallMax;
+
+    GhostList ghosts; // limitati a MAXFILES
+    icl_hash_t *table; // path -> ghost
+} S3FifoState;
+
+static SlabCache bucketCache = SLAB_CACHE_INITIALIZER("LfuBucket", sizeof(LfuBucket));
+static SlabCache ghostCache = SLAB_CACHE_INITIALIZER("Ghost", sizeof(Ghost));
+
+/**
+ * @brief Aggiunge il file 'file' in fondo alla lista 'list'.
+ */
+static void appendFile(FileList *list, File *file)
+{
+    file->next = NULL;
+    file->prev = list->tail;
+
+    if (list->tail)
+        list->tail->next = file;
+    else
+        list->head = file;
+
+    list->tail = file;
+    list->len++;
+}
+
+/**
+ * @brief Rimuove il file 'file' dalla lista 'list'.
+ */
+static void unlinkFile(FileList *list, File *file)
+{
+    // il file è il primo della lista
+    if (!file->prev)
+        list->head = file->next;
+    else
+        file->prev->next = file->next;
+
+    // il file è l'ultimo della lista
+    if (!file->next)
+        list->tail = file->prev;
+    else
+        file->next->prev = file->prev;
+
+    file->prev = file->next = NULL;
+    list->len--;
+}
+
+/**
+ * @brief Sposta il file 'file' in fondo alla lista 'list' in cui si trova.
+ */
+static void moveToTail(FileList *list, File *file)
+{
+    unlinkFile(list, file);
+    appendFile(list, file);
+}
+
+/**
+ * @brief Ritorna il primo file espellibile della lista che parte da 'head', settando 'busy' se ha dovuto saltare file in uso.
+ */
+static File *firstEvictable(File *head, File *toAdd, int *busy)
+{
+    File *file;
+
+    for (file = head; file && !IS_EVICTABLE(file, toAdd); file = file->next)
+    {
+        if (file != toAdd)
+            *busy = 1;
+    }
+
+    return file;
+}
+
+/**
+ * @brief Ritorna 'victim' oppure, se e' NULL, setta errno in base a 'busy' come descritto da choose_victim.
+ */
+static File *victimOrError(File *victim, int busy)
+{
+    if (!victim)
+        errno = busy ? EBUSY : ENOENT;
+
+    return victim;
+}
+
+static void freeGhost(void *ghost)
+{
+    free(((Ghost *)ghost)->path);
+    slabFree(ghost);
+}
+
+/**
+ * @brief Ricorda in fondo alla lista 'list' il path 'path' di un file espulso dalla lista 'from'. Se non c'e' memoria o il
+ *  path e' gia' nella tabella 'table' il ghost viene semplicemente perso.
+ */
+static void addGhost(icl_hash_t *table, GhostList *list, const char *path, short from)
+{
+    Ghost *ghost;
+
+    if (!(ghost = slabAlloc(&ghostCache)))
+        return;
+
+    if (!(ghost->path = strdup(path)))
+    {
+        slabFree(ghost);
+        return;
+    }
+
+    if (!icl_hash_insert(table, ghost->path, ghost))
+    {
+        freeGhost(ghost);
+        return;
+    }
+
+    ghost->list = from;
+    ghost->next = NULL;
+    ghost->prev = list->tail;
+
+    if (list->tail)
+        list->tail->next = ghost;
+    else
+        list->head = ghost;
+
+    list->tail = ghost;
+    list->len++;
+}
+
+/**
+ * @brief Rimuove e dealloca il ghost 'ghost' dalla lista 'list' e dalla tabella 'table'.
+ */
+static void dropGhost(icl_hash_t *table, GhostList *list, Ghost *ghost)
+{
+    if (!ghost->prev)
+        list->head = ghost->next;
+    else
+        ghost->prev->next = ghost->next;
+
+    if (!ghost->next)
+        list->tail = ghost->prev;
+    else
+        ghost->next->prev = ghost->prev;
+
+    list->len--;
+
+    icl_hash_delete(table, ghost->path, NULL, NULL);
+
+    freeGhost(ghost);
+}
+
+/**
+ * @brief Alloca in fs->policyState uno stato di 'size' bytes azzerato.
+ */
+static int allocState(Filesystem *fs, size_t size)
+{
+    if (!(fs->policyState = calloc(1, size)))
+    {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    return 0;
+}
+
+static void freeState(Filesystem *fs)
+{
+    free(fs->policyState);
+    fs->policyState = NULL;
+}
+
+/* ------------------------------------------------ FIFO e LRU ------------------------------------------------ */
+
+static int listInit(Filesystem *fs)
+{
+    return allocState(fs, sizeof(FileList));
+}
+
+static void listInsert(Filesystem *fs, File *file)
+{
+    appendFile(STATE(fs, FileList), file);
+}
+
+static void lruAccess(Filesystem *fs, File *file, int kind)
+{
+    moveToTail(STATE(fs, FileList), file);
+}
+
+static void listRemove(Filesystem *fs, File *file, int evicted)
+{
+    unlinkFile(STATE(fs, FileList), file);
+}
+
+static File *listVictim(Filesystem *fs, File *toAdd)
+{
+    int busy = 0;
+
+    return victimOrError(firstEvictable(STATE(fs, FileList)->head, toAdd, &busy), busy);
+}
+
+/* ----------------------------------------------- Second-chance ----------------------------------------------- */
+
+static int clockInit(Filesystem *fs)
+{
+    return allocState(fs, sizeof(ClockState));
+}
+
+static void clockInsert(Filesystem *fs, File *file)
+{
+    ClockState *state = STATE(fs, ClockState);
+
+    __atomic_store_n(&(file->referenceBit), 1, __ATOMIC_RELAXED);
+
+    if (!state->hand)
+    {
+        appendFile(&(state->queue), file);
+        return;
+    }
+
+    // il nuovo file viene messo subito prima della lancetta, cosi' sara' l'ultimo ad essere esaminato
+    file->next = state->hand;
+    file->prev = state->hand->prev;
+
+    if (file->prev)
+        file->prev->next = file;
+    else
+        state->queue.head = file;
+
+    state->hand->prev = file;
+    state->queue.len++;
+}
+
+static void clockAccess(Filesystem *fs, File *file, int kind)
+{
+    __atomic_store_n(&(file->referenceBit), 1, __ATOMIC_RELAXED);
+}
+
+static void clockRemove(Filesystem *fs, File *file, int evicted)
+{
+    ClockState *state = STATE(fs, ClockState);
+
+    // la lancetta passa al file successivo nella lista circolare
+    if (state->hand == file)
+    {
+        state->hand = file->next ? file->next : state->queue.head;
+
+        if (state->hand == file)
+            state->hand = NULL;
+    }
+
+    unlinkFile(&(state->queue), file);
+}
+
+static File *clockVictim(Filesystem *fs, File *toAdd)
+{
+    ClockState *state = STATE(fs, ClockState);
+    File *toEvict = NULL;
+    size_t i;
+
+    int busy = 0;
+
+    if (!state->hand)
+        state->hand = state->queue.head;
+
+    // in due giri completi la lancetta azzera tutti i referenceBit, se non trovo una vittima i file sono in uso
+    for (i = 0; i <= 2 * state->queue.len && state->hand; i++)
+    {
+        toEvict = state->hand;
+
+        if (!IS_EVICTABLE(toEvict, toAdd))
+        {
+            if (toEvict != toAdd)
+                busy = 1;
+        }
+        else if (!__atomic_exchange_n(&(toEvict->referenceBit), 0, __ATOMIC_RELAXED))
+            break; // la lancetta resta sulla vittima e avanzera' quando verra' rimossa
+
+        state->hand = toEvict->next ? toEvict->next : state->queue.head;
+        toEvict = NULL;
+    }
+
+    return victimOrError(toEvict, busy);
+}
+
+/* ---------------------------------------------------- LFU ---------------------------------------------------- */
+
+static int lfuInit(Filesystem *fs)
+{
+    if (allocState(fs, sizeof(LfuBucket)) == -1)
+        return -1;
+
+    // il bucket di frequenza 1 e' sempre presente, gli altri vengono allocati su richiesta
+    STATE(fs, LfuBucket)->freq = 1;
+
+    return 0;
+}
+
+static void lfuDestroy(Filesystem *fs)
+{
+    LfuBucket *bucket;
+
+    while ((bucket = STATE(fs, LfuBucket)->next))
+    {
+        STATE(fs, LfuBucket)->next = bucket->next;
+        slabFree(bucket);
+    }
+
+    freeState(fs);
+}
+
+static void lfuInsert(Filesystem *fs, File *file)
+{
+    appendFile(&(STATE(fs, LfuBucket)->files), file);
+    file->bucket = STATE(fs, LfuBucket);
+}
+
+/**
+ * @brief Rimuove il file 'file' dal suo bucket, deallocando il bucket se resta vuoto (tranne quello di frequenza 1).
+ */
+static void lfuRemove(Filesystem *fs, File *file, int evicted)
+{
+    LfuBucket *bucket = file->bucket;
+
+    unlinkFile(&(bucket->files), file);
+    file->bucket = NULL;
+
+    if (!bucket->files.head && bucket != STATE(fs, LfuBucket))
+    {
+        bucket->prev->next = bucket->next;
+
+        if (bucket->next)
+            bucket->next->prev = bucket->prev;
+
+        slabFree(bucket);
+    }
+}
+
+/**
+ * @brief Sposta il file 'file' nel bucket della frequenza successiva, creandolo se non esiste. Se non e' possibile
+ *  allocare il bucket il file resta dove si trova.
+ */
+static void lfuAccess(Filesystem *fs, File *file, int kind)
+{
+    LfuBucket *bucket = file->bucket,
+              *nextBucket = bucket->next;
+
+    if (!nextBucket || nextBucket->freq != bucket->freq + 1)
+    {
+        if (!(nextBucket = slabAlloc(&bucketCache)))
+            return;
+
+        memset(nextBucket, 0, sizeof(*nextBucket));
+        nextBucket->freq = bucket->freq + 1;
+        nextBucket->prev = bucket;
+        nextBucket->next = bucket->next;
+
+        if (bucket->next)
+            bucket->next->prev = nextBucket;
+
+        bucket->next = nextBucket;
+    }
+
+    lfuRemove(fs, file, 0);
+
+    appendFile(&(nextBucket->files), file);
+    file->bucket = nextBucket;
+}
+
+static File *lfuVictim(Filesystem *fs, File *toAdd)
+{
+    LfuBucket *bucket;
+    File *toEvict = NULL;
+
+    int busy = 0;
+
+    for (bucket = STATE(fs, LfuBucket); bucket && !toEvict; bucket = bucket->next)
+        toEvict = firstEvictable(bucket->files.head, toAdd, &busy);
+
+    return victimOrError(toEvict, busy);
+}
+
+/* ---------------------------------------------------- ARC ---------------------------------------------------- */
+
+static int arcInit(Filesystem *fs)
+{
+    if (allocState(fs, sizeof(ArcState)) == -1)
+        return -1;
+
+    if (!(STATE(fs, ArcState)->ghosts = icl_hash_create(MAX((int)(fs->maxFiles * (0.75F)), 1), NULL, NULL)))
+    {
+        freeState(fs);
+        errno = ENOMEM;
+        return -1;
+    }
+
+    return 0;
+}
+
+static void arcDestroy(Filesystem *fs)
+{
+    icl_hash_destroy(STATE(fs, ArcState)->ghosts, NULL, &freeGhost);
+    freeState(fs);
+}
+
+/**
+ * @brief Aggiunge il file 'file' in fondo (posizione MRU) alla lista 'list' di ARC.
+ */
+static void arcAppend(ArcState *arc, File *file, short list)
+{
+    appendFile(list == LIST_T1 ? &(arc->t1) : &(arc->t2), file);
+    file->list = list;
+}
+
+/**
+ * @brief Rimuove il file 'file' dalla sua lista di ARC.
+ */
+static void arcUnlink(ArcState *arc, File *file)
+{
+    unlinkFile(file->list == LIST_T1 ? &(arc->t1) : &(arc->t2), file);
+    file->list = LIST_MAIN;
+}
+
+/**
+ * @brief Rimuove il ghost 'ghost' dalla sua lista.
+ */
+static void arcDropGhost(ArcState *arc, Ghost *ghost)
+{
+    dropGhost(arc->ghosts, ghost->list == LIST_T1 ? &(arc->b1) : &(arc->b2), ghost);
+}
+
+/**
+ * @brief Inserisce un nuovo file. Se il suo path ha un ghost adatta 'p' e lo inserisce in T2, altrimenti in T1.
+ */
+static void arcInsert(Filesystem *fs, File *file)
+{
+    ArcState *arc = STATE(fs, ArcState);
+    Ghost *ghost = (Ghost *)icl_hash_find(arc->ghosts, file->path);
+    size_t delta;
+
+    if (!ghost)
+    {
+        arcAppend(arc, file, LIST_T1);
+        return;
+    }
+
+    if (ghost->list == LIST_T1)
+    {
+        // hit in B1: T1 era troppo piccola
+        delta = MAX(arc->b2.len / arc->b1.len, 1);
+        arc->p = MIN(arc->p + delta, fs->maxFiles);
+    }
+    else
+    {
+        // hit in B2: T2 era troppo piccola
+        delta = MAX(arc->b1.len / arc->b2.len, 1);
+        arc->p = (arc->p > delta) ? arc->p - delta : 0;
+    }
+
+    arcDropGhost(arc, ghost);
+
+    arcAppend(arc, file, LIST_T2);
+}
+
+static void arcAccess(Filesystem *fs, File *file, int kind)
+{
+    // riaprire un file e' un hit che lo porta in T2, gli altri accessi lo spostano in fondo alla sua lista
+    short list = (kind == TOUCH_OPEN) ? LIST_T2 : file->list;
+
+    arcUnlink(STATE(fs, ArcState), file);
+    arcAppend(STATE(fs, ArcState), file, list);
+}
+
+static void arcRemove(Filesystem *fs, File *file, int evicted)
+{
+    ArcState *arc = STATE(fs, ArcState);
+    short list = file->list;
+
+    arcUnlink(arc, file);
+
+    // ARC ricorda i file espulsi per adattarsi al carico
+    if (!evicted)
+        return;
+
+    addGhost(arc->ghosts, list == LIST_T1 ? &(arc->b1) : &(arc->b2), file->path, list);
+
+    // come in ARC, B1 viene accorciata quando T1 e B1 insieme superano la capacita' della cache
+    while (arc->b1.len + arc->b2.len > fs->maxFiles)
+    {
+        if (arc->b1.len && (arc->t1.len + arc->b1.len > fs->maxFiles || !arc->b2.len))
+            arcDropGhost(arc, arc->b1.head);
+        else
+            arcDropGhost(arc, arc->b2.head);
+    }
+}
+
+static File *arcVictim(Filesystem *fs, File *toAdd)
+{
+    ArcState *arc = STATE(fs, ArcState);
+    File *toEvict;
+
+    int busy = 0;
+
+    // si espelle da T1 se ha superato la sua dimensione obiettivo, altrimenti da T2
+    if (arc->t1.len && (arc->t1.len > arc->p || !arc->t2.len))
+    {
+        if (!(toEvict = firstEvictable(arc->t1.head, toAdd, &busy)))
+            toEvict = firstEvictable(arc->t2.head, toAdd, &busy);
+    }
+    else if (!(toEvict = firstEvictable(arc->t2.head, toAdd, &busy)))
+        toEvict = firstEvictable(arc->t1.head, toAdd, &busy);
+
+    return victimOrError(toEvict, busy);
+}
+
+static void arcStats(Filesystem *fs)
+{
+    ArcState *arc = STATE(fs, ArcState);
+
+    printf("ARC: T1 %zu, T2 %zu, B1 %zu, B2 %zu, p %zu\n", arc->t1.len, arc->t2.len, arc->b1.len, arc->b2.len, arc->p);
+}
+
+/* ---------------------------------------------------- GDSF ---------------------------------------------------- */
+
+/**
+ * @brief Confronta due file dello heap: positivo se 'file1' deve essere espulso prima di 'file2'. A parita' di priorita'
+ *  viene espulso il file inserito prima (l'istante di inserimento, a differenza di lastUsed, non cambia nello heap).
+ */
+static int gdsfCompare(File *file1, File *file2)
+{
+    int res = CMP(file2->priority, file1->priority);
+
+    return res ? res : CMP(file2->insertionTime, file1->insertionTime);
+}
+
+static int gdsfInit(Filesystem *fs)
+{
+    if (allocState(fs, sizeof(GdsfState)) == -1)
+        return -1;
+
+    // nello heap non ci possono essere piu' di maxFiles file
+    if (!(STATE(fs, GdsfState)->heap = calloc(fs->maxFiles, sizeof(File *))))
+    {
+        freeState(fs);
+        errno = ENOMEM;
+        return -1;
+    }
+
+    return 0;
+}
+
+static void gdsfDestroy(Filesystem *fs)
+{
+    free(STATE(fs, GdsfState)->heap);
+    freeState(fs);
+}
+
+/**
+ * @brief Scambia i file in posizione 'i' e 'j' dello heap.
+ */
+static void heapSwap(GdsfState *gdsf, size_t i, size_t j)
+{
+    File *tmp = gdsf->heap[i];
+
+    gdsf->heap[i] = gdsf->heap[j];
+    gdsf->heap[j] = tmp;
+
+    gdsf->heap[i]->heapIndex = i;
+    gdsf->heap[j]->heapIndex = j;
+}
+
+/**
+ * @brief Ripristina la proprieta' dello heap per il file in posizione 'i', spostandolo verso la radice o verso le foglie.
+ */
+static void heapFix(GdsfState *gdsf, size_t i)
+{
+    size_t child,
+        min;
+
+    while (i > 0 && gdsfCompare(gdsf->heap[i], gdsf->heap[(i - 1) / 2]) > 0)
+    {
+        heapSwap(gdsf, i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+
+    while (1)
+    {
+        min = i;
+
+        for (child = 2 * i + 1; child <= 2 * i + 2 && child < gdsf->len; child++)
+        {
+            if (gdsfCompare(gdsf->heap[child], gdsf->heap[min]) > 0)
+                min = child;
+        }
+
+        if (min == i)
+            break;
+
+        heapSwap(gdsf, i, min);
+        i = min;
+    }
+}
+
+/**
+ * @brief Ricalcola la priorita' del file 'file' come se avesse dimensione 'size' e aggiorna la sua posizione nello heap.
+ *  Il costo di un miss e' lo stesso per tutti i file, quindi la priorita' e' L + accessi / dimensione.
+ */
+static void gdsfResize(Filesystem *fs, File *file, size_t size)
+{
+    GdsfState *gdsf = STATE(fs, GdsfState);
+    double cost = (double)__atomic_load_n(&(file->usedTimes), __ATOMIC_RELAXED);
+
+    file->priority = gdsf->inflation + cost / (size ? size : 1);
+
+    heapFix(gdsf, file->heapIndex);
+}
+
+static void gdsfInsert(Filesystem *fs, File *file)
+{
+    GdsfState *gdsf = STATE(fs, GdsfState);
+
+    file->heapIndex = gdsf->len;
+    gdsf->heap[gdsf->len++] = file;
+
+    gdsfResize(fs, file, __atomic_load_n(&(file->dataSize), __ATOMIC_RELAXED));
+}
+
+static void gdsfAccess(Filesystem *fs, File *file, int kind)
+{
+    gdsfResize(fs, file, __atomic_load_n(&(file->dataSize), __ATOMIC_RELAXED));
+}
+
+static void gdsfRemove(Filesystem *fs, File *file, int evicted)
+{
+    GdsfState *gdsf = STATE(fs, GdsfState);
+    size_t i = file->heapIndex;
+
+    // l'ultimo file dello heap prende il posto di quello rimosso
+    if (i < --gdsf->len)
+    {
+        heapSwap(gdsf, i, gdsf->len);
+        heapFix(gdsf, i);
+    }
+
+    // i file inseriti o acceduti da ora in poi partono dalla priorita' della vittima
+    if (evicted)
+        gdsf->inflation = file->priority;
+}
+
+static File *gdsfVictim(Filesystem *fs, File *toAdd)
+{
+    GdsfState *gdsf = STATE(fs, GdsfState);
+    File *toEvict = NULL;
+    size_t i;
+
+    int busy = 0;
+
+    if (gdsf->len && IS_EVICTABLE(gdsf->heap[0], toAdd))
+        return gdsf->heap[0];
+
+    // la radice e' in uso: cerco il file con priorita' minima tra quelli espellibili
+    for (i = 0; i < gdsf->len; i++)
+    {
+        if (!IS_EVICTABLE(gdsf->heap[i], toAdd))
+        {
+            if (gdsf->heap[i] != toAdd)
+                busy = 1;
+        }
+        else if (!toEvict || gdsfCompare(gdsf->heap[i], toEvict) > 0)
+            toEvict = gdsf->heap[i];
+    }
+
+    return victimOrError(toEvict, busy);
+}
+
+static void gdsfStats(Filesystem *fs)
+{
+    printf("GDSF: L %g\n", STATE(fs, GdsfState)->inflation);
+}
+
+/* ------------------------------------------------- W-TinyLFU ------------------------------------------------- */
+
+static int tinylfuInit(Filesystem *fs)
+{
+    if (allocState(fs, sizeof(TinyLfuState)) == -1)
+        return -1;
+
+    STATE(fs, TinyLfuState)->windowMax = MAX(fs->maxFiles / 100, 1);
+
+    if (!(STATE(fs, TinyLfuState)->sketch = initSketch(fs->maxFiles)))
+    {
+        freeState(fs);
+        return -1;
+    }
+
+    return 0;
+}
+
+static void tinylfuDestroy(Filesystem *fs)
+{
+    deleteSketch(STATE(fs, TinyLfuState)->sketch);
+    freeState(fs);
+}
+
+/**
+ * @brief Ammette il file 'file' della finestra nella coda principale, in posizione MRU.
+ */
+static void tinylfuAdmit(TinyLfuState *state, File *file)
+{
+    unlinkFile(&(state->window), file);
+    appendFile(&(state->main), file);
+    file->list = LIST_MAIN;
+}
+
+static void tinylfuInsert(Filesystem *fs, File *file)
+{
+    TinyLfuState *state = STATE(fs, TinyLfuState);
+
+    sketchIncrement(state->sketch, file->path);
+
+    appendFile(&(state->window), file);
+    file->list = LIST_WINDOW;
+
+    // finche' la coda principale ha posto i file in eccesso nella finestra vi entrano senza passare dal filtro
+    while (state->window.len > state->windowMax && state->main.len + state->windowMax < fs->maxFiles)
+        tinylfuAdmit(state, state->window.head);
+}
+
+static void tinylfuAccess(Filesystem *fs, File *file, int kind)
+{
+    TinyLfuState *state = STATE(fs, TinyLfuState);
+
+    sketchIncrement(state->sketch, file->path);
+
+    moveToTail(file->list == LIST_WINDOW ? &(state->window) : &(state->main), file);
+}
+
+static void tinylfuRemove(Filesystem *fs, File *file, int evicted)
+{
+    TinyLfuState *state = STATE(fs, TinyLfuState);
+
+    unlinkFile(file->list == LIST_WINDOW ? &(state->window) : &(state->main), file);
+    file->list = LIST_MAIN;
+}
+
+/**
+ * @brief Registra nello sketch una richiesta per un file non presente: se il file verra' creato avra' piu' possibilita'
+ *  di essere ammesso.
+ */
+static void tinylfuMiss(Filesystem *fs, const char *path)
+{
+    sketchIncrement(STATE(fs, TinyLfuState)->sketch, path);
+}
+
+static File *tinylfuVictim(Filesystem *fs, File *toAdd)
+{
+    TinyLfuState *state = STATE(fs, TinyLfuState);
+    File *toEvict,
+        *candidate;
+
+    int busy = 0;
+
+    candidate = firstEvictable(state->window.head, toAdd, &busy);
+    toEvict = firstEvictable(state->main.head, toAdd, &busy);
+
+    if (!toEvict)
+        toEvict = candidate;
+    else if (candidate && state->window.len + !toAdd > state->windowMax)
+    {
+        // la finestra e' piena (un nuovo file vi entrera' a breve): il suo file meno recente entra nella coda
+        // principale solo se e' piu' frequente della vittima, altrimenti viene espulso lui
+        if (sketchFrequency(state->sketch, candidate->path) > sketchFrequency(state->sketch, toEvict->path))
+            tinylfuAdmit(state, candidate);
+        else
+            toEvict = candidate;
+    }
+    else if (toAdd && toAdd->list == LIST_WINDOW &&
+             sketchFrequency(state->sketch, toAdd->path) <= sketchFrequency(state->sketch, toEvict->path))
+    {
+        // i dati di un file non ancora ammesso possono espellere solo file della finestra
+        if (!candidate)
+        {
+            errno = ECANCELED;
+            return NULL;
+        }
+
+        toEvict = candidate;
+    }
+
+    return victimOrError(toEvict, busy);
+}
+
+static void tinylfuStats(Filesystem *fs)
+{
+    TinyLfuState *state = STATE(fs, TinyLfuState);
+
+    printf("W-TinyLFU: finestra %zu/%zu, coda principale %zu\n", state->window.len, state->windowMax, state->main.len);
+}
+
+/* -------------------------------------------------- S3-FIFO -------------------------------------------------- */
+
+static int s3fifoInit(Filesystem *fs)
+{
+    if (allocState(fs, sizeof(S3FifoState)) == -1)
+        return -1;
+
+    STATE(fs, S3FifoState)->smallMax = MAX(fs->maxFiles / 10, 1);
+
+    if (!(STATE(fs, S3FifoState)->table = icl_hash_create(MAX((int)(fs->maxFiles * (0.75F)), 1), NULL, NULL)))
+    {
+        freeState(fs);
+        errno = ENOMEM;
+        return -1;
+    }
+
+    return 0;
+}
+
+static void s3fifoDestroy(Filesystem *fs)
+{
+    icl_hash_destroy(STATE(fs, S3FifoState)->table, NULL, &freeGhost);
+    freeState(fs);
+}
+
+static void s3fifoInsert(Filesystem *fs, File *file)
+{
+    S3FifoState *state = STATE(fs, S3FifoState);
+    Ghost *ghost = (Ghost *)icl_hash_find(state->table, file->path);
+
+    // un file espulso di recente dalla coda piccola e poi ricreato non deve ripetere la prova
+    if (ghost)
+    {
+        dropGhost(state->table, &(state->ghosts), ghost);
+        appendFile(&(state->main), file);
+        file->list = LIST_MAIN;
+    }
+    else
+    {
+        appendFile(&(state->small), file);
+        file->list = LIST_SMALL;
+    }
+}
+
+static void s3fifoAccess(Filesystem *fs, File *file, int kind)
+{
+    short freq = __atomic_load_n(&(file->referenceBit), __ATOMIC_RELAXED);
+
+    // le letture incrementano il contatore senza spostare il file nella coda
+    while (kind == TOUCH_READ && freq < S3FIFO_MAX_FREQ &&
+           !__atomic_compare_exchange_n(&(file->referenceBit), &freq, freq + 1, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+}
+
+static void s3fifoRemove(Filesystem *fs, File *file, int evicted)
+{
+    S3FifoState *state = STATE(fs, S3FifoState);
+
+    if (file->list != LIST_SMALL)
+    {
+        unlinkFile(&(state->main), file);
+        return;
+    }
+
+    unlinkFile(&(state->small), file);
+    file->list = LIST_MAIN;
+
+    // S3-FIFO ricorda i file che non hanno superato la prova nella coda piccola
+    if (!evicted)
+        return;
+
+    addGhost(state->table, &(state->ghosts), file->path, LIST_SMALL);
+
+    while (state->ghosts.len > fs->maxFiles)
+        dropGhost(state->table, &(state->ghosts), state->ghosts.head);
+}
+
+/**
+ * @brief Cerca una vittima nella coda piccola: i file letti durante la prova passano nella coda principale con il
+ *  contatore azzerato.
+ */
+static File *s3fifoEvictSmall(S3FifoState *state, File *toAdd, int *busy)
+{
+    File *file,
+        *next;
+
+    for (file = state->small.head; file; file = next)
+    {
+        next = file->next;
+
+        if (__atomic_load_n(&(file->referenceBit), __ATOMIC_RELAXED) > 0)
+        {
+            unlinkFile(&(state->small), file);
+            appendFile(&(state->main), file);
+            file->list = LIST_MAIN;
+
+            __atomic_store_n(&(file->referenceBit), 0, __ATOMIC_RELAXED);
+        }
+        else if (IS_EVICTABLE(file, toAdd))
+            return file;
+        else if (file != toAdd)
+            *busy = 1;
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Cerca una vittima nella coda principale: i file letti vengono reinseriti in fondo consumando una lettura,
+ *  quindi ogni file viene esaminato al piu' S3FIFO_MAX_FREQ + 1 volte.
+ */
+static File *s3fifoEvictMain(S3FifoState *state, File *toAdd, int *busy)
+{
+    File *file,
+        *next;
+    short freq;
+    size_t i;
+
+    file = state->main.head;
+
+    for (i = 0; file && i <= (S3FIFO_MAX_FREQ + 1) * state->main.len; i++)
+    {
+        next = file->next;
+        freq = __atomic_load_n(&(file->referenceBit), __ATOMIC_RELAXED);
+
+        if (freq > 0)
+        {
+            // una lettura concorrente puo' andare persa, come in S3-FIFO il contatore e' approssimato
+            __atomic_store_n(&(file->referenceBit), freq - 1, __ATOMIC_RELAXED);
+
+            moveToTail(&(state->main), file);
+
+            if (!next)
+                next = file;
+        }
+        else if (IS_EVICTABLE(file, toAdd))
+            return file;
+        else if (file != toAdd)
+            *busy = 1;
+
+        file = next;
+    }
+
+    return NULL;
+}
+
+static File *s3fifoVictim(Filesystem *fs, File *toAdd)
+{
+    S3FifoState *state = STATE(fs, S3FifoState);
+    File *toEvict = NULL;
+
+    int busy = 0;
+
+    // si espelle dalla coda piccola finche' supera la sua quota, altrimenti dalla principale
+    if (state->small.len > state->smallMax || !state->main.len)
+        toEvict = s3fifoEvictSmall(state, toAdd, &busy);
+
+    if (!toEvict && !(toEvict = s3fifoEvictMain(state, toAdd, &busy)))
+        toEvict = s3fifoEvictSmall(state, toAdd, &busy);
+
+    return victimOrError(toEvict, busy);
+}
+
+static void s3fifoStats(Filesystem *fs)
+{
+    S3FifoState *state = STATE(fs, S3FifoState);
+
+    printf("S3-FIFO: coda piccola %zu/%zu, coda principale %zu, ghost %zu\n", state->small.len, state->smallMax,
+           state->main.len, state->ghosts.len);
+}
+
+/* ------------------------------------------------------------------------------------------------------------- */
+
+static const EvictionPolicy policies[N_POLICIES] = {
+    [FIFO] = {.name = "FIFO", .lockFreeAccess = 1, .init = listInit, .destroy = freeState, .on_insert = listInsert,
+              .on_remove = listRemove, .choose_victim = listVictim},
+
+    [LRU] = {.name = "LRU", .init = listInit, .destroy = freeState, .on_insert = listInsert, .on_access = lruAccess,
+             .on_remove = listRemove, .choose_victim = listVictim},
+
+    [LFU] = {.name = "LFU", .init = lfuInit, .destroy = lfuDestroy, .on_insert = lfuInsert, .on_access = lfuAccess,
+             .on_remove = lfuRemove, .choose_victim = lfuVictim},
+
+    [SECOND_CHANCE] = {.name = "Second-chance", .lockFreeAccess = 1, .init = clockInit, .destroy = freeState,
+                       .on_insert = clockInsert, .on_access = clockAccess, .on_remove = clockRemove,
+                       .choose_victim = clockVictim},
+
+    [ARC] = {.name = "ARC", .init = arcInit, .destroy = arcDestroy, .on_insert = arcInsert, .on_access = arcAccess,
+             .on_remove = arcRemove, .choose_victim = arcVictim, .stats = arcStats},
+
+    [GDSF] = {.name = "GDSF", .init = gdsfInit, .destroy = gdsfDestroy, .on_insert = gdsfInsert, .on_access = gdsfAccess,
+              .on_resize = gdsfResize, .on_remove = gdsfRemove, .choose_victim = gdsfVictim, .stats = gdsfStats},
+
+    [TINYLFU] = {.name = "W-TinyLFU", .init = tinylfuInit, .destroy = tinylfuDestroy, .on_insert = tinylfuInsert,
+                 .on_access = tinylfuAccess, .on_remove = tinylfuRemove, .on_miss = tinylfuMiss,
+                 .choose_victim = tinylfuVictim, .stats = tinylfuStats},
+
+    [S3FIFO] = {.name = "S3-FIFO", .lockFreeAccess = 1, .init = s3fifoInit, .destroy = s3fifoDestroy,
+                .on_insert = s3fifoInsert, .on_access = s3fifoAccess, .on_remove = s3fifoRemove,
+                .choose_victim = s3fifoVictim, .stats = s3fifoStats},
+};
+
+const EvictionPolicy *getPolicy(int replacement_algo)
+{
+    if (replacement_algo < 0 || replacement_algo >= N_POLICIES)
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    return &policies[replacement_algo];
+}
+
+void printPolicyStats(Filesystem *fs)
+{
+    if (!fs || !fs->policy)
+        return;
+
+    printf("Politica di rimpiazzamento: %s\n", fs->policy->name);
+
+    if (!fs->policy->stats)
+        return;
+
+    LOCK(&(fs->queueLock));
+    fs->policy->stats(fs);
+    UNLOCK(&(fs->queueLock));
+}
@@ -0,0 +1,246 @@
+#include "../include/define_source.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../include/boundedqueue.h"
+#include "../include/mpmcqueue.h"
+#include "../include/utils.h"
+
+#define DFL_PRODUCERS 4
+#define DFL_CONSUMERS 4
+#define DFL_ITEMS 200000 // dati inseriti da ogni produttore
+#define DFL_QUEUE_LEN 64
+#define BENCH_BATCH 16
+
+#define BENCH_BQUEUE 0
+#define BENCH_MPMC 1
+#define BENCH_MPMC_BATCH 2
+
+#define BENCH_USAGE "Uso: %s [-p produttori] [-c consumatori] [-n dati per produttore] [-q dimensione della coda]\n"
+
+static const char *benchNames[] = {"BQueue (mutex + condvar)", "MPMC", "MPMC batch"};
+
+typedef struct bench
+{
+    int kind;
+    BQueue_t *bqueue;
+    MPMCQueue_t *mpmc;
+    size_t items;
+    size_t consumed; // dati estratti dai consumatori, aggiornato con operazioni atomiche
+} Bench;
+
+static void *producer(void *arg)
+{
+    Bench *bench = (Bench *)arg;
+    void *batch[BENCH_BATCH];
+    size_t i,
+        n;
+
+    for (i = 0; i < bench->items; i += n)
+    {
+        n = MIN(BENCH_BATCH, bench->items - i);
+
+        // i dati sono puntatori non NULL e diversi da EOS, non vengono mai dereferenziati
+        for (size_t j = 0; j < n; j++)
+            batch[j] = (void *)(uintptr_t)(i + j + 2);
+
+        switch (bench->kind)
+        {
+        case BENCH_BQUEUE:
+            for (size_t j = 0; j < n; j++)
+                push(bench->bqueue, batch[j]);
+            break;
+        case BENCH_MPMC:
+            for (size_t j = 0; j < n; j++)
+                mpmcPush(bench->mpmc, batch[j]);
+            break;
+        default:
+            mpmcPushBatch(bench->mpmc, batch, n);
+            break;
+        }
+    }
+
+    return NULL;
+}
+
+static void *consumer(void *arg)
+{
+    Bench *bench = (Bench *)arg;
+    void *batch[BENCH_BATCH];
+    size_t consumed = 0,
+           n,
+           i;
+
+    while (1)
+    {
+        switch (bench->kind)
+        {
+        case BENCH_BQUEUE:
+            batch[0] = pop(bench->bqueue);
+            n = 1;
+            break;
+        case BENCH_MPMC:
+            batch[0] = mpmcPop(bench->mpmc);
+            n = 1;
+            break;
+        default:
+            n = mpmcPopBatch(bench->mpmc, batch, BENCH_BATCH);
+            break;
+        }
+
+        // gli EOS vengono inseriti dopo tutti i dati: in un batch possono seguire solo altri EOS
+        for (i = 0; i < n && batch[i] != EOS; i++)
+            consumed++;
+
+        if (i < n)
+        {
+            // ogni consumatore deve ricevere un EOS: rimetto in coda quelli estratti in piu'
+            for (i++; i < n; i++)
+                mpmcPush(bench->mpmc, EOS);
+
+            __atomic_add_fetch(&(bench->consumed), consumed, __ATOMIC_RELAXED);
+            return NULL;
+        }
+    }
+}
+
+/**
+ * @brief Esegue un benchmark con 'nProducers' produttori e 'nConsumers' consumatori sulla coda di tipo 'kind'.
+ *
+ * \retval secondi impiegati, -1 se errore
+ */
+static double runBench(int kind, int nProducers, int nConsumers, size_t items, size_t queueLen, size_t *consumed)
+{
+    pthread_t *producers,
+        *consumers;
+    struct timespec start,
+        end;
+    Bench bench;
+    int i;
+
+    memset(&bench, 0, sizeof(bench));
+    bench.kind = kind;
+    bench.items = items;
+
+    if (kind == BENCH_BQUEUE ? !(bench.bqueue = initBQueue(queueLen)) : !(bench.mpmc = initMPMCQueue(queueLen)))
+        return -1;
+
+    producers = calloc(nProducers, sizeof(pthread_t));
+    consumers = calloc(nConsumers, sizeof(pthread_t));
+
+    if (!producers || !consumers)
+    {
+        free(producers);
+        free(consumers);
+        return -1;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for (i = 0; i < nConsumers; i++)
+        CHECK_PTHREAD_AND_ACTION(pthread_create, !=, 0, exit(EXIT_FAILURE), &consumers[i], NULL, &consumer, &bench);
+
+    for (i = 0; i < nProducers; i++)
+        CHECK_PTHREAD_AND_ACTION(pthread_create, !=, 0, exit(EXIT_FAILURE), &producers[i], NULL, &producer, &bench);
+
+    for (i = 0; i < nProducers; i++)
+        CHECK_PTHREAD_AND_ACTION(pthread_join, !=, 0, exit(EXIT_FAILURE), producers[i], NULL);
+
+    // dopo tutti i dati, un EOS per ogni consumatore
+    for (i = 0; i < nConsumers; i++)
+    {
+        if (kind == BENCH_BQUEUE)
+            push(bench.bqueue, EOS);
+        else
+            mpmcPush(bench.mpmc, EOS);
+    }
+
+    for (i = 0; i < nConsumers; i++)
+        CHECK_PTHREAD_AND_ACTION(pthread_join, !=, 0, exit(EXIT_FAILURE), consumers[i], NULL);
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    if (kind == BENCH_BQUEUE)
+        deleteBQueue(bench.bqueue, NULL);
+    else
+        deleteMPMCQueue(bench.mpmc, NULL);
+
+    free(producers);
+    free(consumers);
+
+    *consumed = bench.consumed;
+
+    return (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+int main(int argc, char *argv[])
+{
+    long nProducers = DFL_PRODUCERS,
+         nConsumers = DFL_CONSUMERS,
+         items = DFL_ITEMS,
+         queueLen = DFL_QUEUE_LEN;
+    size_t consumed;
+    double seconds;
+    int opt,
+        kind;
+
+    while ((opt = getopt(argc, argv, "p:c:n:q:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'p':
+            if (isNumber(optarg, &nProducers) != 0 || nProducers <= 0)
+                nProducers = -1;
+            break;
+        case 'c':
+            if (isNumber(optarg, &nConsumers) != 0 || nConsumers <= 0)
+                nConsumers = -1;
+            break;
+        case 'n':
+            if (isNumber(optarg, &items) != 0 || items <= 0)
+                items = -1;
+            break;
+        case 'q':
+            if (isNumber(optarg, &queueLen) != 0 || queueLen <= 0)
+                queueLen = -1;
+            break;
+        default:
+            fprintf(stderr, BENCH_USAGE, argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (nProducers < 0 || nConsumers < 0 || items < 0 || queueLen < 0)
+    {
+        fprintf(stderr, BENCH_USAGE, argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    printf("%ld produttori, %ld consumatori, %ld dati per produttore, coda di %ld posizioni\n", nProducers, nConsumers,
+           items, queueLen);
+
+    for (kind = BENCH_BQUEUE; kind <= BENCH_MPMC_BATCH; kind++)
+    {
+        if ((seconds = runBench(kind, (int)nProducers, (int)nConsumers, (size_t)items, (size_t)queueLen, &consumed)) < 0)
+        {
+            perror("runBench");
+            return EXIT_FAILURE;
+        }
+
+        if (consumed != (size_t)(nProducers * items))
+        {
+            fprintf(stderr, "%s: estratti %zu dati su %ld\n", benchNames[kind], consumed, nProducers * items);
+            return EXIT_FAILURE;
+        }
+
+        printf("%-26s %8.3f s %12.0f op/s\n", benchNames[kind], seconds, consumed / seconds);
+    }
+
+    return EXIT_SUCCESS;
+}
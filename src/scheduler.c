@@ -0,0 +1,386 @@
+#include "../include/define_source.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../include/scheduler.h"
+
+#define NS_PER_MS 1000000ULL
+
+/**
+ * @brief Cerca un dato per il worker 'worker', prima nella sua coda e poi, a partire dalla successiva, in quelle degli
+ *  altri worker, compresi quelli terminati.
+ *
+ * \retval NULL se tutte le code sono vuote
+ */
+static void *trySteal(Scheduler *sched, size_t worker)
+{
+    void *data;
+    size_t i;
+
+    for (i = 0; i < sched->nQueues; i++)
+    {
+        if ((data = mpmcTryPop(sched->queues[(worker + i) % sched->nQueues])))
+            return data;
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Rimuove il worker 'worker' dal pool se ha piu' del numero minimo di worker.
+ *
+ * \retval 1 se il worker e' stato rimosso
+ * \retval 0 altrimenti
+ */
+static int retireWorker(Scheduler *sched, size_t worker)
+{
+    size_t n = __atomic_load_n(&(sched->nWorkers), __ATOMIC_RELAXED);
+
+    while (n > sched->minWorkers)
+    {
+        if (__atomic_compare_exchange_n(&(sched->nWorkers), &n, n - 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        {
+            // da ora il manager non sceglie piu' la sua coda e puo' riassegnarne il posto
+            __atomic_store_n(&(sched->running[worker]), 0, __ATOMIC_RELEASE);
+            __atomic_add_fetch(&(sched->retired), 1, __ATOMIC_RELAXED);
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+Scheduler *initScheduler(size_t minWorkers, size_t maxWorkers, size_t queueLen, long idleTimeout)
+{
+    Scheduler *sched;
+    size_t i;
+
+    if (minWorkers == 0 || maxWorkers < minWorkers || idleTimeout < 0)
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    if (!(sched = calloc(1, sizeof(Scheduler))))
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    sched->queues = calloc(maxWorkers, sizeof(MPMCQueue_t *));
+    sched->running = calloc(maxWorkers, sizeof(char));
+    sched->sizeHist = calloc(maxWorkers + 1, sizeof(size_t));
+
+    if (!sched->queues || !sched->running || !sched->sizeHist)
+    {
+        deleteScheduler(sched, NULL);
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    sched->nQueues = maxWorkers;
+    sched->minWorkers = minWorkers;
+    sched->idleTimeout = (uint64_t)idleTimeout * NS_PER_MS;
+
+    for (i = 0; i < maxWorkers; i++)
+    {
+        if (!(sched->queues[i] = initMPMCQueue(queueLen)))
+        {
+            deleteScheduler(sched, NULL);
+            errno = ENOMEM;
+            return NULL;
+        }
+    }
+
+    return sched;
+}
+
+void deleteScheduler(Scheduler *sched, void (*F)(void *))
+{
+    size_t i;
+
+    if (!sched)
+        return;
+
+    for (i = 0; sched->queues && i < sched->nQueues; i++)
+    {
+        if (sched->queues[i])
+            deleteMPMCQueue(sched->queues[i], F);
+    }
+
+    free(sched->queues);
+    free(sched->running);
+    free(sched->sizeHist);
+    free(sched);
+}
+
+long schedulerAddWorker(Scheduler *sched)
+{
+    size_t i,
+        n;
+
+    if (!sched)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    for (i = 0; i < sched->nQueues; i++)
+    {
+        if (!__atomic_load_n(&(sched->running[i]), __ATOMIC_ACQUIRE))
+            break;
+    }
+
+    // pool al massimo, o un worker che termina e' gia' stato tolto dal conteggio ma non ha ancora liberato il posto
+    if (i == sched->nQueues)
+    {
+        errno = EAGAIN;
+        return -1;
+    }
+
+    __atomic_store_n(&(sched->running[i]), 1, __ATOMIC_RELAXED);
+    n = __atomic_add_fetch(&(sched->nWorkers), 1, __ATOMIC_RELAXED);
+
+    if (n > __atomic_load_n(&(sched->peakWorkers), __ATOMIC_RELAXED))
+        __atomic_store_n(&(sched->peakWorkers), n, __ATOMIC_RELAXED);
+
+    __atomic_add_fetch(&(sched->spawned), 1, __ATOMIC_RELAXED);
+
+    return (long)i;
+}
+
+int schedulerOverloaded(Scheduler *sched, size_t depth, long wait)
+{
+    size_t queued = 0,
+           i;
+    int overloaded;
+
+    if (!sched)
+        return 0;
+
+    if (__atomic_load_n(&(sched->nWorkers), __ATOMIC_RELAXED) >= sched->nQueues)
+    {
+        sched->overloadedPasses = 0;
+        return 0;
+    }
+
+    overloaded = wait > 0 && __atomic_load_n(&(sched->avgWait), __ATOMIC_RELAXED) > (uint64_t)wait * NS_PER_MS;
+
+    for (i = 0; !overloaded && depth > 0 && i < sched->nQueues; i++)
+        queued += mpmcLength(sched->queues[i]);
+
+    if (!overloaded && (depth == 0 || queued < depth))
+    {
+        sched->overloadedPasses = 0;
+        return 0;
+    }
+
+    // un worker in piu' solo se il sovraccarico dura, poi il nuovo worker ha altrettante distribuzioni per smaltirlo
+    if (++sched->overloadedPasses < SCHED_OVERLOAD_PASSES)
+        return 0;
+
+    sched->overloadedPasses = 0;
+
+    return 1;
+}
+
+int schedulerDispatch(Scheduler *sched, void **data, size_t n)
+{
+    size_t i,
+        j,
+        shortest,
+        len,
+        minLen;
+
+    if (!sched || !data)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    __atomic_add_fetch(&(sched->sizeHist[__atomic_load_n(&(sched->nWorkers), __ATOMIC_RELAXED)]), 1, __ATOMIC_RELAXED);
+
+    for (i = 0; i < n; i++)
+    {
+        shortest = sched->nQueues;
+        minLen = 0;
+
+        for (j = 0; j < sched->nQueues; j++)
+        {
+            size_t q = (sched->next + j) % sched->nQueues;
+
+            if (!__atomic_load_n(&(sched->running[q]), __ATOMIC_RELAXED))
+                continue;
+
+            len = mpmcLength(sched->queues[q]);
+
+            if (shortest == sched->nQueues || len < minLen)
+            {
+                shortest = q;
+                minLen = len;
+            }
+
+            if (minLen == 0)
+                break;
+        }
+
+        // un worker che termina puo' lasciare il pool vuoto solo per un istante: i dati della sua coda vengono rubati
+        if (shortest == sched->nQueues)
+            shortest = sched->next;
+
+        sched->next = (shortest + 1) % sched->nQueues;
+
+        // attende solo se la coda scelta e' piena, finche' un worker non ne estrae un dato
+        if (mpmcPush(sched->queues[shortest], data[i]) == -1)
+            return -1;
+    }
+
+    eventNotify(&(sched->idle));
+
+    return 0;
+}
+
+int schedulerBroadcast(Scheduler *sched, void *data)
+{
+    size_t i;
+
+    if (!sched)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    for (i = 0; i < sched->nQueues; i++)
+    {
+        if (__atomic_load_n(&(sched->running[i]), __ATOMIC_ACQUIRE) && mpmcPush(sched->queues[i], data) == -1)
+            return -1;
+    }
+
+    eventNotify(&(sched->idle));
+
+    return 0;
+}
+
+void *schedulerNext(Scheduler *sched, size_t worker)
+{
+    uint64_t deadline = 0,
+             now;
+    unsigned int val;
+    void *data;
+
+    if (!sched || worker >= sched->nQueues)
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    while (1)
+    {
+        if ((data = trySteal(sched, worker)))
+            return data;
+
+        // mi registro prima dell'ultimo tentativo, cosi' non perdo i dati inseriti mentre mi addormento
+        val = eventPrepareWait(&(sched->idle));
+
+        if ((data = trySteal(sched, worker)))
+            return data;
+
+        if (!sched->idleTimeout || __atomic_load_n(&(sched->nWorkers), __ATOMIC_RELAXED) <= sched->minWorkers)
+        {
+            deadline = 0;
+            eventWait(&(sched->idle), val);
+            continue;
+        }
+
+        // l'inattivita' si conta dalla prima attesa: i risvegli per client presi da altri worker non la azzerano
+        now = schedulerNow();
+
+        if (!deadline)
+            deadline = now + sched->idleTimeout;
+
+        if (now < deadline && eventTimedWait(&(sched->idle), val, deadline - now) == 0)
+            continue;
+
+        if (retireWorker(sched, worker))
+        {
+            errno = ETIMEDOUT;
+            return NULL;
+        }
+
+        deadline = 0;
+    }
+}
+
+void schedulerRecordWait(Scheduler *sched, uint64_t wait)
+{
+    uint64_t us = wait / 1000,
+             avg,
+             next;
+    int bin = 0;
+
+    if (!sched)
+        return;
+
+    while (bin < SCHED_WAIT_BINS - 1 && us >= (1ULL << bin))
+        bin++;
+
+    __atomic_add_fetch(&(sched->waitHist[bin]), 1, __ATOMIC_RELAXED);
+
+    avg = __atomic_load_n(&(sched->avgWait), __ATOMIC_RELAXED);
+
+    do
+        next = avg - (avg >> SCHED_WAIT_DECAY) + (wait >> SCHED_WAIT_DECAY);
+    while (!__atomic_compare_exchange_n(&(sched->avgWait), &avg, next, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+}
+
+uint64_t schedulerNow(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+void schedulerPrintStats(Scheduler *sched, FILE *out)
+{
+    size_t count,
+        total = 0;
+    int i;
+
+    if (!sched || !out)
+        return;
+
+    fprintf(out, "Worker attivi: %zu (minimo %zu, massimo %zu, picco %zu), avviati %zu, terminati per inattivita' %zu\n",
+            __atomic_load_n(&(sched->nWorkers), __ATOMIC_RELAXED), sched->minWorkers, sched->nQueues,
+            __atomic_load_n(&(sched->peakWorkers), __ATOMIC_RELAXED), __atomic_load_n(&(sched->spawned), __ATOMIC_RELAXED),
+            __atomic_load_n(&(sched->retired), __ATOMIC_RELAXED));
+
+    fprintf(out, "Worker attivi ad ogni distribuzione di client:\n");
+
+    for (i = 0; (size_t)i <= sched->nQueues; i++)
+    {
+        if ((count = __atomic_load_n(&(sched->sizeHist[i]), __ATOMIC_RELAXED)))
+            fprintf(out, "%12d: %zu\n", i, count);
+    }
+
+    for (i = 0; i < SCHED_WAIT_BINS; i++)
+        total += __atomic_load_n(&(sched->waitHist[i]), __ATOMIC_RELAXED);
+
+    fprintf(out, "Attesa in coda dei client (%zu richieste, media recente %llu us):\n", total,
+            (unsigned long long)(__atomic_load_n(&(sched->avgWait), __ATOMIC_RELAXED) / 1000));
+
+    for (i = 0; i < SCHED_WAIT_BINS; i++)
+    {
+        if (!(count = __atomic_load_n(&(sched->waitHist[i]), __ATOMIC_RELAXED)))
+            continue;
+
+        if (i < SCHED_WAIT_BINS - 1)
+            fprintf(out, "  < %8llu us: %zu\n", 1ULL << i, count);
+        else
+            fprintf(out, "  >= %7llu us: %zu\n", 1ULL << (i - 1), count);
+    }
+}
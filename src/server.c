@@ -1,21 +1,24 @@
 #include "../include/define_source.h"
 
-#include <assert.h>
 #include <pthread.h>
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include <sys/select.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <sys/un.h>
 #include <unistd.h>
 
-#include "../include/boundedqueue.h"
 #include "../include/configParser.h"
 #include "../include/filesystem.h"
 #include "../include/logger.h"
 #include "../include/message_protocol.h"
+#include "../include/poller.h"
+#include "../include/policy.h"
+#include "../include/scheduler.h"
+#include "../include/slab.h"
 #include "../include/utils.h"
 #include "../include/worker.h"
 
@@ -26,8 +29,20 @@
 #define DFL_MAXMEMORY 100
 #define DFL_BACKLOG 5
 #define DFL_REPL_ALG 0
+#define DFL_MULTI_REACTOR 0
+#define DFL_REACTOR_BALANCE 0
+#define DFL_IO_ENGINE IO_ENGINE_SYSCALL
+#define DFL_HIGH_WATERMARK 0 // espulsione in background disattivata
+#define DFL_LOW_WATERMARK 0
+#define DFL_THREAD_IDLE_MS 30000 // inattivita' dopo cui un worker oltre THREADS termina
+#define DFL_SPAWN_QUEUE_DEPTH 4  // client in coda oltre cui il manager aggiunge un worker
+#define DFL_SPAWN_WAIT_MS 10     // attesa in coda oltre cui il manager aggiunge un worker
 
-#define QUEUE_LEN 50
+#define ROUND_ROBIN 0
+#define LEAST_LOADED 1
+
+#define QUEUE_LEN 50 // posizioni della coda di ogni worker
+#define MAX_EVENTS 64
 
 #define GET_NUMERIC_SETTING_VAL(settings, key, val, default, op, cond)   \
     if (1)                                                               \
@@ -59,8 +74,19 @@
 #define FILESYSTEM_STATS(maxFiles, maxMemory, evictedFiles) \
     printf("Numero massimo di file: %ld\nDimensione massimma raggiunta: %ld\nNumero di vittime: %ld\n", maxFiles, maxMemory, evictedFiles);
 
+#define EVICTION_STATS(evictedBytes, rejectedWrites, readHits, readMisses)                                                   \
+    printf("Byte espulsi: %ld\nScritture non ammesse: %ld\nHit ratio delle letture: %.2f%% (%ld/%ld)\n", evictedBytes,       \
+           rejectedWrites, (readHits) + (readMisses) ? 100.0 * (readHits) / ((readHits) + (readMisses)) : 0.0, readHits,       \
+           (readHits) + (readMisses));
+
+#define BACKGROUND_EVICTION_STATS(backgroundEvictions, syncEvictions) \
+    printf("File espulsi in background: %ld\nRichieste con espulsioni sincrone: %ld\n", backgroundEvictions, syncEvictions);
+
 char *sockname = "";
 
+// descrittori delle richieste inviate ai worker
+static SlabCache requestCache = SLAB_CACHE_INITIALIZER("request", sizeof(ClientRequest));
+
 volatile sig_atomic_t hardQuit = 0,
                       softQuit = 0;
 
@@ -72,13 +98,66 @@ void signal_handler(int signum)
         hardQuit = 1;
 }
 
-int updatemax(fd_set set, int fdmax)
+/**
+ * @brief Sceglie il worker a cui assegnare un nuovo client in modalita' multi-reactor.
+ *
+ * @param th_args argomenti dei worker
+ * @param nThreads numero di worker
+ * @param balance politica di assegnamento: ROUND_ROBIN o LEAST_LOADED
+ * @param nextReactor prossimo worker per il round-robin
+ * @return puntatore agli argomenti del worker scelto
+ */
+static ThreadArgs *chooseReactor(ThreadArgs *th_args, size_t nThreads, int balance, size_t *nextReactor)
+{
+    size_t chosen = *nextReactor;
+
+    if (balance == LEAST_LOADED)
+    {
+        for (size_t i = 0; i < nThreads; i++)
+        {
+            if (__atomic_load_n(&(th_args[i].nClients), __ATOMIC_RELAXED) < __atomic_load_n(&(th_args[chosen].nClients), __ATOMIC_RELAXED))
+                chosen = i;
+        }
+    }
+
+    *nextReactor = (chosen + 1) % nThreads;
+
+    return &th_args[chosen];
+}
+
+/**
+ * @brief Aggiunge un worker al pool elastico, attendendo prima la terminazione del thread che ne occupava il posto.
+ *
+ * @param scheduler scheduler dei worker
+ * @param th_args argomenti dei worker
+ * @param workers thread dei worker
+ * @param started 1 per i posti in cui e' gia' stato avviato un thread
+ * @param mask segnali gestiti dal manager, bloccati nei worker
+ *
+ * \retval 0 se successo
+ * \retval -1 se il pool ha gia' il numero massimo di worker
+ */
+static int spawnWorker(Scheduler *scheduler, ThreadArgs *th_args, pthread_t *workers, char *started, sigset_t *mask)
 {
-    for (int i = (fdmax - 1); i >= 0; --i)
-        if (FD_ISSET(i, &set))
-            return i;
-    assert(1 == 0);
-    return -1;
+    sigset_t oldMask;
+    long id;
+
+    if ((id = schedulerAddWorker(scheduler)) == -1)
+        return -1;
+
+    if (started[id])
+    {
+        CHECK_PTHREAD_AND_ACTION(pthread_join, !=, 0, exit(EXIT_FAILURE), workers[id], NULL);
+    }
+
+    // il nuovo thread eredita la maschera: i segnali devono continuare ad arrivare solo al manager
+    CHECK_PTHREAD_AND_ACTION(pthread_sigmask, !=, 0, exit(EXIT_FAILURE), SIG_BLOCK, mask, &oldMask);
+    CHECK_PTHREAD_AND_ACTION(pthread_create, !=, 0, exit(EXIT_FAILURE), &workers[id], NULL, &processRequest, (void *)&th_args[id]);
+    CHECK_PTHREAD_AND_ACTION(pthread_sigmask, !=, 0, exit(EXIT_FAILURE), SIG_SETMASK, &oldMask, NULL);
+
+    started[id] = 1;
+
+    return 0;
 }
 
 void cleanup()
@@ -111,27 +190,52 @@ int main(int argc, char const *argv[])
     size_t maxFiles,
         maxMemory,
         nThreads,
+        maxThreads,
+        spawnQueueDepth,
         maxConClients = 0,
         conClients = 0;
 
-    int replacment_algo;
+    int replacment_algo,
+        multiReactor,
+        reactorBalance,
+        ioEngine,
+        highWatermark,
+        lowWatermark;
+
+    long threadIdleMs,
+        spawnWaitMs;
 
     GET_NUMERIC_SETTING_VAL(settings, "THREADS", nThreads, DFL_THREADS, <=, 0);
+    GET_NUMERIC_SETTING_VAL(settings, "MAX_THREADS", maxThreads, nThreads, <, nThreads);
+    GET_NUMERIC_SETTING_VAL(settings, "THREAD_IDLE_MS", threadIdleMs, DFL_THREAD_IDLE_MS, <, 0);
+    GET_NUMERIC_SETTING_VAL(settings, "SPAWN_QUEUE_DEPTH", spawnQueueDepth, DFL_SPAWN_QUEUE_DEPTH, <, 0);
+    GET_NUMERIC_SETTING_VAL(settings, "SPAWN_WAIT_MS", spawnWaitMs, DFL_SPAWN_WAIT_MS, <, 0);
     GET_NUMERIC_SETTING_VAL(settings, "MAXMEMORY", maxMemory, DFL_MAXMEMORY, <=, 0);
     GET_NUMERIC_SETTING_VAL(settings, "MAXFILES", maxFiles, DFL_MAXFILES, <=, 0);
-    GET_NUMERIC_SETTING_VAL(settings, "REPL_ALG", replacment_algo, DFL_REPL_ALG, <, 0 || replacment_algo > 3);
+    GET_NUMERIC_SETTING_VAL(settings, "REPL_ALG", replacment_algo, DFL_REPL_ALG, <, 0 || replacment_algo >= N_POLICIES);
+    GET_NUMERIC_SETTING_VAL(settings, "MULTI_REACTOR", multiReactor, DFL_MULTI_REACTOR, <, 0 || multiReactor > 1);
+    GET_NUMERIC_SETTING_VAL(settings, "REACTOR_BALANCE", reactorBalance, DFL_REACTOR_BALANCE, <, 0 || reactorBalance > 1);
+    GET_NUMERIC_SETTING_VAL(settings, "IO_ENGINE", ioEngine, DFL_IO_ENGINE, <, IO_ENGINE_SYSCALL || ioEngine > IO_ENGINE_URING);
+    GET_NUMERIC_SETTING_VAL(settings, "HIGH_WATERMARK", highWatermark, DFL_HIGH_WATERMARK, <, 0 || highWatermark > 100);
+    GET_NUMERIC_SETTING_VAL(settings, "LOW_WATERMARK", lowWatermark, DFL_LOW_WATERMARK, <, 0 || (highWatermark && lowWatermark >= highWatermark));
     GET_SETTING_VAL(settings, "SOCKNAME", sockname, DFL_SOCKET);
     GET_SETTING_VAL(settings, "LOGS", logs_file, DFL_LOGS);
 
     freeSettingList(&settings);
 
-    // Creo la coda per comunicare con i thread worker
-    BQueue_t *client_fd_queue = NULL;
-    client_fd_queue = initBQueue(QUEUE_LEN);
-    if (!client_fd_queue)
-        exit(EXIT_FAILURE);
+    // Creo le code per comunicare con i thread worker, una per ogni worker del pool elastico (in modalita' multi-reactor
+    // ogni worker ha la propria istanza epoll e i client gli restano assegnati, quindi il numero di worker e' fisso)
+    Scheduler *scheduler = NULL;
+    if (multiReactor)
+        maxThreads = nThreads;
+    else
+    {
+        scheduler = initScheduler(nThreads, maxThreads, QUEUE_LEN, threadIdleMs);
+        if (!scheduler)
+            exit(EXIT_FAILURE);
+    }
 
-    // Creo la pipe con cui i thread worker comunicherranno con il manager
+    // Creo la pipe con cui i thread worker avvertiranno il manager dell'uscita di un client
     int workerManagerPipe[2];
     SYSCALL_EQ_ACTION(pipe, -1, exit(EXIT_FAILURE), workerManagerPipe);
     // Ignoro SIGPIPE
@@ -172,25 +276,71 @@ int main(int argc, char const *argv[])
 
     CHECK_PTHREAD_AND_ACTION(pthread_create, !=, 0, exit(EXIT_FAILURE), &logger, NULL, &writeLogToFile, (void *)&logger_args);
 
+    // Se richiesto creo il thread che espelle i file in background sopra la soglia alta
+    pthread_t evictor;
+
+    if (highWatermark)
+    {
+        SYSCALL_EQ_ACTION(setWatermarks, -1, exit(EXIT_FAILURE), fs, highWatermark, lowWatermark);
+        CHECK_PTHREAD_AND_ACTION(pthread_create, !=, 0, exit(EXIT_FAILURE), &evictor, NULL, &evictInBackground, (void *)fs);
+    }
+
+    // Creo l'istanza epoll del manager: in modalita' condivisa vi registra i client e i worker li riarmano direttamente,
+    // in modalita' multi-reactor contiene solo la socket del server e la pipe con i worker
+    int epoll_fd;
+    SYSCALL_RET_EQ_ACTION(epoll_create1, -1, epoll_fd, exit(EXIT_FAILURE), 0);
+
+    // In modalita' multi-reactor mi serve sapere a quale istanza epoll e' assegnato ogni client per poterlo riarmare
+    long maxFds = 0;
+    int *fd_owner = NULL;
+    size_t nextReactor = 0;
+
+    if (multiReactor)
+    {
+        SYSCALL_RET_EQ_ACTION(sysconf, -1, maxFds, exit(EXIT_FAILURE), _SC_OPEN_MAX);
+        CHECK_RET_AND_ACTION(calloc, ==, NULL, fd_owner, perror("calloc"); exit(EXIT_FAILURE), maxFds, sizeof(int));
+    }
+
     // Passo i riferimenti alla struttura per gli argomenti dei thread
-    ThreadArgs *th_args = malloc(sizeof(*th_args));
+    ThreadArgs *th_args = calloc(maxThreads, sizeof(*th_args));
 
     if (!th_args)
         exit(EXIT_FAILURE);
 
-    th_args->queue = client_fd_queue;
-    th_args->write_end_pipe_fd = workerManagerPipe[1];
-    th_args->fs = fs;
+    for (size_t i = 0; i < maxThreads; i++)
+    {
+        th_args[i].scheduler = scheduler;
+        th_args[i].id = i;
+        th_args[i].write_end_pipe_fd = workerManagerPipe[1];
+        th_args[i].fs = fs;
+        th_args[i].epoll_fd = epoll_fd;
+        th_args[i].io_engine = ioEngine;
+
+        if (multiReactor)
+        {
+            th_args[i].fd_owner = fd_owner;
+            SYSCALL_RET_EQ_ACTION(epoll_create1, -1, th_args[i].epoll_fd, exit(EXIT_FAILURE), 0);
+            SYSCALL_RET_EQ_ACTION(eventfd, -1, th_args[i].stop_fd, exit(EXIT_FAILURE), 0, 0);
+            SYSCALL_EQ_ACTION(addFd, -1, exit(EXIT_FAILURE), th_args[i].epoll_fd, th_args[i].stop_fd, 0);
+        }
+    }
 
     // Alloco i threads e invoco la loro routine
-    pthread_t *workers = calloc(nThreads, sizeof(pthread_t));
+    pthread_t *workers = calloc(maxThreads, sizeof(pthread_t));
+    char *started = calloc(maxThreads, sizeof(char));
 
-    if (!workers)
+    if (!workers || !started)
         exit(EXIT_FAILURE);
 
     for (int i = 0; i < nThreads; i++)
     {
-        CHECK_PTHREAD_AND_ACTION(pthread_create, !=, 0, exit(EXIT_FAILURE), &workers[i], NULL, &processRequest, (void *)th_args);
+        if (multiReactor)
+        {
+            CHECK_PTHREAD_AND_ACTION(pthread_create, !=, 0, exit(EXIT_FAILURE), &workers[i], NULL, &processReactorRequests, (void *)&th_args[i]);
+            started[i] = 1;
+        }
+        else
+            SYSCALL_EQ_ACTION(spawnWorker, -1, exit(EXIT_FAILURE), scheduler, th_args, workers, started, &mask);
     }
 
     if (pthread_sigmask(SIG_UNBLOCK, &mask, NULL) != 0)
@@ -202,19 +352,19 @@ int main(int argc, char const *argv[])
     strncpy(server_addr.sun_path, sockname, UNIX_PATH_MAX);
     server_addr.sun_family = AF_UNIX;
 
-    // Fd del server e fd massima per la select
-    int listen_fd, fd_max = 0;
+    // Fd del server
+    int listen_fd, nready;
 
-    fd_set master_set, working_set;
+    struct epoll_event events[MAX_EVENTS];
+    void *readyClients[MAX_EVENTS]; // client pronti in un giro di epoll_wait, distribuiti ai worker insieme
+    size_t nReadyClients;
 
     // Creo la socket del server
     SYSCALL_RET_EQ_ACTION(socket, -1, listen_fd, exit(EXIT_FAILURE), AF_UNIX, SOCK_STREAM, 0);
 
-    // Inizializzo il master_set e imposto i fd per la select, calcolando l'fd più alto
-    FD_ZERO(&master_set);
-    FD_SET(listen_fd, &master_set);
-    FD_SET(workerManagerPipe[0], &master_set);
-    fd_max = MAX(listen_fd, workerManagerPipe[0]);
+    // Registro la socket del server e la pipe con i worker (level-triggered)
+    SYSCALL_EQ_ACTION(addFd, -1, exit(EXIT_FAILURE), epoll_fd, listen_fd, 0);
+    SYSCALL_EQ_ACTION(addFd, -1, exit(EXIT_FAILURE), epoll_fd, workerManagerPipe[0], 0);
 
     // Eseguo la bind del socket con l'indirizzo del server e mi metto in ascolto di richieste di connessione
     SYSCALL_EQ_ACTION(bind, -1, exit(EXIT_FAILURE), listen_fd, (const struct sockaddr *)&server_addr, sizeof(server_addr));
@@ -222,11 +372,7 @@ int main(int argc, char const *argv[])
 
     while (!hardQuit)
     {
-
-        // copio il master fd_set sul working fd_set
-        memcpy(&working_set, &master_set, sizeof(master_set));
-
-        if (select(fd_max + 1, &working_set, NULL, NULL, NULL) == -1)
+        if ((nready = epoll_wait(epoll_fd, events, MAX_EVENTS, -1)) == -1)
         {
             // Se ricevo un interruzione esco dal ciclo subito se: non ci sono client connessi e ho ricevuto SIGHUP, ho ricevuto SIGINT o SIGQUIT
             if (errno == EINTR)
@@ -236,82 +382,123 @@ int main(int argc, char const *argv[])
 
                 continue;
             }
-            perror("select");
+            perror("epoll_wait");
             exit(EXIT_FAILURE);
         }
 
-        for (int fd = 0; fd <= fd_max; fd++)
+        nReadyClients = 0;
+
+        // Scorro solo gli fd effettivamente pronti
+        for (int i = 0; i < nready; i++)
         {
+            int fd = events[i].data.fd;
 
-            if (FD_ISSET(fd, &working_set))
+            if (fd == listen_fd) // richiesta di connessione
             {
-                if (fd == listen_fd) // richiesta di connessione
+                int fd_client;
+                SYSCALL_RET_EQ_ACTION(accept, -1, fd_client, continue, listen_fd, NULL, 0);
+
+                if (softQuit)
                 {
-                    int fd_client;
-                    SYSCALL_RET_EQ_ACTION(accept, -1, fd_client, continue, listen_fd, NULL, 0);
+                    SYSCALL_EQ_ACTION(close, -1, exit(EXIT_FAILURE), fd_client);
+                    continue;
+                }
 
-                    if (softQuit)
+                if (multiReactor)
+                {
+                    if (fd_client >= maxFds)
                     {
                         SYSCALL_EQ_ACTION(close, -1, exit(EXIT_FAILURE), fd_client);
                         continue;
                     }
 
-                    FD_SET(fd_client, &master_set);
-                    fd_max = MAX(fd_max, fd_client);
+                    // Assegno il client a un worker: da ora in poi le sue richieste verranno servite solo da quest'ultimo
+                    ThreadArgs *reactor = chooseReactor(th_args, nThreads, reactorBalance, &nextReactor);
 
-                    conClients++;
-                    maxConClients = MAX(maxConClients, conClients);
+                    fd_owner[fd_client] = reactor->epoll_fd;
+                    __atomic_add_fetch(&(reactor->nClients), 1, __ATOMIC_RELAXED);
 
-                    continue;
+                    SYSCALL_EQ_ACTION(addFd, -1, exit(EXIT_FAILURE), reactor->epoll_fd, fd_client, 1);
                 }
-
-                if (fd == workerManagerPipe[0]) // messaggio da un thread worker
+                else
                 {
-                    int fd_sent_from_worker;
+                    SYSCALL_EQ_ACTION(addFd, -1, exit(EXIT_FAILURE), epoll_fd, fd_client, 1);
+                }
 
-                    CHECK_AND_ACTION(readn, ==, -1, perror("readn"); exit(EXIT_FAILURE), workerManagerPipe[0], &fd_sent_from_worker, sizeof(int));
+                conClients++;
+                maxConClients = MAX(maxConClients, conClients);
 
-                    if (fd_sent_from_worker == 0) // un client e' uscito
-                    {
-                        if (--conClients == 0 && softQuit)
-                            goto shutdown;
+                continue;
+            }
 
-                        continue;
-                    }
+            if (fd == workerManagerPipe[0]) // messaggio da un thread worker
+            {
+                int fd_sent_from_worker;
 
-                    FD_SET(fd_sent_from_worker, &master_set);
-                    fd_max = MAX(fd_max, fd_sent_from_worker);
-                    continue;
-                }
+                // I worker riarmano da soli i client: sulla pipe arrivano solo le notifiche di uscita di un client
+                CHECK_AND_ACTION(readn, ==, -1, perror("readn"); exit(EXIT_FAILURE), workerManagerPipe[0], &fd_sent_from_worker, sizeof(int));
 
-                // Un fd di un client già connesso è pronto per la lettura, quindi lo elimino dal master fd_set e lo spedisco ai thread worker
-                FD_CLR(fd, &master_set);
+                conClients--;
 
-                if (fd == fd_max)
-                    fd_max = updatemax(master_set, fd_max);
+                continue;
+            }
 
-                int *client_fd;
-                CHECK_RET_AND_ACTION(malloc, ==, NULL, client_fd, perror("malloc"); exit(EXIT_FAILURE), sizeof(fd));
-                memcpy(client_fd, &fd, sizeof(fd));
+            // Un fd di un client già connesso è pronto per la lettura: con EPOLLONESHOT e' gia' disabilitato, quindi lo spedisco ai thread worker
+            // che lo riarmeranno al termine della richiesta
+            ClientRequest *request;
+            CHECK_RET_AND_ACTION(slabAlloc, ==, NULL, request, perror("slabAlloc"); exit(EXIT_FAILURE), &requestCache);
+            request->fd = fd;
+            request->queuedAt = schedulerNow();
 
-                CHECK_AND_ACTION(push, ==, -1, perror("push"); exit(EXIT_FAILURE), client_fd_queue, client_fd);
-            }
+            readyClients[nReadyClients++] = request;
+        }
+
+        if (nReadyClients > 0)
+        {
+            CHECK_AND_ACTION(schedulerDispatch, ==, -1, perror("schedulerDispatch"); exit(EXIT_FAILURE), scheduler, readyClients, nReadyClients);
+
+            // Se i client si accodano o aspettano troppo aggiungo un worker al pool (al piu' uno per giro)
+            if (schedulerOverloaded(scheduler, spawnQueueDepth, spawnWaitMs))
+                spawnWorker(scheduler, th_args, workers, started, &mask);
         }
+
+        // Chiudo il server dopo aver spedito ai worker i client pronti
+        if (conClients == 0 && softQuit)
+            break;
     }
 
-shutdown:
     printf("\nChiudendo il server\n");
     // Mando segnale di terminazione ai thread worker
-    for (int i = 0; i < nThreads; i++)
-        push(client_fd_queue, EOS);
+    if (multiReactor)
+    {
+        for (int i = 0; i < nThreads; i++)
+        {
+            SYSCALL_EQ_ACTION(eventfd_write, -1, exit(EXIT_FAILURE), th_args[i].stop_fd, 1);
+        }
+    }
+    else
+    {
+        CHECK_AND_ACTION(schedulerBroadcast, ==, -1, perror("schedulerBroadcast"); exit(EXIT_FAILURE), scheduler, EOS);
+    }
 
-    // E attendo la loro effettiva terminazione
-    for (size_t i = 0; i < nThreads; i++)
+    // E attendo la loro effettiva terminazione, compresi i worker del pool gia' terminati per inattivita'
+    for (size_t i = 0; i < maxThreads; i++)
     {
-        CHECK_PTHREAD_AND_ACTION(pthread_join, !=, 0, exit(EXIT_FAILURE), workers[i], NULL);
+        if (started[i])
+        {
+            CHECK_PTHREAD_AND_ACTION(pthread_join, !=, 0, exit(EXIT_FAILURE), workers[i], NULL);
+        }
+    }
+
+    // Termino il thread di espulsione prima del logger, a cui invia i file espulsi
+    if (highWatermark)
+    {
+        stopBackgroundEviction(fs);
+        CHECK_PTHREAD_AND_ACTION(pthread_join, !=, 0, exit(EXIT_FAILURE), evictor, NULL);
     }
 
     SYSCALL_EQ_ACTION(close, -1, exit(EXIT_FAILURE), listen_fd);
+    SYSCALL_EQ_ACTION(close, -1, exit(EXIT_FAILURE), epoll_fd);
 
     logOperation(fs->logger_msg_queue, "absMaxMemory", "", listen_fd, fs->absMaxMemory);
     logOperation(fs->logger_msg_queue, "absMaxFiles", "", listen_fd, fs->absMaxFiles);
@@ -320,7 +507,7 @@ shutdown:
     // Mando messaggio di terminazione al thread logger
     char *stopMsg = calloc(strlen(STOP_MSG) + 1, sizeof(char));
     strncpy(stopMsg, STOP_MSG, strlen(STOP_MSG) + 1);
-    CHECK_AND_ACTION(push, ==, -1, perror("push"); exit(EXIT_FAILURE), fs->logger_msg_queue, stopMsg);
+    CHECK_AND_ACTION(mpmcPush, ==, -1, perror("mpmcPush"); exit(EXIT_FAILURE), fs->logger_msg_queue, stopMsg);
 
     // E attendo la sua effettiva terminazione
     CHECK_PTHREAD_AND_ACTION(pthread_join, !=, 0, exit(EXIT_FAILURE), logger, NULL);
@@ -329,13 +516,31 @@ shutdown:
     SYSCALL_EQ_ACTION(close, -1, exit(EXIT_FAILURE), workerManagerPipe[0]);
     SYSCALL_EQ_ACTION(close, -1, exit(EXIT_FAILURE), workerManagerPipe[1]);
 
+    if (multiReactor)
+    {
+        for (size_t i = 0; i < nThreads; i++)
+        {
+            SYSCALL_EQ_ACTION(close, -1, exit(EXIT_FAILURE), th_args[i].stop_fd);
+            SYSCALL_EQ_ACTION(close, -1, exit(EXIT_FAILURE), th_args[i].epoll_fd);
+        }
+
+        free(fd_owner);
+    }
+
     free(workers);
+    free(started);
     free(th_args);
-    deleteBQueue(client_fd_queue, NULL);
 
     FILESYSTEM_STATS(fs->absMaxFiles, fs->absMaxMemory, fs->evictedFiles);
+    EVICTION_STATS(fs->evictedBytes, fs->rejectedWrites, fs->readHits, fs->readMisses);
+    BACKGROUND_EVICTION_STATS(fs->backgroundEvictions, fs->syncEvictions);
+    printPolicyStats(fs);
+    schedulerPrintStats(scheduler, stdout);
+    deleteScheduler(scheduler, NULL);
+    slabPrintStats();
     // stampo i contenuti del filesystem e lo elimino
     printFileSystem(fs);
     deleteFileSystem(fs);
+    slabCleanup();
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,138 @@
+#include "../include/define_source.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../include/session.h"
+
+SessionTable *initSessionTable(void)
+{
+    SessionTable *table;
+    long maxFds;
+
+    if ((maxFds = sysconf(_SC_OPEN_MAX)) <= 0)
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    if (!(table = malloc(sizeof(*table))))
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    if (!(table->sessions = calloc((size_t)maxFds, sizeof(ClientSession *))))
+    {
+        free(table);
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    table->size = (size_t)maxFds;
+
+    return table;
+}
+
+int sessionAdd(SessionTable *table, int fd, const char *path, size_t len, uint64_t hash)
+{
+    ClientSession *session;
+    char *key;
+
+    if (!table || fd < 0 || (size_t)fd >= table->size || !path)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (!(session = table->sessions[fd]))
+    {
+        if (!(session = calloc(1, sizeof(*session))))
+        {
+            errno = ENOMEM;
+            return -1;
+        }
+
+        if (!(session->paths = icl_hash_create(SESSION_BUCKETS, NULL, NULL)))
+        {
+            free(session);
+            errno = ENOMEM;
+            return -1;
+        }
+
+        table->sessions[fd] = session;
+    }
+
+    if (icl_hash_find_hashed(session->paths, (void *)path, len, hash))
+        return 0;
+
+    if (!(key = malloc(len + 1)))
+    {
+        session->incomplete = 1;
+        errno = ENOMEM;
+        return -1;
+    }
+
+    memcpy(key, path, len + 1);
+
+    if (!icl_hash_insert_hashed(session->paths, key, len, hash, key))
+    {
+        free(key);
+        session->incomplete = 1;
+        errno = ENOMEM;
+        return -1;
+    }
+
+    return 0;
+}
+
+void sessionRemove(SessionTable *table, int fd, const char *path, size_t len, uint64_t hash)
+{
+    if (!table || fd < 0 || (size_t)fd >= table->size || !path || !table->sessions[fd])
+        return;
+
+    icl_hash_delete_hashed(table->sessions[fd]->paths, (void *)path, len, hash, &free, NULL);
+}
+
+ClientSession *detachSession(SessionTable *table, int fd, int *complete)
+{
+    ClientSession *session;
+
+    if (!table || fd < 0 || (size_t)fd >= table->size)
+    {
+        *complete = 0;
+        return NULL;
+    }
+
+    session = table->sessions[fd];
+    table->sessions[fd] = NULL;
+
+    *complete = !session || !session->incomplete;
+
+    return session;
+}
+
+void deleteSession(ClientSession *session)
+{
+    if (!session)
+        return;
+
+    icl_hash_destroy(session->paths, &free, NULL);
+    free(session);
+}
+
+void deleteSessionTable(SessionTable *table)
+{
+    size_t i;
+
+    if (!table)
+        return;
+
+    for (i = 0; i < table->size; i++)
+        deleteSession(table->sessions[i]);
+
+    free(table->sessions);
+    free(table);
+}
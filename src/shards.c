@@ -0,0 +1,263 @@
+#include "../include/define_source.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/mutex.h"
+#include "../include/shards.h"
+#include "../include/utils.h"
+
+#define SHARDS_TABLE_SIZE (2 * SHARDS_MAX_SAMPLES) // potenza di 2, la tabella resta piena al piu' per meta'
+#define SHARDS_SLOTS (2 * SHARDS_MAX_SAMPLES)      // istanti tra due compattazioni
+
+/**
+ * @brief Ritorna 1 se il path con hash 'hash' fa parte del campione con soglia 'threshold'.
+ */
+static int isSampled(uint64_t hash, uint64_t threshold)
+{
+    return (hash & (SHARDS_MODULUS - 1)) < threshold;
+}
+
+/**
+ * @brief Somma 'delta' (con segno, in complemento a 2) alla dimensione registrata nell'istante 'slot'.
+ */
+static void treeAdd(Shards *shards, size_t slot, size_t delta)
+{
+    for (slot++; slot <= SHARDS_SLOTS; slot += slot & -slot)
+        shards->tree[slot - 1] += delta;
+}
+
+/**
+ * @brief Ritorna la somma delle dimensioni registrate negli istanti precedenti a 'slot'.
+ */
+static size_t treeSum(Shards *shards, size_t slot)
+{
+    size_t sum = 0;
+
+    for (; slot > 0; slot -= slot & -slot)
+        sum += shards->tree[slot - 1];
+
+    return sum;
+}
+
+/**
+ * @brief Ritorna la posizione della tabella che contiene il path con hash 'hash' o la posizione libera in cui inserirlo
+ *  (probing lineare sui bit alti, i bit bassi decidono il campionamento).
+ */
+static ShardsSample *findSample(Shards *shards, uint64_t hash)
+{
+    size_t i = (size_t)(hash >> 32) & (SHARDS_TABLE_SIZE - 1);
+
+    while (shards->samples[i].key && shards->samples[i].key != hash)
+        i = (i + 1) & (SHARDS_TABLE_SIZE - 1);
+
+    return &(shards->samples[i]);
+}
+
+static int compareSlots(const void *a, const void *b)
+{
+    const ShardsSample *x = a, *y = b;
+
+    return (x->slot > y->slot) - (x->slot < y->slot);
+}
+
+/**
+ * @brief Rinumera gli istanti dei path campionati in ordine di accesso a partire da 0, dimenticando quelli che non
+ *  rispettano piu' la soglia, e ricostruisce tabella e Fenwick tree.
+ */
+static void compactSamples(Shards *shards)
+{
+    ShardsSample *scratch = shards->scratch;
+    size_t i,
+        n = 0;
+
+    for (i = 0; i < SHARDS_TABLE_SIZE; i++)
+    {
+        if (shards->samples[i].key && isSampled(shards->samples[i].key, shards->threshold))
+            scratch[n++] = shards->samples[i];
+    }
+
+    qsort(scratch, n, sizeof(ShardsSample), compareSlots);
+
+    memset(shards->samples, 0, SHARDS_TABLE_SIZE * sizeof(ShardsSample));
+    memset(shards->tree, 0, SHARDS_SLOTS * sizeof(size_t));
+
+    for (i = 0; i < n; i++)
+    {
+        ShardsSample *sample = findSample(shards, scratch[i].key);
+
+        *sample = scratch[i];
+        sample->slot = i;
+        treeAdd(shards, i, sample->size);
+    }
+
+    shards->nSamples = n;
+    shards->nextSlot = n;
+}
+
+Shards *initShards(size_t maxCache)
+{
+    Shards *shards;
+    int errnum;
+
+    if (maxCache < SHARDS_BINS_PER_CACHE)
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    if (!(shards = calloc(1, sizeof(*shards))))
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    shards->samples = calloc(SHARDS_TABLE_SIZE, sizeof(ShardsSample));
+    shards->scratch = calloc(SHARDS_MAX_SAMPLES, sizeof(ShardsSample));
+    shards->tree = calloc(SHARDS_SLOTS, sizeof(size_t));
+
+    if (!shards->samples || !shards->scratch || !shards->tree)
+    {
+        free(shards->samples);
+        free(shards->scratch);
+        free(shards->tree);
+        free(shards);
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    if ((errnum = pthread_mutex_init(&(shards->lock), NULL)) != 0)
+    {
+        free(shards->samples);
+        free(shards->scratch);
+        free(shards->tree);
+        free(shards);
+        errno = errnum;
+        return NULL;
+    }
+
+    shards->threshold = SHARDS_MODULUS / SHARDS_INITIAL_RATE;
+    shards->binSize = maxCache / SHARDS_BINS_PER_CACHE;
+
+    return shards;
+}
+
+void shardsAccess(Shards *shards, uint64_t hash, size_t size)
+{
+    ShardsSample *sample;
+    double weight,
+        distance;
+    size_t bin;
+
+    if (!shards)
+        return;
+
+    // 0 indica una posizione libera della tabella
+    hash = hash ? hash : 1;
+
+    if (!isSampled(hash, __atomic_load_n(&(shards->threshold), __ATOMIC_RELAXED)))
+        return;
+
+    LOCK(&(shards->lock));
+
+    sample = findSample(shards, hash);
+
+    // primo accesso ad un path campionato: se la tabella e' piena dimezzo la soglia, il path potrebbe non farne piu' parte
+    if (!sample->key && shards->nSamples >= SHARDS_MAX_SAMPLES && shards->threshold > 1)
+    {
+        __atomic_store_n(&(shards->threshold), shards->threshold / 2, __ATOMIC_RELAXED);
+        compactSamples(shards);
+        sample = findSample(shards, hash);
+    }
+
+    if (!isSampled(hash, shards->threshold) || (!sample->key && shards->nSamples >= SHARDS_MAX_SAMPLES))
+    {
+        UNLOCK(&(shards->lock));
+        return;
+    }
+
+    // ogni accesso campionato rappresenta 1/R accessi del carico
+    weight = (double)SHARDS_MODULUS / shards->threshold;
+
+    if (sample->key)
+    {
+        // bytes dei path campionati acceduti dopo l'ultimo accesso a questo, riportati all'intero carico
+        distance = (double)(treeSum(shards, shards->nextSlot) - treeSum(shards, sample->slot + 1)) * weight + size;
+        bin = distance > 0 ? (size_t)((distance - 1) / shards->binSize) : 0;
+
+        if (bin < SHARDS_BINS)
+            shards->hist[bin] += weight;
+        else
+            shards->far += weight;
+
+        treeAdd(shards, sample->slot, -sample->size);
+    }
+    else
+    {
+        sample->key = hash;
+        shards->nSamples++;
+        shards->far += weight;
+    }
+
+    sample->size = 0;
+
+    shards->total += weight;
+    shards->sampled++;
+
+    if (shards->nextSlot == SHARDS_SLOTS)
+    {
+        compactSamples(shards);
+        sample = findSample(shards, hash);
+    }
+
+    sample->slot = shards->nextSlot++;
+    sample->size = size;
+    treeAdd(shards, sample->slot, size);
+
+    UNLOCK(&(shards->lock));
+}
+
+void shardsPrint(Shards *shards, FILE *out)
+{
+    double hits = 0;
+    int i;
+
+    if (!shards || !out)
+        return;
+
+    LOCK(&(shards->lock));
+
+    fprintf(out, "Curva dei miss ratio stimata per una cache LRU (SHARDS, campionamento 1/%.0f, %zu accessi campionati)\n",
+            (double)SHARDS_MODULUS / shards->threshold, shards->sampled);
+
+    if (shards->total == 0)
+    {
+        fprintf(out, "Nessun accesso campionato\n");
+        UNLOCK(&(shards->lock));
+        return;
+    }
+
+    for (i = 0; i < SHARDS_BINS; i++)
+    {
+        hits += shards->hist[i];
+
+        fprintf(out, "%12.2f MB: %6.2f%%\n", (double)(i + 1) * shards->binSize / (1000 * 1000),
+                100.0 * (1 - hits / shards->total));
+    }
+
+    UNLOCK(&(shards->lock));
+}
+
+void deleteShards(Shards *shards)
+{
+    if (!shards)
+        return;
+
+    CHECK_PTHREAD_AND_ACTION(pthread_mutex_destroy, !=, 0, ;, &(shards->lock));
+
+    free(shards->samples);
+    free(shards->scratch);
+    free(shards->tree);
+    free(shards);
+}
@@ -0,0 +1,142 @@
+#include "../include/define_source.h"
+
+#include <errno.h>
+#include <stdlib.h>
+
+#include "../include/sketch.h"
+
+#define SKETCH_MIN_WIDTH 16
+
+/**
+ * @brief Hash a 64 bit del path 'key' (FNV-1a seguito dal finalizzatore di MurmurHash3 per distribuire anche i bit bassi).
+ */
+static uint64_t sketchHash(const char *key)
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+
+    for (; *key; key++)
+    {
+        hash ^= (unsigned char)*key;
+        hash *= 0x100000001b3ULL;
+    }
+
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+
+    return hash;
+}
+
+/**
+ * @brief Ritorna l'indice del contatore del path con hash 'hash' nella riga 'row' (double hashing).
+ */
+static size_t sketchIndex(FreqSketch *sketch, uint64_t hash, int row)
+{
+    uint64_t step = (hash >> 32) | 1;
+
+    return row * sketch->width + ((hash + row * step) & (sketch->width - 1));
+}
+
+/**
+ * @brief Dimezza tutti i contatori dello sketch 'sketch'.
+ */
+static void sketchAge(FreqSketch *sketch)
+{
+    size_t i;
+
+    for (i = 0; i < SKETCH_DEPTH * sketch->width; i++)
+        sketch->counters[i] >>= 1;
+
+    sketch->additions /= 2;
+}
+
+FreqSketch *initSketch(size_t capacity)
+{
+    FreqSketch *sketch;
+    size_t width = SKETCH_MIN_WIDTH;
+
+    while (width < capacity)
+        width <<= 1;
+
+    if (!(sketch = malloc(sizeof(*sketch))))
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    if (!(sketch->counters = calloc(SKETCH_DEPTH * width, sizeof(uint8_t))))
+    {
+        free(sketch);
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    sketch->width = width;
+    sketch->additions = 0;
+    sketch->sampleSize = SKETCH_SAMPLE_FACTOR * width;
+
+    return sketch;
+}
+
+void sketchIncrement(FreqSketch *sketch, const char *key)
+{
+    uint64_t hash;
+    size_t index[SKETCH_DEPTH];
+    uint8_t min = SKETCH_MAX_COUNT;
+    int row;
+
+    if (!sketch || !key)
+        return;
+
+    hash = sketchHash(key);
+
+    for (row = 0; row < SKETCH_DEPTH; row++)
+    {
+        index[row] = sketchIndex(sketch, hash, row);
+
+        if (sketch->counters[index[row]] < min)
+            min = sketch->counters[index[row]];
+    }
+
+    if (min == SKETCH_MAX_COUNT)
+        return;
+
+    // conservative update: incremento solo i contatori minimi, gli altri sovrastimano gia' la frequenza
+    for (row = 0; row < SKETCH_DEPTH; row++)
+    {
+        if (sketch->counters[index[row]] == min)
+            sketch->counters[index[row]]++;
+    }
+
+    if (++sketch->additions >= sketch->sampleSize)
+        sketchAge(sketch);
+}
+
+unsigned int sketchFrequency(FreqSketch *sketch, const char *key)
+{
+    uint64_t hash;
+    uint8_t min = SKETCH_MAX_COUNT;
+    int row;
+
+    if (!sketch || !key)
+        return 0;
+
+    hash = sketchHash(key);
+
+    for (row = 0; row < SKETCH_DEPTH; row++)
+    {
+        if (sketch->counters[sketchIndex(sketch, hash, row)] < min)
+            min = sketch->counters[sketchIndex(sketch, hash, row)];
+    }
+
+    return min;
+}
+
+void deleteSketch(FreqSketch *sketch)
+{
+    if (!sketch)
+        return;
+
+    free(sketch->counters);
+    free(sketch);
+}
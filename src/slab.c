@@ -0,0 +1,401 @@
+#include "../include/define_source.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/mutex.h"
+#include "../include/slab.h"
+
+#define SLAB_ALIGN 16
+#define ALIGN_UP(size) (((size) + SLAB_ALIGN - 1) & ~((size_t)SLAB_ALIGN - 1))
+
+typedef struct slabObj
+{
+    struct slabObj *next;
+} SlabObj;
+
+/** Intestazione di un blocco: essendo i blocchi allineati a SLAB_BLOCK_SIZE, la cache di un oggetto si ricava dal suo indirizzo.
+ *
+ */
+typedef struct slabBlock
+{
+    SlabCache *cache;
+    struct slabBlock *next;
+} SlabBlock;
+
+#define BLOCK_HEADER ALIGN_UP(sizeof(SlabBlock))
+#define BLOCK_OF(obj) ((SlabBlock *)((uintptr_t)(obj) & ~((uintptr_t)SLAB_BLOCK_SIZE - 1)))
+
+typedef struct slabLocal
+{
+    SlabCache *cache;
+    SlabObj *free;
+    size_t nFree;
+    size_t allocs; // scritti solo dal thread proprietario, letti con __atomic_load_n da slabGetStats
+    size_t frees;
+    struct slabLocal *prev;
+    struct slabLocal *next;
+} SlabLocal;
+
+static pthread_mutex_t registryLock = PTHREAD_MUTEX_INITIALIZER;
+static SlabCache *caches = NULL;
+
+/**
+ * @brief Restituisce al deposito la cache locale di un thread terminato.
+ */
+static void releaseLocal(void *localPtr)
+{
+    SlabLocal *local = (SlabLocal *)localPtr;
+    SlabCache *cache = local->cache;
+    SlabObj *last;
+
+    LOCK(&(cache->lock));
+
+    if (local->free)
+    {
+        for (last = local->free; last->next; last = last->next)
+            ;
+
+        last->next = cache->depot;
+        cache->depot = local->free;
+        cache->nDepot += local->nFree;
+    }
+
+    cache->allocs += local->allocs;
+    cache->frees += local->frees;
+
+    if (local->prev)
+        local->prev->next = local->next;
+    else
+        cache->locals = local->next;
+
+    if (local->next)
+        local->next->prev = local->prev;
+
+    UNLOCK(&(cache->lock));
+
+    free(local);
+}
+
+/**
+ * @brief Inizializza la cache 'cache' al primo uso.
+ *
+ * @return 0 se successo, -1 altrimenti e errno settato
+ */
+static int initCache(SlabCache *cache)
+{
+    int err = 0;
+
+    if (__atomic_load_n(&(cache->ready), __ATOMIC_ACQUIRE))
+        return 0;
+
+    // stesso ordine di slabPrintStats: prima il registro, poi la cache
+    LOCK(&registryLock);
+    LOCK(&(cache->lock));
+
+    if (!cache->ready)
+    {
+        if (cache->objSize == 0 || ALIGN_UP(cache->objSize) > SLAB_BLOCK_SIZE - BLOCK_HEADER)
+            err = EINVAL;
+        else if (pthread_key_create(&(cache->localKey), &releaseLocal) != 0)
+            err = EAGAIN;
+        else
+        {
+            if (cache->objSize < sizeof(SlabObj))
+                cache->objSize = sizeof(SlabObj);
+
+            cache->objSize = ALIGN_UP(cache->objSize);
+
+            cache->next = caches;
+            caches = cache;
+
+            __atomic_store_n(&(cache->ready), 1, __ATOMIC_RELEASE);
+        }
+    }
+
+    UNLOCK(&(cache->lock));
+    UNLOCK(&registryLock);
+
+    if (err)
+    {
+        errno = err;
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Ritorna la cache locale del thread chiamante per 'cache', creandola alla prima chiamata.
+ *
+ * \retval NULL se non e' stato possibile allocarla (errno settato)
+ */
+static SlabLocal *getLocal(SlabCache *cache)
+{
+    SlabLocal *local;
+
+    if ((local = (SlabLocal *)pthread_getspecific(cache->localKey)))
+        return local;
+
+    if (!(local = calloc(1, sizeof(*local))))
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    local->cache = cache;
+
+    if (pthread_setspecific(cache->localKey, local) != 0)
+    {
+        free(local);
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    LOCK(&(cache->lock));
+
+    local->next = cache->locals;
+    if (cache->locals)
+        cache->locals->prev = local;
+    cache->locals = local;
+
+    UNLOCK(&(cache->lock));
+
+    return local;
+}
+
+/**
+ * @brief Riempie la cache locale 'local' con un lotto del deposito. Se il deposito e' vuoto lo riempie prima con gli oggetti
+ * di un nuovo blocco, cosi' anche gli altri thread possono usarli.
+ *
+ * @return 0 se successo, -1 altrimenti e errno settato
+ */
+static int refillLocal(SlabCache *cache, SlabLocal *local)
+{
+    SlabBlock *block;
+    SlabObj *obj;
+    char *curr;
+    size_t n;
+
+    LOCK(&(cache->lock));
+
+    if (!cache->depot)
+    {
+        if (posix_memalign((void **)&block, SLAB_BLOCK_SIZE, SLAB_BLOCK_SIZE) != 0)
+        {
+            UNLOCK(&(cache->lock));
+            errno = ENOMEM;
+            return -1;
+        }
+
+        block->cache = cache;
+        block->next = cache->blocks;
+        cache->blocks = block;
+        cache->nBlocks++;
+
+        for (curr = (char *)block + BLOCK_HEADER; curr + cache->objSize <= (char *)block + SLAB_BLOCK_SIZE; curr += cache->objSize)
+        {
+            obj = (SlabObj *)curr;
+            obj->next = cache->depot;
+            cache->depot = obj;
+            cache->nDepot++;
+        }
+    }
+
+    for (n = 0; n < SLAB_BATCH && cache->depot; n++)
+    {
+        obj = cache->depot;
+        cache->depot = obj->next;
+
+        obj->next = local->free;
+        local->free = obj;
+    }
+
+    cache->nDepot -= n;
+    local->nFree += n;
+
+    UNLOCK(&(cache->lock));
+
+    return 0;
+}
+
+/**
+ * @brief Restituisce al deposito un lotto degli oggetti liberi della cache locale 'local'.
+ */
+static void flushLocal(SlabCache *cache, SlabLocal *local)
+{
+    SlabObj *first = local->free,
+            *last = local->free;
+    size_t n;
+
+    for (n = 1; n < SLAB_BATCH && last->next; n++)
+        last = last->next;
+
+    local->free = last->next;
+    local->nFree -= n;
+
+    LOCK(&(cache->lock));
+
+    last->next = cache->depot;
+    cache->depot = first;
+    cache->nDepot += n;
+
+    UNLOCK(&(cache->lock));
+}
+
+void *slabAlloc(SlabCache *cache)
+{
+    SlabLocal *local;
+    SlabObj *obj;
+
+    if (!cache)
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    if (initCache(cache) == -1 || !(local = getLocal(cache)))
+        return NULL;
+
+    if (!local->free && refillLocal(cache, local) == -1)
+        return NULL;
+
+    obj = local->free;
+    local->free = obj->next;
+    local->nFree--;
+
+    __atomic_store_n(&(local->allocs), local->allocs + 1, __ATOMIC_RELAXED);
+
+    return obj;
+}
+
+void slabFree(void *obj)
+{
+    SlabCache *cache;
+    SlabLocal *local;
+
+    if (!obj)
+        return;
+
+    cache = BLOCK_OF(obj)->cache;
+
+    if (!(local = getLocal(cache)))
+    {
+        // senza cache locale restituisco l'oggetto direttamente al deposito
+        LOCK(&(cache->lock));
+        ((SlabObj *)obj)->next = cache->depot;
+        cache->depot = obj;
+        cache->nDepot++;
+        cache->frees++;
+        UNLOCK(&(cache->lock));
+        return;
+    }
+
+    ((SlabObj *)obj)->next = local->free;
+    local->free = obj;
+    local->nFree++;
+
+    __atomic_store_n(&(local->frees), local->frees + 1, __ATOMIC_RELAXED);
+
+    if (local->nFree > SLAB_LOCAL_MAX)
+        flushLocal(cache, local);
+}
+
+int slabGetStats(SlabCache *cache, SlabStats *stats)
+{
+    SlabLocal *local;
+    size_t allocs,
+        frees;
+
+    if (!cache || !stats)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    memset(stats, 0, sizeof(*stats));
+
+    if (!__atomic_load_n(&(cache->ready), __ATOMIC_ACQUIRE))
+        return 0;
+
+    LOCK(&(cache->lock));
+
+    allocs = cache->allocs;
+    frees = cache->frees;
+
+    // i contatori sono distribuiti tra i thread: un oggetto allocato da un thread puo' essere restituito da un altro
+    for (local = cache->locals; local; local = local->next)
+    {
+        allocs += __atomic_load_n(&(local->allocs), __ATOMIC_RELAXED);
+        frees += __atomic_load_n(&(local->frees), __ATOMIC_RELAXED);
+    }
+
+    stats->objSize = cache->objSize;
+    stats->blocks = cache->nBlocks;
+    stats->capacity = cache->nBlocks * ((SLAB_BLOCK_SIZE - BLOCK_HEADER) / cache->objSize);
+    stats->inUse = allocs - frees;
+
+    UNLOCK(&(cache->lock));
+
+    return 0;
+}
+
+void slabPrintStats(void)
+{
+    SlabCache *cache;
+    SlabStats stats;
+
+    LOCK(&registryLock);
+
+    for (cache = caches; cache; cache = cache->next)
+    {
+        if (slabGetStats(cache, &stats) == -1)
+            continue;
+
+        printf("Slab %s: %zu/%zu oggetti da %zu bytes in uso (%.1f%%), %zu blocchi\n", cache->name, stats.inUse, stats.capacity,
+               stats.objSize, stats.capacity ? 100.0 * stats.inUse / stats.capacity : 0.0, stats.blocks);
+    }
+
+    UNLOCK(&registryLock);
+}
+
+void slabCleanup(void)
+{
+    SlabCache *cache;
+    SlabLocal *local;
+    SlabBlock *block;
+
+    LOCK(&registryLock);
+
+    while ((cache = caches))
+    {
+        caches = cache->next;
+
+        // da qui in poi i thread che terminano non chiamano piu' releaseLocal
+        pthread_key_delete(cache->localKey);
+
+        while ((local = cache->locals))
+        {
+            cache->locals = local->next;
+            free(local);
+        }
+
+        while ((block = cache->blocks))
+        {
+            cache->blocks = block->next;
+            free(block);
+        }
+
+        cache->depot = NULL;
+        cache->nDepot = cache->nBlocks = 0;
+        cache->allocs = cache->frees = 0;
+        cache->next = NULL;
+        cache->ready = 0;
+    }
+
+    UNLOCK(&registryLock);
+}
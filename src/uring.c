@@ -0,0 +1,464 @@
+#include "../include/define_source.h"
+
+#include <errno.h>
+#include <linux/io_uring.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "../include/uring.h"
+#include "../include/utils.h"
+
+#define RECV_BUF_INDEX 0
+#define SEND_BUF_INDEX 1
+
+typedef struct pendingWrite
+{
+    int fd;
+    const char *base;
+    size_t len;
+} PendingWrite;
+
+struct ioEngine
+{
+    int ring_fd;
+    unsigned entries;
+
+    // submission queue
+    void *sq_ptr;
+    size_t sq_size;
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned *sq_mask;
+    unsigned *sq_array;
+    struct io_uring_sqe *sqes;
+    size_t sqes_size;
+
+    // completion queue
+    void *cq_ptr;
+    size_t cq_size;
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned *cq_mask;
+    struct io_uring_cqe *cqes;
+
+    int fixedBuffers; // 1 se i buffer sono stati registrati nel kernel
+
+    char *recv_buf;
+    size_t buf_size;
+    size_t recv_pos;
+    size_t recv_len;
+    int recv_fd;
+
+    char *send_buf;
+    size_t send_used;
+
+    PendingWrite *pending;
+    unsigned nPending;
+};
+
+static int io_uring_setup(unsigned entries, struct io_uring_params *p)
+{
+    return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int io_uring_enter(int ring_fd, unsigned to_submit, unsigned min_complete, unsigned flags)
+{
+    return (int)syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+static int io_uring_register(int ring_fd, unsigned opcode, void *arg, unsigned nr_args)
+{
+    return (int)syscall(__NR_io_uring_register, ring_fd, opcode, arg, nr_args);
+}
+
+/**
+ * @brief Prende la prossima submission libera e la azzera. Si assume che ci sia spazio nella coda (al piu' 'entries' operazioni in volo).
+ */
+static struct io_uring_sqe *getSqe(IoEngine *io)
+{
+    unsigned tail = *io->sq_tail,
+             index = tail & *io->sq_mask;
+
+    struct io_uring_sqe *sqe = &io->sqes[index];
+
+    memset(sqe, 0, sizeof(*sqe));
+    io->sq_array[index] = index;
+
+    // Rendo visibile la submission al kernel
+    __atomic_store_n(io->sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+    return sqe;
+}
+
+/**
+ * @brief Sottomette 'toSubmit' operazioni e ne attende 'toComplete' completamenti, salvandone i risultati in 'res' indicizzato per user_data.
+ *
+ * @return 0 se successo, -1 altrimenti e errno settato
+ */
+static int submitAndWait(IoEngine *io, unsigned toSubmit, unsigned toComplete, int *res)
+{
+    unsigned completed = 0;
+
+    while (completed < toComplete)
+    {
+        int ret = io_uring_enter(io->ring_fd, toSubmit, 1, IORING_ENTER_GETEVENTS);
+
+        if (ret == -1)
+        {
+            if (errno == EINTR)
+                continue;
+
+            return -1;
+        }
+
+        toSubmit -= MIN((unsigned)ret, toSubmit);
+
+        unsigned head = *io->cq_head;
+
+        while (head != __atomic_load_n(io->cq_tail, __ATOMIC_ACQUIRE))
+        {
+            struct io_uring_cqe *cqe = &io->cqes[head & *io->cq_mask];
+
+            res[cqe->user_data] = cqe->res;
+            completed++;
+            head++;
+        }
+
+        __atomic_store_n(io->cq_head, head, __ATOMIC_RELEASE);
+    }
+
+    return 0;
+}
+
+IoEngine *initIoEngine(unsigned entries, size_t bufSize)
+{
+    IoEngine *io;
+
+    struct io_uring_params params;
+
+    if (entries == 0 || bufSize == 0)
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    CHECK_RET_AND_ACTION(calloc, ==, NULL, io, return NULL, 1, sizeof(*io));
+
+    memset(&params, 0, sizeof(params));
+
+    if ((io->ring_fd = io_uring_setup(entries, &params)) == -1)
+    {
+        free(io);
+        return NULL;
+    }
+
+    io->entries = params.sq_entries;
+
+    io->sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    io->cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+        io->sq_size = io->cq_size = MAX(io->sq_size, io->cq_size);
+
+    io->sq_ptr = mmap(NULL, io->sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, io->ring_fd, IORING_OFF_SQ_RING);
+    if (io->sq_ptr == MAP_FAILED)
+        goto error;
+
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+        io->cq_ptr = io->sq_ptr;
+    else
+    {
+        io->cq_ptr = mmap(NULL, io->cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, io->ring_fd, IORING_OFF_CQ_RING);
+        if (io->cq_ptr == MAP_FAILED)
+            goto error;
+    }
+
+    io->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    io->sqes = mmap(NULL, io->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, io->ring_fd, IORING_OFF_SQES);
+    if (io->sqes == MAP_FAILED)
+        goto error;
+
+    io->sq_head = (unsigned *)((char *)io->sq_ptr + params.sq_off.head);
+    io->sq_tail = (unsigned *)((char *)io->sq_ptr + params.sq_off.tail);
+    io->sq_mask = (unsigned *)((char *)io->sq_ptr + params.sq_off.ring_mask);
+    io->sq_array = (unsigned *)((char *)io->sq_ptr + params.sq_off.array);
+
+    io->cq_head = (unsigned *)((char *)io->cq_ptr + params.cq_off.head);
+    io->cq_tail = (unsigned *)((char *)io->cq_ptr + params.cq_off.tail);
+    io->cq_mask = (unsigned *)((char *)io->cq_ptr + params.cq_off.ring_mask);
+    io->cqes = (struct io_uring_cqe *)((char *)io->cq_ptr + params.cq_off.cqes);
+
+    io->buf_size = bufSize;
+    io->recv_fd = -1;
+
+    if (!(io->recv_buf = malloc(bufSize)) || !(io->send_buf = malloc(bufSize)) || !(io->pending = calloc(io->entries, sizeof(PendingWrite))))
+    {
+        errno = ENOMEM;
+        goto error;
+    }
+
+    // Registro i buffer di ricezione e di invio: se il kernel non lo consente (es. RLIMIT_MEMLOCK) uso le operazioni non fixed
+    struct iovec buffers[2] = {{.iov_base = io->recv_buf, .iov_len = bufSize}, {.iov_base = io->send_buf, .iov_len = bufSize}};
+
+    io->fixedBuffers = io_uring_register(io->ring_fd, IORING_REGISTER_BUFFERS, buffers, ARRAY_SIZE(buffers)) == 0;
+
+    return io;
+
+error:
+    SAVE_ERRNO_AND_RETURN(deleteIoEngine(io), NULL);
+}
+
+void deleteIoEngine(IoEngine *io)
+{
+    if (!io)
+        return;
+
+    if (io->nPending)
+        ioEngineFlush(io);
+
+    if (io->sqes && io->sqes != MAP_FAILED)
+        munmap(io->sqes, io->sqes_size);
+
+    if (io->cq_ptr && io->cq_ptr != MAP_FAILED && io->cq_ptr != io->sq_ptr)
+        munmap(io->cq_ptr, io->cq_size);
+
+    if (io->sq_ptr && io->sq_ptr != MAP_FAILED)
+        munmap(io->sq_ptr, io->sq_size);
+
+    close(io->ring_fd);
+
+    free(io->recv_buf);
+    free(io->send_buf);
+    free(io->pending);
+    free(io);
+}
+
+/**
+ * @brief Esegue una singola lettura di al piu' 'len' bytes in 'buf' tramite io_uring. Se 'buf' e' il buffer registrato usa READ_FIXED.
+ *
+ * @return bytes letti, 0 se EOF, -1 se errore e errno settato
+ */
+static ssize_t readOnce(IoEngine *io, int fd, void *buf, size_t len)
+{
+    int res = 0;
+
+    struct io_uring_sqe *sqe = getSqe(io);
+
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = fd;
+    sqe->addr = (unsigned long)buf;
+    sqe->len = (unsigned)MIN(len, (size_t)UINT32_MAX);
+    sqe->user_data = 0;
+
+    if (io->fixedBuffers && buf == io->recv_buf)
+    {
+        sqe->opcode = IORING_OP_READ_FIXED;
+        sqe->buf_index = RECV_BUF_INDEX;
+    }
+
+    if (submitAndWait(io, 1, 1, &res) == -1)
+        return -1;
+
+    if (res < 0)
+    {
+        errno = -res;
+        return -1;
+    }
+
+    return res;
+}
+
+int ioEngineRead(IoEngine *io, int fd, void *buf, size_t len)
+{
+    char *dst = (char *)buf;
+    ssize_t r;
+
+    if (!io || fd < 0 || (!buf && len))
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (io->nPending && ioEngineFlush(io) == -1)
+        return -1;
+
+    // I dati bufferizzati appartengono a un altro client
+    if (io->recv_fd != fd)
+        ioEngineDiscard(io, io->recv_fd);
+
+    while (len > 0)
+    {
+        if (io->recv_pos < io->recv_len)
+        {
+            size_t n = MIN(len, io->recv_len - io->recv_pos);
+
+            memcpy(dst, io->recv_buf + io->recv_pos, n);
+            io->recv_pos += n;
+            dst += n;
+            len -= n;
+            continue;
+        }
+
+        // Letture grandi (es. il contenuto di un file) vanno direttamente nel buffer del chiamante
+        if (len >= io->buf_size)
+        {
+            if ((r = readOnce(io, fd, dst, len)) == -1)
+                return -1;
+
+            if (r == 0)
+                break;
+
+            dst += r;
+            len -= r;
+            continue;
+        }
+
+        // Riempio il buffer registrato: di solito una sola lettura contiene header, payload e dati della richiesta
+        if ((r = readOnce(io, fd, io->recv_buf, io->buf_size)) == -1)
+            return -1;
+
+        if (r == 0)
+            break;
+
+        io->recv_fd = fd;
+        io->recv_pos = 0;
+        io->recv_len = r;
+    }
+
+    return 0;
+}
+
+int ioEngineWrite(IoEngine *io, int fd, const void *buf, size_t len, int copy)
+{
+    if (!io || fd < 0 || (!buf && len))
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (len == 0)
+        return 0;
+
+    if (io->nPending == io->entries || (copy && io->send_used + len > io->buf_size))
+    {
+        if (ioEngineFlush(io) == -1)
+            return -1;
+    }
+
+    // Non ci sta nemmeno nel buffer vuoto: scrivo direttamente
+    if (copy && len > io->buf_size)
+        return writen(fd, (void *)buf, len);
+
+    struct io_uring_sqe *sqe = getSqe(io);
+    PendingWrite *pw = &io->pending[io->nPending];
+
+    pw->fd = fd;
+    pw->base = buf;
+    pw->len = len;
+
+    if (copy)
+    {
+        pw->base = io->send_buf + io->send_used;
+        memcpy(io->send_buf + io->send_used, buf, len);
+        io->send_used += len;
+    }
+
+    sqe->opcode = (copy && io->fixedBuffers) ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+    sqe->fd = fd;
+    sqe->addr = (unsigned long)pw->base;
+    sqe->len = (unsigned)MIN(len, (size_t)UINT32_MAX);
+    sqe->user_data = io->nPending;
+
+    if (copy && io->fixedBuffers)
+        sqe->buf_index = SEND_BUF_INDEX;
+
+    // Le scritture vengono concatenate: quelle verso lo stesso client devono arrivare in ordine
+    if (io->nPending > 0)
+        io->sqes[(*io->sq_tail - 2) & *io->sq_mask].flags |= IOSQE_IO_LINK;
+
+    io->nPending++;
+
+    return 0;
+}
+
+int ioEngineFlush(IoEngine *io)
+{
+    int failed = 0,
+        errnum = 0;
+
+    if (!io)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (io->nPending == 0)
+        return 0;
+
+    int *res = calloc(io->nPending, sizeof(int));
+
+    if (!res || submitAndWait(io, io->nPending, io->nPending, res) == -1)
+    {
+        free(res);
+        io->nPending = io->send_used = 0;
+        return -1;
+    }
+
+    // Una scrittura parziale interrompe la catena: completo in ordine quella e le successive (annullate) con le normali syscall
+    for (unsigned i = 0; i < io->nPending; i++)
+    {
+        PendingWrite *pw = &io->pending[i];
+
+        if (res[i] == (int)pw->len)
+            continue;
+
+        if (res[i] >= 0 || res[i] == -ECANCELED)
+        {
+            size_t done = res[i] > 0 ? res[i] : 0;
+
+            if (writen(pw->fd, (void *)(pw->base + done), pw->len - done) == 0)
+                continue;
+
+            errnum = errno;
+        }
+        else
+            errnum = -res[i];
+
+        failed = 1;
+    }
+
+    free(res);
+    io->nPending = 0;
+    io->send_used = 0;
+
+    if (failed)
+    {
+        errno = errnum;
+        return -1;
+    }
+
+    return 0;
+}
+
+size_t ioEngineBuffered(IoEngine *io, int fd)
+{
+    if (!io || io->recv_fd != fd)
+        return 0;
+
+    return io->recv_len - io->recv_pos;
+}
+
+void ioEngineDiscard(IoEngine *io, int fd)
+{
+    if (!io || io->recv_fd != fd)
+        return;
+
+    io->recv_fd = -1;
+    io->recv_pos = io->recv_len = 0;
+}
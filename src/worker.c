@@ -6,63 +6,122 @@
 
 #include "../include/fdList.h"
 #include "../include/message_protocol.h"
+#include "../include/poller.h"
+#include "../include/slab.h"
+#include "../include/uring.h"
 #include "../include/utils.h"
 #include "../include/worker.h"
 
+#define REACTOR_MAX_EVENTS 32
+
 #define THREAD_ERR_EXIT                                         \
     fprintf(stderr, "Errore in thread: %ld\n", pthread_self()); \
     pthread_exit((void *)EXIT_FAILURE);
 
-#define SEND_RESPONSE_CODE(fd, code)                                       \
-    if (1)                                                                 \
-    {                                                                      \
-        int response_code = code;                                          \
-        if (writen(fd, &response_code, sizeof(int)) == -1)                 \
-        {                                                                  \
-            perror("writen");                                              \
-            THREAD_ERR_EXIT;                                               \
-        }                                                                  \
+#define SEND_RESPONSE_CODE(th_args, fd, code)                            \
+    if (1)                                                               \
+    {                                                                    \
+        int response_code = code;                                        \
+        if (sendData(th_args, fd, &response_code, sizeof(int), 1) == -1) \
+        {                                                                \
+            perror("writen");                                            \
+            THREAD_ERR_EXIT;                                             \
+        }                                                                \
     }
 
-#define SEND_ERROR_CODE(fd)                  \
-    switch (errno)                           \
-    {                                        \
-    case EINVAL:                             \
-        SEND_RESPONSE_CODE(fd, INVALID_REQ); \
-        break;                               \
-    case ENOENT:                             \
-        SEND_RESPONSE_CODE(fd, FILENOENT);   \
-        break;                               \
-    case EEXIST:                             \
-        SEND_RESPONSE_CODE(fd, FILEEX);      \
-        break;                               \
-    case ENOMEM:                             \
-        SEND_RESPONSE_CODE(fd, SERVER_ERR);  \
-        break;                               \
-    case EACCES:                             \
-        SEND_RESPONSE_CODE(fd, FILE_LOCK);   \
-        break;                               \
-    case EFBIG:                              \
-        SEND_RESPONSE_CODE(fd, BIG_FILE);    \
-        break;                               \
-    default:                                 \
-        break;                               \
+#define SEND_ERROR_CODE(th_args, fd)                   \
+    switch (errno)                                     \
+    {                                                  \
+    case EINVAL:                                       \
+        SEND_RESPONSE_CODE(th_args, fd, INVALID_REQ);  \
+        break;                                         \
+    case ENOENT:                                       \
+        SEND_RESPONSE_CODE(th_args, fd, FILENOENT);    \
+        break;                                         \
+    case EEXIST:                                       \
+        SEND_RESPONSE_CODE(th_args, fd, FILEEX);       \
+        break;                                         \
+    case ENOMEM:                                       \
+        SEND_RESPONSE_CODE(th_args, fd, SERVER_ERR);   \
+        break;                                         \
+    case EACCES:                                       \
+        SEND_RESPONSE_CODE(th_args, fd, FILE_LOCK);    \
+        break;                                         \
+    case EFBIG:                                        \
+        SEND_RESPONSE_CODE(th_args, fd, BIG_FILE);     \
+        break;                                         \
+    case ECANCELED:                                    \
+        SEND_RESPONSE_CODE(th_args, fd, NOT_ADMITTED); \
+        break;                                         \
+    default:                                           \
+        break;                                         \
     }
 
-#define SIGNAL_WAITING_FOR_LOCK(signalForLock, responseCode, managerFd)                                          \
-    while (signalForLock && signalForLock->head)                                                                 \
-    {                                                                                                            \
-        fdNode *tmp = popNode(signalForLock);                                                                    \
-        SEND_RESPONSE_CODE(tmp->fd, responseCode);                                                               \
-        CHECK_AND_ACTION(writen, ==, -1, perror("writen"); THREAD_ERR_EXIT, managerFd, &(tmp->fd), sizeof(int)); \
-        deleteNode(tmp);                                                                                         \
-    }                                                                                                            \
+#define SIGNAL_WAITING_FOR_LOCK(signalForLock, responseCode, th_args)          \
+    if (signalForLock)                                                         \
+    {                                                                          \
+        for (fdNode *curr = signalForLock->head; curr; curr = curr->next)      \
+        {                                                                      \
+            SEND_RESPONSE_CODE(th_args, curr->fd, responseCode);               \
+        }                                                                      \
+        flushData(th_args);                                                    \
+    }                                                                          \
+    while (signalForLock && signalForLock->head)                               \
+    {                                                                          \
+        fdNode *tmp = popNode(signalForLock);                                  \
+        SYSCALL_EQ_ACTION(rearmClient, -1, THREAD_ERR_EXIT, th_args, tmp->fd); \
+        deleteNode(tmp);                                                       \
+    }                                                                          \
     deleteList(&signalForLock);
 
-static ssize_t readRequestHeader(int fd, int *request_code, size_t *request_len)
+/**
+ * @brief Legge esattamente 'len' bytes dal client 'fd' tramite il motore io_uring del worker, se presente, altrimenti con readn.
+ *
+ * @return 0 se successo, -1 altrimenti e errno settato
+ */
+static int recvData(ThreadArgs *th_args, int fd, void *buf, size_t len)
+{
+    if (th_args->io)
+        return ioEngineRead(th_args->io, fd, buf, len);
+
+    return readn(fd, buf, len);
+}
+
+/**
+ * @brief Invia 'len' bytes al client 'fd'. Con il motore io_uring la scrittura viene solo accodata e inviata alla successiva
+ * flushData: se 'copy' non e' settato 'buf' deve restare valido fino ad allora.
+ *
+ * @return 0 se successo, -1 altrimenti e errno settato
+ */
+static int sendData(ThreadArgs *th_args, int fd, void *buf, size_t len, int copy)
+{
+    if (th_args->io)
+        return ioEngineWrite(th_args->io, fd, buf, len, copy);
+
+    return writen(fd, buf, len);
+}
+
+/**
+ * @brief Invia con una sola submission tutte le scritture accodate dal worker (nessuna operazione senza motore io_uring).
+ */
+static void flushData(ThreadArgs *th_args)
+{
+    if (th_args->io && ioEngineFlush(th_args->io) == -1)
+        perror("ioEngineFlush");
+}
+
+static ssize_t readRequestHeader(ThreadArgs *th_args, int fd, int *request_code, size_t *request_len)
 {
     struct iovec request_hdr[2];
 
+    if (th_args->io)
+    {
+        if (ioEngineRead(th_args->io, fd, request_code, sizeof(int)) == -1)
+            return -1;
+
+        return ioEngineRead(th_args->io, fd, request_len, sizeof(size_t));
+    }
+
     memset(request_hdr, 0, sizeof(request_hdr));
 
     request_hdr[0].iov_base = request_code;
@@ -74,25 +133,26 @@ static ssize_t readRequestHeader(int fd, int *request_code, size_t *request_len)
     return readv(fd, request_hdr, ARRAY_SIZE(request_hdr));
 }
 
-static char *readRequestPayload(int fd, size_t request_len)
+static char *readRequestPayload(ThreadArgs *th_args, int fd, size_t request_len)
 {
     char *request_buf;
 
-    request_buf = calloc(request_len, sizeof(char));
+    // un byte in piu' perche' il payload sia sempre terminato, anche se il client non ha inviato il terminatore
+    request_buf = calloc(request_len + 1, sizeof(char));
 
-    if (!request_buf || readn(fd, request_buf, request_len) == -1)
+    if (!request_buf || recvData(th_args, fd, request_buf, request_len) == -1)
         return NULL;
 
     return request_buf;
 }
 
-static char *readSegment(int fd, size_t *data_size)
+static char *readSegment(ThreadArgs *th_args, int fd, size_t *data_size)
 {
     char *segment_buf;
 
     size_t segment_len;
 
-    if (readn(fd, &segment_len, sizeof(size_t)) == -1)
+    if (recvData(th_args, fd, &segment_len, sizeof(size_t)) == -1)
         return NULL;
 
     if (data_size)
@@ -103,254 +163,411 @@ static char *readSegment(int fd, size_t *data_size)
     if (!segment_buf)
         return NULL;
 
-    if (readn(fd, segment_buf, segment_len) == -1)
+    if (recvData(th_args, fd, segment_buf, segment_len) == -1)
         return NULL;
 
     return segment_buf;
 }
 
-static int writeSegment(int fd, char **data_buf, size_t *data_size)
+/**
+ * @brief Invia al client 'fd' i blocchi descritti dal buffer 'buf' senza copiarli. Con il motore io_uring le scritture
+ * vengono solo accodate: il buffer puo' essere rilasciato solo dopo flushData.
+ *
+ * @return 0 se successo, -1 altrimenti e errno settato
+ */
+static int sendFileBuffer(ThreadArgs *th_args, int fd, FileBuffer *buf)
 {
-    struct iovec segment[2];
+    int i;
+
+    if (th_args->io)
+    {
+        for (i = 0; i < buf->iovcnt; i++)
+        {
+            if (ioEngineWrite(th_args->io, fd, buf->iov[i].iov_base, buf->iov[i].iov_len, 0) == -1)
+                return -1;
+        }
+
+        return 0;
+    }
 
-    memset(segment, 0, sizeof(segment));
+    return writevn(fd, buf->iov, buf->iovcnt);
+}
 
-    segment[0].iov_base = data_size;
-    segment[0].iov_len = sizeof(size_t);
+static int writeSegment(ThreadArgs *th_args, int fd, FileBuffer *buf)
+{
+    if (sendData(th_args, fd, &(buf->size), sizeof(size_t), 1) == -1)
+        return -1;
 
-    segment[1].iov_base = *data_buf;
-    segment[1].iov_len = *data_size;
+    return sendFileBuffer(th_args, fd, buf);
+}
 
-    return writev(fd, segment, ARRAY_SIZE(segment));
+/**
+ * @brief Riarma il client 'fd' sull'istanza epoll a cui e' stato assegnato: quella condivisa o, in modalita' multi-reactor,
+ * quella del worker che lo possiede (che puo' essere diverso dal chiamante, ad esempio quando gli viene passata una lock).
+ *
+ * @return 0 se successo, -1 altrimenti e errno settato
+ */
+static int rearmClient(ThreadArgs *th_args, int fd)
+{
+    return rearmFd(th_args->fd_owner ? th_args->fd_owner[fd] : th_args->epoll_fd, fd);
 }
 
-void *processRequest(void *args)
+/**
+ * @brief Legge dal client 'client_fd' una richiesta, la esegue sul filesystem e invia la risposta. Al termine riarma il client
+ * (se non e' uscito o non e' in attesa di una lock).
+ *
+ * @param th_args argomenti del thread worker
+ * @param client_fd fd del client pronto in lettura
+ */
+static void handleRequest(ThreadArgs *th_args, int client_fd)
 {
-    BQueue_t *client_request_queue = ((ThreadArgs *)args)->queue;
-    Filesystem *fs = ((ThreadArgs *)args)->fs;
-    int managerFd = ((ThreadArgs *)args)->write_end_pipe_fd;
+    Filesystem *fs = th_args->fs;
 
-    while (1)
+    char *request_payload = NULL,
+         *file_data_buf = NULL,
+         *stats_buf = NULL;
+
+    FileBuffer files_buf;
+    FsPath path;
+
+    int request_code = 0,
+        open_file_flag = 0,
+        waitForLock = 0,
+        clientLeft = 0;
+
+    long upperLimit = 0;
+
+    size_t file_size = 0,
+           request_len = 0;
+
+    fdList *signalForLock = NULL;
+
+    memset(&files_buf, 0, sizeof(files_buf));
+
+    if (readRequestHeader(th_args, client_fd, &request_code, &request_len) == -1)
+    {
+        SEND_RESPONSE_CODE(th_args, client_fd, SERVER_ERR);
+        return;
+    }
+
+    request_payload = readRequestPayload(th_args, client_fd, request_len);
+
+    if (!request_payload)
     {
-        int *client_fd = pop(client_request_queue);
+        SEND_RESPONSE_CODE(th_args, client_fd, SERVER_ERR);
+        return;
+    }
+
+    // lunghezza e hash del path vengono calcolati una sola volta per richiesta
+    initFsPath(&path, request_payload);
 
-        if (client_fd == EOS)
+    errno = 0;
+    switch (request_code)
+    {
+    case CLOSE_CONNECTION:
+        if (clientExitHandler(fs, &signalForLock, client_fd) == -1)
         {
-            logOperation(fs->logger_msg_queue, "Termination message recived", "", 0, 0);
+            SEND_ERROR_CODE(th_args, client_fd);
             break;
         }
-            
 
-        char *request_payload = NULL,
-             *file_data_buf = NULL,
-             *evicted_files_buf = NULL;
+        SEND_RESPONSE_CODE(th_args, client_fd, SUCCESS);
+        flushData(th_args);
 
-        int request_code = 0,
-            open_file_flag = 0,
-            waitForLock = 0;
+        if (th_args->io)
+            ioEngineDiscard(th_args->io, client_fd);
 
-        long upperLimit = 0;
+        SYSCALL_EQ_ACTION(close, -1, THREAD_ERR_EXIT, client_fd);
 
-        size_t file_size = 0,
-               evicted_files_size = 0,
-               request_len = 0;
+        logOperation(fs->logger_msg_queue, "clientExit", "", client_fd, 0);
+        SIGNAL_WAITING_FOR_LOCK(signalForLock, SUCCESS, th_args);
 
-        fdList *signalForLock = NULL;
+        clientLeft = 1; // il thread manager verra' avvertito che un client e' uscito
+        break;
+    case OPEN_FILE:
+        if (recvData(th_args, client_fd, &open_file_flag, sizeof(int)) == -1)
+        {
+            SEND_RESPONSE_CODE(th_args, client_fd, SERVER_ERR);
+            break;
+        }
 
-        if (readRequestHeader(*client_fd, &request_code, &request_len) == -1)
+        if (openFileHandler(fs, &path, open_file_flag, &signalForLock, client_fd) == -1)
         {
-            SEND_RESPONSE_CODE(*client_fd, SERVER_ERR);
-            continue;
+            SEND_ERROR_CODE(th_args, client_fd)
+            SIGNAL_WAITING_FOR_LOCK(signalForLock, FILENOENT, th_args);
+            break;
         }
 
-        request_payload = readRequestPayload(*client_fd, request_len);
+        SEND_RESPONSE_CODE(th_args, client_fd, SUCCESS);
 
-        if (!request_payload)
+        SIGNAL_WAITING_FOR_LOCK(signalForLock, FILENOENT, th_args);
+        break;
+    case WRITE_FILE:
+        if (canWrite(fs, &path, client_fd) == 0)
         {
-            SEND_RESPONSE_CODE(*client_fd, SERVER_ERR);
-            continue;
+            SEND_RESPONSE_CODE(th_args, client_fd, INVALID_REQ);
+            break;
         }
+    case APPEND_FILE:
+
+        file_data_buf = readSegment(th_args, client_fd, &file_size);
 
-        errno = 0;
-        switch (request_code)
+        if (!file_data_buf)
         {
-        case CLOSE_CONNECTION:
-            if (clientExitHandler(fs, &signalForLock, *client_fd) == -1)
-            {
-                SEND_ERROR_CODE(*client_fd);
-                break;
-            }
+            SEND_ERROR_CODE(th_args, client_fd)
+            break;
+        }
+
+        if (writeFileHandler(fs, &path, file_data_buf, file_size, &files_buf, &signalForLock, client_fd) == -1)
+        {
+            SEND_ERROR_CODE(th_args, client_fd)
+            SIGNAL_WAITING_FOR_LOCK(signalForLock, FILENOENT, th_args);
+            break;
+        }
 
-            SEND_RESPONSE_CODE(*client_fd, SUCCESS);
+        SEND_RESPONSE_CODE(th_args, client_fd, SUCCESS);
 
-            SYSCALL_EQ_ACTION(close, -1, THREAD_ERR_EXIT, (*client_fd));
+        if (sendFileBuffer(th_args, client_fd, &files_buf) == -1)
+            fprintf(stderr, "Errore writeFile inviando file al client\n");
 
-            logOperation(fs->logger_msg_queue, "clientExit", "", *client_fd, 0);
-            SIGNAL_WAITING_FOR_LOCK(signalForLock, SUCCESS, managerFd);
+        file_size = 0; // Avverto il client che non ci sono più file da leggere
+        if (sendData(th_args, client_fd, &file_size, sizeof(size_t), 1) == -1)
+            fprintf(stderr, "Errore writeFile inviando mesaggio di terminazione al client\n");
 
-            *client_fd = 0; // così il thread manager saprà che un client e' uscito
+        SIGNAL_WAITING_FOR_LOCK(signalForLock, FILENOENT, th_args);
+        break;
+    case READ_FILE:
+        if (readFileHandler(fs, &path, &files_buf, client_fd) == -1)
+        {
+            SEND_ERROR_CODE(th_args, client_fd);
             break;
-        case OPEN_FILE:
-            if (readn(*client_fd, &open_file_flag, sizeof(int)) == -1)
-            {
-                SEND_RESPONSE_CODE(*client_fd, SERVER_ERR);
-                break;
-            }
+        }
 
-            if (openFileHandler(fs, request_payload, open_file_flag, &signalForLock, *client_fd) == -1)
-            {
-                SEND_ERROR_CODE(*client_fd)
-                break;
-            }
+        SEND_RESPONSE_CODE(th_args, client_fd, SUCCESS);
 
-            SEND_RESPONSE_CODE(*client_fd, SUCCESS);
+        if (writeSegment(th_args, client_fd, &files_buf) == -1)
+            fprintf(stderr, "Errore readFile inviando file al client\n");
+        break;
+    case READ_N_FILE:
+        if (isNumber(request_payload, &upperLimit) != 0)
+        {
+            SEND_RESPONSE_CODE(th_args, client_fd, INVALID_REQ);
+            break;
+        }
 
-            SIGNAL_WAITING_FOR_LOCK(signalForLock, FILENOENT, managerFd);
+        if (readNFilesHandler(fs, upperLimit, &files_buf, client_fd) == -1)
+        {
+            SEND_ERROR_CODE(th_args, client_fd);
             break;
-        case WRITE_FILE:
-            if (canWrite(fs, request_payload, *client_fd) == 0)
-            {
-                SEND_RESPONSE_CODE(*client_fd, INVALID_REQ);
-                break;
-            }
-        case APPEND_FILE:
+        }
 
-            file_data_buf = readSegment(*client_fd, &file_size);
+        SEND_RESPONSE_CODE(th_args, client_fd, SUCCESS);
 
-            if (!file_data_buf)
-            {
-                SEND_ERROR_CODE(*client_fd)
-                break;
-            }
+        if (sendFileBuffer(th_args, client_fd, &files_buf) == -1)
+            fprintf(stderr, "Errore ReadNFiles inviando file al client\n");
 
-            if (writeFileHandler(fs, request_payload, file_data_buf, file_size, (void **)&evicted_files_buf, &evicted_files_size, &signalForLock, *client_fd) == -1)
-            {
-                SEND_ERROR_CODE(*client_fd)
-                break;
-            }
+        file_size = 0; // Avverto il client che non ci sono più file da leggere
+        if (sendData(th_args, client_fd, &file_size, sizeof(size_t), 1) == -1)
+            fprintf(stderr, "Errore ReadNFiles inviando mesaggio di terminazione al client\n");
+        break;
+    case LOCK_FILE:;
+        int result;
 
-            SEND_RESPONSE_CODE(*client_fd, SUCCESS);
+        if ((result = lockFileHandler(fs, &path, client_fd)) == -1)
+        {
+            SEND_ERROR_CODE(th_args, client_fd);
+            break;
+        }
 
-            if (evicted_files_buf)
-            {
-                if (writen(*client_fd, evicted_files_buf, evicted_files_size) == -1)
-                    fprintf(stderr, "Errore writeFile inviando file al client\n");
-            }
+        if (result == -2) // Il client deve attendere per acquisire la lock
+        {
+            waitForLock = 1; // Il suo fd non verra' riarmato nell'istanza epoll
+            break;
+        }
 
-            evicted_files_size = 0; // Avverto il client che non ci sono più file da leggere
-            if (writen(*client_fd, &evicted_files_size, sizeof(size_t)) == -1)
-                fprintf(stderr, "Errore writeFile inviando mesaggio di terminazione al client\n");
+        SEND_RESPONSE_CODE(th_args, client_fd, SUCCESS);
+        break;
+    case UNLOCK_FILE:;
+        int nextLockFd = 0;
+        if (unlockFileHandler(fs, &path, &nextLockFd, client_fd) == -1)
+        {
+            SEND_ERROR_CODE(th_args, client_fd);
+            break;
+        }
+        SEND_RESPONSE_CODE(th_args, client_fd, SUCCESS);
 
-            SIGNAL_WAITING_FOR_LOCK(signalForLock, FILENOENT, managerFd);
+        if (nextLockFd)
+        {
+            SEND_RESPONSE_CODE(th_args, nextLockFd, SUCCESS);
+            flushData(th_args);
+            SYSCALL_EQ_ACTION(rearmClient, -1, THREAD_ERR_EXIT, th_args, nextLockFd);
+        }
+        break;
+    case REMOVE_FILE:
+        if (removeFileHandler(fs, &path, &signalForLock, client_fd) == -1)
+        {
+            SEND_ERROR_CODE(th_args, client_fd);
             break;
-        case READ_FILE:
-            if (readFileHandler(fs, request_payload, (void **)&file_data_buf, &file_size, *client_fd) == -1)
-            {
-                SEND_ERROR_CODE(*client_fd);
-                break;
-            }
+        }
+        SEND_RESPONSE_CODE(th_args, client_fd, SUCCESS);
 
-            SEND_RESPONSE_CODE(*client_fd, SUCCESS);
+        SIGNAL_WAITING_FOR_LOCK(signalForLock, FILENOENT, th_args);
+        break;
+    case CLOSE_FILE:
+        if (closeFileHandler(fs, &path, client_fd) == -1)
+        {
+            SEND_ERROR_CODE(th_args, client_fd)
+            break;
+        }
 
-            if (writeSegment(*client_fd, &file_data_buf, &file_size) == -1)
-                fprintf(stderr, "Errore readFile inviando file al client\n");
+        SEND_RESPONSE_CODE(th_args, client_fd, SUCCESS);
+        break;
+    case STATS:
+        if (getStatsHandler(fs, th_args->scheduler, &stats_buf, &file_size) == -1)
+        {
+            SEND_RESPONSE_CODE(th_args, client_fd, SERVER_ERR);
             break;
-        case READ_N_FILE:
-            if (isNumber(request_payload, &upperLimit) != 0)
-            {
-                SEND_RESPONSE_CODE(*client_fd, INVALID_REQ);
-                break;
-            }
+        }
 
-            if (readNFilesHandler(fs, upperLimit, (void **)&file_data_buf, &file_size, *client_fd) == -1)
-            {
-                SEND_ERROR_CODE(*client_fd);
-                break;
-            }
+        SEND_RESPONSE_CODE(th_args, client_fd, SUCCESS);
 
-            SEND_RESPONSE_CODE(*client_fd, SUCCESS);
+        if (sendData(th_args, client_fd, &file_size, sizeof(size_t), 1) == -1 ||
+            sendData(th_args, client_fd, stats_buf, file_size, 0) == -1)
+            fprintf(stderr, "Errore stats inviando le statistiche al client\n");
+        break;
+    default:
+        SEND_RESPONSE_CODE(th_args, client_fd, INVALID_REQ);
+        break;
+    }
 
-            if (file_data_buf)
-            {
-                if (writen(*client_fd, file_data_buf, file_size) == -1)
-                    fprintf(stderr, "Errore ReadNFiles inviando file al client\n");
-            }
+    // Invio in blocco le risposte accodate prima di liberare i buffer a cui fanno riferimento
+    flushData(th_args);
 
-            file_size = 0; // Avverto il client che non ci sono più file da leggere
-            if (writen(*client_fd, &file_size, sizeof(size_t)) == -1)
-                fprintf(stderr, "Errore ReadNFiles inviando mesaggio di terminazione al client\n");
-            break;
-        case LOCK_FILE:;
-            int result;
+    if (request_payload)
+        free(request_payload);
 
-            if ((result = lockFileHandler(fs, request_payload, *client_fd)) == -1)
-            {
-                SEND_ERROR_CODE(*client_fd);
-                break;
-            }
+    if (file_data_buf)
+        free(file_data_buf);
 
-            if (result == -2) // Il client deve attendere per acquisire la lock
-            {
-                waitForLock = 1; // Il suo fd non verra' inserito nel working_set della select
-                break;
-            }
+    if (stats_buf)
+        free(stats_buf);
 
-            SEND_RESPONSE_CODE(*client_fd, SUCCESS);
-            break;
-        case UNLOCK_FILE:;
-            int nextLockFd = 0;
-            if (unlockFileHandler(fs, request_payload, &nextLockFd, *client_fd) == -1)
-            {
-                SEND_ERROR_CODE(*client_fd);
-                break;
-            }
-            SEND_RESPONSE_CODE(*client_fd, SUCCESS);
+    releaseFileBuffer(&files_buf);
 
-            if (nextLockFd)
-            {
-                SEND_RESPONSE_CODE(nextLockFd, SUCCESS);
-                CHECK_AND_ACTION(writen, ==, -1, perror("writen"); THREAD_ERR_EXIT, managerFd, &nextLockFd, sizeof(int));
-            }
-            break;
-        case REMOVE_FILE:
-            if (removeFileHandler(fs, request_payload, &signalForLock, *client_fd) == -1)
-            {
-                SEND_ERROR_CODE(*client_fd);
-                break;
-            }
-            SEND_RESPONSE_CODE(*client_fd, SUCCESS);
+    if (clientLeft)
+    {
+        if (th_args->fd_owner)
+            __atomic_sub_fetch(&(th_args->nClients), 1, __ATOMIC_RELAXED);
 
-            SIGNAL_WAITING_FOR_LOCK(signalForLock, FILENOENT, managerFd);
-            break;
-        case CLOSE_FILE:
-            if (closeFileHandler(fs, request_payload, *client_fd) == -1)
-            {
-                SEND_ERROR_CODE(*client_fd)
-                break;
-            }
+        CHECK_AND_ACTION(writen, ==, -1, perror("writen"); THREAD_ERR_EXIT, th_args->write_end_pipe_fd, &client_fd, sizeof(int));
+    }
+    else if (!waitForLock)
+    {
+        // Il client ha inviato altre richieste che sono gia' state lette nel buffer del motore io_uring: l'istanza epoll non le
+        // segnalerebbe piu', quindi le servo subito
+        if (ioEngineBuffered(th_args->io, client_fd) > 0)
+        {
+            handleRequest(th_args, client_fd);
+            return;
+        }
+
+        // Riarmo direttamente il client senza passare dal thread manager
+        SYSCALL_EQ_ACTION(rearmClient, -1, THREAD_ERR_EXIT, th_args, client_fd);
+    }
+    else if (th_args->io)
+        ioEngineDiscard(th_args->io, client_fd);
+}
+
+/**
+ * @brief Crea il motore io_uring del worker se richiesto dalla configurazione. Se il kernel non supporta io_uring il worker
+ * continua a usare le normali syscall.
+ */
+static void initWorkerIo(ThreadArgs *th_args)
+{
+    th_args->io = NULL;
+
+    if (th_args->io_engine != IO_ENGINE_URING)
+        return;
+
+    if (!(th_args->io = initIoEngine(URING_ENTRIES, URING_BUF_SIZE)))
+        perror("io_uring non disponibile, uso le syscall");
+}
+
+void *processRequest(void *args)
+{
+    Scheduler *scheduler = ((ThreadArgs *)args)->scheduler;
+    size_t id = ((ThreadArgs *)args)->id;
+    Filesystem *fs = ((ThreadArgs *)args)->fs;
+
+    initWorkerIo((ThreadArgs *)args);
+
+    while (1)
+    {
+        ClientRequest *request = schedulerNext(scheduler, id);
+
+        if (!request)
+        {
+            // nessun client per tutto il timeout di inattivita': il worker esce dal pool
+            if (errno == ETIMEDOUT)
+                logOperation(fs->logger_msg_queue, "Worker retired", "", 0, 0);
+            else
+                perror("schedulerNext");
 
-            SEND_RESPONSE_CODE(*client_fd, SUCCESS);
             break;
-        default:
-            SEND_RESPONSE_CODE(*client_fd, INVALID_REQ);
+        }
+
+        if (request == EOS)
+        {
+            logOperation(fs->logger_msg_queue, "Termination message recived", "", 0, 0);
             break;
         }
 
-        if (request_payload)
-            free(request_payload);
+        schedulerRecordWait(scheduler, schedulerNow() - request->queuedAt);
+
+        handleRequest((ThreadArgs *)args, request->fd);
+
+        slabFree(request);
+    }
+
+    deleteIoEngine(((ThreadArgs *)args)->io);
+
+    pthread_exit(NULL);
+}
+
+void *processReactorRequests(void *args)
+{
+    ThreadArgs *th_args = (ThreadArgs *)args;
+    Filesystem *fs = th_args->fs;
+
+    struct epoll_event events[REACTOR_MAX_EVENTS];
 
-        if (file_data_buf)
-            free(file_data_buf);
+    int nready;
 
-        if (evicted_files_buf)
-            free(evicted_files_buf);
+    initWorkerIo(th_args);
 
-        if (!waitForLock)
+    while (1)
+    {
+        if ((nready = epoll_wait(th_args->epoll_fd, events, REACTOR_MAX_EVENTS, -1)) == -1)
         {
-            CHECK_AND_ACTION(writen, ==, -1, perror("writen"); THREAD_ERR_EXIT, managerFd, client_fd, sizeof(int));
+            if (errno == EINTR)
+                continue;
+
+            perror("epoll_wait");
+            THREAD_ERR_EXIT;
         }
 
-        free(client_fd);
+        for (int i = 0; i < nready; i++)
+        {
+            // Il manager ha richiesto la terminazione
+            if (events[i].data.fd == th_args->stop_fd)
+            {
+                logOperation(fs->logger_msg_queue, "Termination message recived", "", 0, 0);
+                deleteIoEngine(th_args->io);
+                pthread_exit(NULL);
+            }
+
+            handleRequest(th_args, events[i].data.fd);
+        }
     }
 
     pthread_exit(NULL);
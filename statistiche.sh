@@ -56,6 +56,9 @@ grep -zoP 'absMaxFiles\n.*\nbytesProcessed: [0-9]+' $1 | grep -aEo '[0-9]+'
 echo -n "Numero di espulsioni dalla cache: "
 grep "evicted" -c $1
 
+echo -n "Byte espulsi dalla cache: "
+grep -zoP 'evicted\n.*\nbytesProcessed: [0-9]+' $1 | grep -aEo 'bytesProcessed: [0-9]+' | grep -aEo '[0-9]+' | { sum=0; while read num; do ((sum+=num)); done; echo $sum; }
+
 echo "Numero richieste servite da ogni thread: "
 grep -o "workerTid: .*" $1 | sort | uniq -c
 
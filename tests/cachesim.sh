@@ -0,0 +1,18 @@
+#!/bin/bash
+TRACE=tests/trace.txt
+TRACE_LEN=${TRACE_LEN:-500000}
+
+# genero un trace sintetico: 1000 file di dimensione diversa, i primi molto piu' richiesti degli ultimi, 10% di scritture
+awk -v n=${TRACE_LEN} 'BEGIN {
+    srand(1);
+    for (i = 0; i < n; i++) {
+        r = rand();
+        id = int(1000 * r * r * r);
+        printf "%s /trace/file%d %d\n", (rand() < 0.1) ? "w" : "r", id, 1000 + (id * 7919) % 20000;
+    }
+}' > ${TRACE}
+
+# confronto tutti gli algoritmi di rimpiazzamento al variare di MAXFILES e MAXMEMORY
+bin/cachesim -f 50,200,800 -m 1,4 ${TRACE}
+
+exit 0
@@ -81,6 +81,97 @@ sleep 1
 bin/client -p -f LSOfiletorage.sk -W ./dummyFiles/rec/rec2/file10 -D tests/evicted4 -r $PWD/dummyFiles/rec/rec2/file8 -W ./dummyFiles/rec/rec2/file7 -D tests/evicted4
 
 
+kill -s SIGHUP $SERVER_PID
+wait $SERVER_PID
+
+sleep 3
+
+#--------------------------------------------------------------------------------------------------------
+bin/server tests/config/test2configGDSF.txt &
+SERVER_PID=$!
+
+echo ""
+echo -e "Algoritmo GDSF per il rimpiazzamento dei file"
+echo ""
+
+bin/client -p -f LSOfiletorage.sk -W ./dummyFiles/rec/rec2/file7,./dummyFiles/rec/file4
+
+sleep 1
+
+#dovrebbe espellere file4, il piu' grande, anche se file7 e' stato usato meno di recente
+bin/client -p -f LSOfiletorage.sk -W ./dummyFiles/rec/rec2/file8 -D tests/evicted6
+
+
+kill -s SIGHUP $SERVER_PID
+wait $SERVER_PID
+
+sleep 3
+
+#--------------------------------------------------------------------------------------------------------
+bin/server tests/config/test2configTinyLFU.txt &
+SERVER_PID=$!
+
+echo ""
+echo -e "Algoritmo W-TinyLFU per il rimpiazzamento dei file"
+echo ""
+
+bin/client -p -f LSOfiletorage.sk -W ./dummyFiles/rec/rec2/file7,./dummyFiles/rec/file4 -r $PWD/dummyFiles/rec/rec2/file7
+
+sleep 1
+
+#la scrittura di file8 non dovrebbe essere ammessa: espellerebbe file4, il meno recente della coda principale dopo la
+#lettura di file7, e file8 non e' stato usato piu' spesso di file4
+bin/client -p -f LSOfiletorage.sk -W ./dummyFiles/rec/rec2/file8 -D tests/evicted7
+
+
+kill -s SIGHUP $SERVER_PID
+wait $SERVER_PID
+
+sleep 3
+
+#--------------------------------------------------------------------------------------------------------
+bin/server tests/config/test2configS3FIFO.txt &
+SERVER_PID=$!
+
+echo ""
+echo -e "Algoritmo S3-FIFO per il rimpiazzamento dei file"
+echo ""
+
+bin/client -p -f LSOfiletorage.sk -W ./dummyFiles/rec/rec2/file7,./dummyFiles/rec/file4 -r $PWD/dummyFiles/rec/rec2/file7
+
+sleep 1
+
+#dovrebbe espellere file4: file7 e' stato letto mentre era nella coda piccola e passa nella coda principale
+bin/client -p -f LSOfiletorage.sk -W ./dummyFiles/rec/rec2/file8 -D tests/evicted8
+
+
+kill -s SIGHUP $SERVER_PID
+wait $SERVER_PID
+
+sleep 3
+
+#--------------------------------------------------------------------------------------------------------
+bin/server tests/config/test2configWatermark.txt &
+SERVER_PID=$!
+
+echo ""
+echo -e "Algoritmo FIFO con espulsione in background tra il 60% e il 40% della memoria"
+echo ""
+
+#il thread di espulsione dovrebbe espellere file7 dopo la scrittura di file8
+bin/client -p -f LSOfiletorage.sk -W ./dummyFiles/rec/rec2/file7,./dummyFiles/rec/rec2/file8
+
+sleep 1
+
+#dovrebbe espellere file8 in background: la scrittura non espelle nessun file
+bin/client -p -f LSOfiletorage.sk -W ./dummyFiles/rec/rec2/file9 -D tests/evicted9
+
+sleep 1
+
+#statistiche del server e miss ratio stimato per cache fino a 4 volte MAXMEMORY
+bin/client -f LSOfiletorage.sk -s
+
+
 kill -s SIGHUP $SERVER_PID
 wait $SERVER_PID
 